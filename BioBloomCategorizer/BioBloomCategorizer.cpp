@@ -15,6 +15,8 @@
 #include "DataLayer/Options.h"
 #include "config.h"
 #include "Common/Options.h"
+#include "Common/BloomFilterFile.h"
+#include "Common/CountingBloomFilter.h"
 #if _OPENMP
 # include <omp.h>
 #endif
@@ -68,6 +70,25 @@ void folderCheck(const string &path)
 	}
 }
 
+/*
+ * Prints the occupancy (and false positive rate of random k-mers) of filters
+ * as a table to stdout
+ */
+void printFilterStats(const vector<string> &filterFilePaths, size_t queries)
+{
+	BloomFilterInfo::printStatsHeader(cout);
+	for (vector<string>::const_iterator it = filterFilePaths.begin();
+			it != filterFilePaths.end(); ++it)
+	{
+		BloomFilterFile file(*it);
+		BloomFilterInfo info(file.getInfo());
+		BloomFilter filter(info.getCalcuatedFilterSize(), info.getHashNum(),
+				info.getKmerSize(), *it);
+		info.measure(filter, queries);
+		info.printStats(cout);
+	}
+}
+
 void printHelpDialog()
 {
 	const char dialog[] =
@@ -96,6 +117,10 @@ void printHelpDialog()
 	"  -g, --gz_output        Outputs all output files in compressed gzip.\n"
 	"      --fa               Output categorized reads in Fasta files.\n"
 	"      --fq               Output categorized reads in Fastq files.\n"
+	"      --assign           Output only the read number (order in input) and index\n"
+	"                         of the assigned filter of each read (or pair) to a\n"
+	"                         compact tsv file. Reads can later be extracted with\n"
+	"                         biobloomextractor.\n"
 	"      --chastity         Discard and do not evaluate unchaste reads.\n"
 	"      --no-chastity      Do not discard unchaste reads. [default]\n"
 	"  -l  --length_cutoff=N  Discard reads shorter that the cutoff N. [0]\n"
@@ -118,6 +143,32 @@ void printHelpDialog()
 	"                         filter. N is the filter ID without file extension.\n"
 	"                         Reads are outputed in fastq, and if paired will output\n"
 	"                         will be interlaced.\n"
+	"      --read_cache=N     Cache the classification of up to N distinct read\n"
+	"                         sequences so duplicate reads are evaluated only once.\n"
+	"                         Useful for amplicon or highly duplicated libraries.\n"
+	"                         Hit rate is added to the summary file. [0]\n"
+	"      --window=N         Long read mode. Classify windows of N bp of each read\n"
+	"                         and assign the read to the filter most windows are\n"
+	"                         assigned to. Window assignments are written to\n"
+	"                         [prefix]_windows.tsv. Not for paired reads. [0]\n"
+	"      --filter_stats=N   Print the fraction of bits set in each filter (-f)\n"
+	"                         and the false positive rate of N random k-mers\n"
+	"                         (none if N is 0) to stdout and exit. No input files\n"
+	"                         are needed.\n"
+	"      --subtract=N       Filter (eg. of a host) whose k-mers are treated as\n"
+	"                         misses, for all filters (-f) if given as FILTER.bf\n"
+	"                         or for one filter as FILTERID:FILTER.bf. May be given\n"
+	"                         several times, but once per filter. It is only\n"
+	"                         probed on hits, with the same hash values, so it\n"
+	"                         needs the same k-mer size and spaced seed and at most\n"
+	"                         as many hash functions. Cannot be used with -o, -c or\n"
+	"                         minimizer filters.\n"
+	"      --max_abundance=N  Treat k-mers occurring more than N times in the\n"
+	"                         sequences of a filter (counted with biobloommaker\n"
+	"                         -A) as misses, so reads are not assigned on repeats.\n"
+	"                         Filters without counts are used as they are.\n"
+	"                         N must be from 1 to 254 (counts stop at 255).\n"
+	"                         Cannot be used with -o or -c.\n"
 	"Report bugs to <cjustin@bcgsc.ca>.";
 
 	cerr << dialog << endl;
@@ -145,6 +196,7 @@ int main(int argc, char *argv[])
 
 	int fastq = 0;
 	int fasta = 0;
+	int assign = 0;
 	string filePostfix = "";
 	double score = 0.15;
 	bool withScore = false;
@@ -155,6 +207,18 @@ int main(int argc, char *argv[])
 	bool collab = false;
 
 	string mainFilter = "";
+	size_t readCacheSize = 0;
+	size_t windowSize = 0;
+	bool filterStats = false;
+	size_t statsQueries = 0;
+	vector<string> subtractFilters;
+	unsigned maxAbundance = 0;
+
+	//long form only options
+	enum {
+		OPT_READ_CACHE = 256, OPT_WINDOW, OPT_FILTER_STATS, OPT_SUBTRACT,
+		OPT_MAX_ABUNDANCE
+	};
 
 	//long form arguments
 	static struct option long_options[] = { {
@@ -170,6 +234,7 @@ int main(int argc, char *argv[])
 		"no-chastity", no_argument, &opt::chastityFilter, 0 }, {
 		"fq", no_argument, &fastq, 1 }, {
 		"fa", no_argument, &fasta, 1 }, {
+		"assign", no_argument, &assign, 1 }, {
 		"length_cutoff", required_argument, NULL, 'l' }, {
 		"version", no_argument, NULL, 'v' }, {
 		"min_hit_thr", required_argument, NULL, 'm' }, {
@@ -178,6 +243,11 @@ int main(int argc, char *argv[])
 		"ordered", no_argument, NULL, 'c' }, {
 		"stdout_filter", required_argument, NULL, 'd' }, {
 		"with_score", no_argument, NULL, 'w' }, {
+		"read_cache", required_argument, NULL, OPT_READ_CACHE }, {
+		"window", required_argument, NULL, OPT_WINDOW }, {
+		"filter_stats", required_argument, NULL, OPT_FILTER_STATS }, {
+		"subtract", required_argument, NULL, OPT_SUBTRACT }, {
+		"max_abundance", required_argument, NULL, OPT_MAX_ABUNDANCE }, {
 		NULL, 0, NULL, 0 } };
 
 	//actual checking step
@@ -277,6 +347,48 @@ int main(int argc, char *argv[])
 			withScore = true;
 			break;
 		}
+		case OPT_READ_CACHE: {
+			stringstream convert(optarg);
+			if (!(convert >> readCacheSize)) {
+				cerr << "Error - Invalid parameter! read_cache: " << optarg
+						<< endl;
+				exit(EXIT_FAILURE);
+			}
+			break;
+		}
+		case OPT_WINDOW: {
+			stringstream convert(optarg);
+			if (!(convert >> windowSize) || windowSize == 0) {
+				cerr << "Error - Invalid parameter! window: " << optarg << endl;
+				exit(EXIT_FAILURE);
+			}
+			break;
+		}
+		case OPT_FILTER_STATS: {
+			stringstream convert(optarg);
+			if (!(convert >> statsQueries)) {
+				cerr << "Error - Invalid parameter! filter_stats: " << optarg
+						<< endl;
+				exit(EXIT_FAILURE);
+			}
+			filterStats = true;
+			break;
+		}
+		case OPT_SUBTRACT: {
+			subtractFilters.push_back(optarg);
+			break;
+		}
+		case OPT_MAX_ABUNDANCE: {
+			stringstream convert(optarg);
+			if (!(convert >> maxAbundance) || maxAbundance == 0
+					|| maxAbundance >= CountingBloomFilter::s_maxCount)
+			{
+				cerr << "Error - Invalid parameter! max_abundance: " << optarg
+						<< endl;
+				exit(EXIT_FAILURE);
+			}
+			break;
+		}
 		case '?': {
 			die = true;
 			break;
@@ -319,6 +431,10 @@ int main(int argc, char *argv[])
 	}
 
 	//Check needed options
+	if (filterStats && !filterFilePaths.empty() && !die) {
+		printFilterStats(filterFilePaths, statsQueries);
+		return 0;
+	}
 	if (inputFiles.size() == 0) {
 		cerr << "Error: Need Input File" << endl;
 		die = true;
@@ -350,7 +466,7 @@ int main(int argc, char *argv[])
 	}
 
 	//-w option cannot be used without output method
-	if (withScore && (outputReadType == "")) {
+	if (withScore && (outputReadType == "") && !assign) {
 		cerr << "Error: -w option cannot be used without output method" << endl;
 		exit(1);
 	}
@@ -366,10 +482,41 @@ int main(int argc, char *argv[])
 		BBC.setCollabFilter();
 	}
 
+	if (!subtractFilters.empty()) {
+		BBC.setSubtractFilters(subtractFilters);
+	}
+
+	if (maxAbundance > 0) {
+		BBC.setMaxAbundance(maxAbundance);
+	}
+
 	if (mainFilter != "") {
 		BBC.setMainFilter(mainFilter);
 	}
 
+	if (windowSize > 0) {
+		if (paired) {
+			cerr << "Error: --window cannot be used with paired mode (-e)"
+					<< endl;
+			exit(1);
+		}
+		BBC.setWindowSize(windowSize);
+	}
+
+	if (readCacheSize > 0) {
+		BBC.setReadCache(readCacheSize);
+	}
+
+	if (assign) {
+		if (pairedBAMSAM) {
+			cerr
+					<< "Error: --assign cannot be used with paired BAM/SAM input because pairs are not read in input order"
+					<< endl;
+			exit(1);
+		}
+		BBC.setAssignOutput();
+	}
+
 	//filtering step
 	//create directory structure if it does not exist
 	if (paired) {
@@ -390,6 +537,8 @@ int main(int argc, char *argv[])
 				BBC.filterPair(inputFiles[0], inputFiles[1]);
 			}
 		}
+	} else if (windowSize > 0) {
+		BBC.filterWindowed(inputFiles, outputReadType);
 	} else {
 		if (outputReadType != "") {
 			BBC.filterPrint(inputFiles, outputReadType);
@@ -13,6 +13,9 @@
 #include "ResultsManager.h"
 #include "Common/Options.h"
 #include <map>
+#include "Common/MinimizerSampler.h"
+#include "Common/BloomFilterFile.h"
+#include "Common/CountingBloomFilter.h"
 #if _OPENMP
 # include <omp.h>
 #endif
@@ -22,7 +25,7 @@ BioBloomClassifier::BioBloomClassifier(const vector<string> &filterFilePaths,
 		const string &outputPostFix, unsigned minHit, bool minHitOnly, bool withScore) :
 		m_scoreThreshold(scoreThreshold), m_filterNum(filterFilePaths.size()), m_prefix(
 				prefix), m_postfix(outputPostFix), m_minHit(minHit), m_mode(
-				STD), m_mainFilter(""), m_inclusive(false)
+				STD), m_mainFilter(""), m_inclusive(false), m_assign(false), m_windowSize(0), m_sampled(false), m_spaced(false)
 {
 	loadFilters(filterFilePaths);
 	if (minHitOnly && withScore) {
@@ -38,9 +41,19 @@ BioBloomClassifier::BioBloomClassifier(const vector<string> &filterFilePaths,
 	}
 	if (m_scoreThreshold == 1) {
 		m_mode = BESTHIT;
-		//TODO: make it possible later?
-		//best hit will not allow for more than one hash sig.
-		assert(m_mode == BESTHIT && m_hashSigs.size() == 1);
+	}
+	if (m_sampled && m_mode != STD && m_mode != SCORES) {
+		cerr
+				<< "Minimizer filters cannot be used with -s 1 or -o."
+				<< endl;
+		exit(1);
+	}
+	if (m_mode == BESTHIT) {
+#if _OPENMP
+		m_bestHitStates.resize(omp_get_max_threads());
+#else
+		m_bestHitStates.resize(1);
+#endif
 	}
 }
 
@@ -56,6 +69,7 @@ void BioBloomClassifier::filter(const vector<string> &inputFiles)
 	size_t totalReads = 0;
 
 	//print out header info and initialize variables
+	openAssignOutput();
 
 	cerr << "Filtering Start" << endl;
 
@@ -66,33 +80,31 @@ void BioBloomClassifier::filter(const vector<string> &inputFiles)
 #pragma omp parallel
 		for (FastqRecord rec;;) {
 			bool good;
+			size_t ordinal = 0;
 #pragma omp critical(sequence)
 			{
 				good = sequence >> rec;
 				//track read progress
-			}
-			if (good) {
-#pragma omp critical(totalReads)
-				{
-					++totalReads;
+				if (good) {
+					ordinal = totalReads++;
 					if (totalReads % 10000000 == 0) {
 						cerr << "Currently Reading Read Number: " << totalReads
 								<< endl;
 					}
 				}
+			}
+			if (good) {
 				unordered_map<string, bool> hits(m_filterNum);
 				double score = 0; //Todo: figure out what happens to this if multiple hashSigs are used
 				vector<double> scores(m_filterNum, 0.0);
 
-				//for each hashSigniture/kmer combo multi, cut up read into kmer sized used
-				for (vector<string>::const_iterator j = m_hashSigs.begin();
-						j != m_hashSigs.end(); ++j)
-				{
-					evaluateRead(rec, *j, hits, score, scores);
-				}
+				evaluateRead(rec, hits, score, scores);
 
 				//Evaluate hit data and record for summary and print if needed
-				printSingle(rec, score, resSummary.updateSummaryData(hits));
+				const string &outputFileName = resSummary.updateSummaryData(
+						hits);
+				printSingle(rec, score, outputFileName);
+				printAssign(ordinal, outputFileName, score, scores);
 
 			} else
 				break;
@@ -106,7 +118,11 @@ void BioBloomClassifier::filter(const vector<string> &inputFiles)
 
 	Dynamicofstream summaryOutput(m_prefix + "_summary.tsv");
 	summaryOutput << resSummary.getResultsSummary(totalReads);
+	if (m_readCache) {
+		summaryOutput << m_readCache->getSummary();
+	}
 	summaryOutput.close();
+	closeAssignOutput();
 	cout.flush();
 }
 
@@ -126,33 +142,10 @@ void BioBloomClassifier::filterPrint(const vector<string> &inputFiles,
 	size_t totalReads = 0;
 
 	unordered_map<string, boost::shared_ptr<Dynamicofstream> > outputFiles;
-	boost::shared_ptr<Dynamicofstream> no_match(
-			new Dynamicofstream(
-					m_prefix + "_" + NO_MATCH + "." + outputType + m_postfix));
-	boost::shared_ptr<Dynamicofstream> multi_match(
-			new Dynamicofstream(
-					m_prefix + "_" + MULTI_MATCH + "." + outputType
-							+ m_postfix));
-	outputFiles[NO_MATCH] = no_match;
-	outputFiles[MULTI_MATCH] = multi_match;
-
-	//initialize variables
-	for (vector<string>::const_iterator j = m_hashSigs.begin();
-			j != m_hashSigs.end(); ++j)
-	{
-		const vector<string> idsInFilter = (*m_filters[*j]).getFilterIds();
-		for (vector<string>::const_iterator i = idsInFilter.begin();
-				i != idsInFilter.end(); ++i)
-		{
-			boost::shared_ptr<Dynamicofstream> temp(
-					new Dynamicofstream(
-							m_prefix + "_" + *i + "." + outputType
-									+ m_postfix));
-			outputFiles[*i] = temp;
-		}
-	}
+	openOutputFiles(outputFiles, outputType);
 
 	//print out header info and initialize variables
+	openAssignOutput();
 
 	cerr << "Filtering Start" << endl;
 
@@ -163,29 +156,25 @@ void BioBloomClassifier::filterPrint(const vector<string> &inputFiles,
 #pragma omp parallel
 		for (FastqRecord rec;;) {
 			bool good;
+			size_t ordinal = 0;
 #pragma omp critical(sequence)
 			{
 				good = sequence >> rec;
-			}
-			if (good) {
-#pragma omp critical(totalReads)
-				{
-					++totalReads;
+				//track read progress
+				if (good) {
+					ordinal = totalReads++;
 					if (totalReads % 10000000 == 0) {
 						cerr << "Currently Reading Read Number: " << totalReads
 								<< endl;
 					}
 				}
+			}
+			if (good) {
 				unordered_map<string, bool> hits(m_filterNum);
 				double score = 0.0;
 				vector<double> scores(m_filterNum, 0.0);
 
-				//for each hashSigniture/kmer combo multi, cut up read into kmer sized used
-				for (vector<string>::const_iterator j = m_hashSigs.begin();
-						j != m_hashSigs.end(); ++j)
-				{
-					evaluateRead(rec, *j, hits, score, scores);
-				}
+				evaluateRead(rec, hits, score, scores);
 
 				//Evaluate hit data and record for summary
 				const string &outputFileName = resSummary.updateSummaryData(
@@ -195,6 +184,7 @@ void BioBloomClassifier::filterPrint(const vector<string> &inputFiles,
 
 				printSingleToFile(outputFileName, rec, outputFiles, outputType,
 						score, scores);
+				printAssign(ordinal, outputFileName, score, scores);
 
 			} else
 				break;
@@ -202,21 +192,172 @@ void BioBloomClassifier::filterPrint(const vector<string> &inputFiles,
 		assert(sequence.eof());
 	}
 
-	//close sorting files
-	for (unordered_map<string, boost::shared_ptr<Dynamicofstream> >::iterator j =
-			outputFiles.begin(); j != outputFiles.end(); ++j)
+	closeOutputFiles(outputFiles, outputType);
+	cerr << "Total Reads:" << totalReads << endl;
+	cerr << "Writing file: " << m_prefix + "_summary.tsv" << endl;
+
+	Dynamicofstream summaryOutput(m_prefix + "_summary.tsv");
+	summaryOutput << resSummary.getResultsSummary(totalReads);
+	if (m_readCache) {
+		summaryOutput << m_readCache->getSummary();
+	}
+	summaryOutput.close();
+	closeAssignOutput();
+	cout.flush();
+}
+
+/*
+ * Filters long reads by classifying fixed size windows of each read
+ * Per window assignments are written to a separate file and each read is
+ * assigned to the filter most windows are uniquely assigned to
+ * Windows of a batch of reads are evaluated in parallel, so a few very long
+ * reads do not stall a single thread
+ * Prints reads into separate files if outputType is set
+ */
+void BioBloomClassifier::filterWindowed(const vector<string> &inputFiles,
+		const string &outputType)
+{
+	//results summary object
+	ResultsManager resSummary(m_filterOrder, m_inclusive);
+
+	size_t totalReads = 0;
+	size_t totalWindows = 0;
+
+	unordered_map<string, boost::shared_ptr<Dynamicofstream> > outputFiles;
+	if (outputType != "") {
+		openOutputFiles(outputFiles, outputType);
+	}
+	openAssignOutput();
+
+	Dynamicofstream windowOutput(m_prefix + "_windows.tsv" + m_postfix);
+	windowOutput << "read_id\twindow\tstart\tend\tfilter_id\n";
+
+	//windows are extended by k - 1 so k-mers spanning windows are not lost
+	unsigned maxKmerSize = 0;
+	for (vector<string>::const_iterator j = m_hashSigs.begin();
+			j != m_hashSigs.end(); ++j)
 	{
-		j->second->close();
-		cerr << "File written to: "
-				<< m_prefix + "_" + j->first + "." + outputType + m_postfix
-				<< endl;
+		maxKmerSize = max(maxKmerSize,
+				m_infoFiles.at(*j).front()->getKmerSize());
+	}
+
+	//number of windows needed to keep all threads busy
+	size_t batchWindows = s_windowsPerThread;
+#if _OPENMP
+	batchWindows *= omp_get_max_threads();
+#endif
+
+	cerr << "Filtering Start" << endl;
+
+	for (vector<string>::const_iterator it = inputFiles.begin();
+			it != inputFiles.end(); ++it)
+	{
+		FastaReader sequence(it->c_str(), FastaReader::NO_FOLD_CASE);
+		vector<FastqRecord> batch;
+		vector<pair<size_t, size_t> > windows;
+		for (FastqRecord rec;;) {
+			bool good = sequence >> rec;
+			if (good) {
+				batch.push_back(rec);
+				//each read has at least one window
+				for (size_t start = 0;
+						start == 0 || start + m_windowSize <= rec.seq.length();
+						start += m_windowSize)
+				{
+					windows.push_back(make_pair(batch.size() - 1, start));
+				}
+				if (windows.size() < batchWindows) {
+					continue;
+				}
+			}
+
+			//evaluate all windows in batch
+			vector<unordered_map<string, bool> > windowHits(windows.size());
+			vector<string> windowIDs(windows.size());
+#pragma omp parallel for schedule(dynamic)
+			for (long i = 0; i < long(windows.size()); ++i) {
+				const FastqRecord &read = batch[windows[i].first];
+				size_t start = windows[i].second;
+				//last window absorbs the remainder of the read
+				size_t length =
+						start + 2 * m_windowSize > read.seq.length() ?
+								read.seq.length() - start :
+								m_windowSize + maxKmerSize - 1;
+				FastqRecord window;
+				window.id = read.id;
+				window.seq = read.seq.substr(start, length);
+				window.qual =
+						read.qual.empty() ?
+								read.qual : read.qual.substr(start, length);
+				double score = 0;
+				vector<double> scores(m_filterNum, 0.0);
+				windowHits[i].rehash(m_filterNum);
+				evaluateRead(window, windowHits[i], score, scores);
+				windowIDs[i] = getAssignment(windowHits[i]);
+			}
+
+			//consensus of windows of each read, reported in input order
+			for (size_t i = 0, readWindow = 0; i < windows.size(); ++i) {
+				const FastqRecord &read = batch[windows[i].first];
+				size_t start = windows[i].second;
+				size_t end =
+						start + 2 * m_windowSize > read.seq.length() ?
+								read.seq.length() :
+								start + m_windowSize;
+				stringstream line;
+				line << read.id << "\t" << readWindow << "\t" << start << "\t"
+						<< end << "\t" << windowIDs[i] << "\n";
+				windowOutput << line.str();
+				++readWindow;
+
+				//last window of read
+				if (i + 1 == windows.size()
+						|| windows[i + 1].first != windows[i].first)
+				{
+					unordered_map<string, bool> hits(m_filterNum);
+					vector<double> scores(m_filterNum, 0.0);
+					double score = getConsensus(windowHits, windowIDs,
+							i + 1 - readWindow, i + 1, hits, scores);
+					const string &outputFileName =
+							resSummary.updateSummaryData(hits);
+					printSingle(read, score, outputFileName);
+					if (outputType != "") {
+						printSingleToFile(outputFileName, read, outputFiles,
+								outputType, score, scores);
+					}
+					printAssign(totalReads, outputFileName, score, scores);
+					totalWindows += readWindow;
+					readWindow = 0;
+					if (++totalReads % 10000000 == 0) {
+						cerr << "Currently Reading Read Number: " << totalReads
+								<< endl;
+					}
+				}
+			}
+			batch.clear();
+			windows.clear();
+			if (!good) {
+				break;
+			}
+		}
+		assert(sequence.eof());
 	}
+
+	if (outputType != "") {
+		closeOutputFiles(outputFiles, outputType);
+	}
+	windowOutput.close();
 	cerr << "Total Reads:" << totalReads << endl;
+	cerr << "Total Windows:" << totalWindows << endl;
 	cerr << "Writing file: " << m_prefix + "_summary.tsv" << endl;
 
 	Dynamicofstream summaryOutput(m_prefix + "_summary.tsv");
 	summaryOutput << resSummary.getResultsSummary(totalReads);
+	if (m_readCache) {
+		summaryOutput << m_readCache->getSummary();
+	}
 	summaryOutput.close();
+	closeAssignOutput();
 	cout.flush();
 }
 
@@ -233,6 +374,8 @@ void BioBloomClassifier::filterPair(const string &file1, const string &file2)
 
 	size_t totalReads = 0;
 
+	openAssignOutput();
+
 	cerr << "Filtering Start" << "\n";
 
 	FastaReader sequence1(file1.c_str(), FastaReader::NO_FOLD_CASE);
@@ -242,23 +385,23 @@ void BioBloomClassifier::filterPair(const string &file1, const string &file2)
 		FastqRecord rec2;
 		bool good1;
 		bool good2;
+		size_t ordinal = 0;
 
 #pragma omp critical(sequence1)
 		{
 			good1 = sequence1 >> rec1;
 			good2 = sequence2 >> rec2;
 			//track read progress
-		}
-
-		if (good1 && good2) {
-#pragma omp critical(totalReads)
-			{
-				++totalReads;
+			if (good1 && good2) {
+				ordinal = totalReads++;
 				if (totalReads % 10000000 == 0) {
 					cerr << "Currently Reading Read Number: " << totalReads
 							<< endl;
 				}
 			}
+		}
+
+		if (good1 && good2) {
 
 			//hits results stored in hashmap of filter names and hits
 			unordered_map<string, bool> hits1(m_filterNum);
@@ -270,25 +413,23 @@ void BioBloomClassifier::filterPair(const string &file1, const string &file2)
 			vector<double> scores1(m_filterNum, 0.0);
 			vector<double> scores2(m_filterNum, 0.0);
 
-			//for each hashSigniture/kmer combo multi, cut up read into kmer sized used
-			for (vector<string>::const_iterator j = m_hashSigs.begin();
-					j != m_hashSigs.end(); ++j)
-			{
-				string tempStr1 = rec1.id.substr(0, rec1.id.find_last_of("/"));
-				string tempStr2 = rec2.id.substr(0, rec2.id.find_last_of("/"));
-				if (tempStr1 == tempStr2) {
-					evaluateRead(rec1, *j, hits1, score1, scores1);
-					evaluateRead(rec2, *j, hits2, score2, scores2);
-				} else {
-					cerr << "Read IDs do not match" << "\n" << tempStr1 << "\n"
-							<< tempStr2 << endl;
-					exit(1);
-				}
+			string tempStr1 = rec1.id.substr(0, rec1.id.find_last_of("/"));
+			string tempStr2 = rec2.id.substr(0, rec2.id.find_last_of("/"));
+			if (tempStr1 == tempStr2) {
+				evaluateRead(rec1, hits1, score1, scores1);
+				evaluateRead(rec2, hits2, score2, scores2);
+			} else {
+				cerr << "Read IDs do not match" << "\n" << tempStr1 << "\n"
+						<< tempStr2 << endl;
+				exit(1);
 			}
 
 			//Evaluate hit data and record for summary and print if needed
-			printPair(rec1, rec2, score1, score2,
-					resSummary.updateSummaryData(hits1, hits2));
+			const string &outputFileName = resSummary.updateSummaryData(hits1,
+					hits2);
+			printPair(rec1, rec2, score1, score2, outputFileName);
+			printAssign(ordinal, outputFileName, score1, score2, scores1,
+					scores2);
 		} else
 			break;
 	}
@@ -303,7 +444,11 @@ void BioBloomClassifier::filterPair(const string &file1, const string &file2)
 
 	Dynamicofstream summaryOutput(m_prefix + "_summary.tsv");
 	summaryOutput << resSummary.getResultsSummary(totalReads);
+	if (m_readCache) {
+		summaryOutput << m_readCache->getSummary();
+	}
 	summaryOutput.close();
+	closeAssignOutput();
 	cout.flush();
 }
 
@@ -366,6 +511,7 @@ void BioBloomClassifier::filterPairPrint(const string &file1,
 	}
 
 	//for output files in consistent order
+	openAssignOutput();
 
 	cerr << "Filtering Start" << "\n";
 
@@ -376,22 +522,23 @@ void BioBloomClassifier::filterPairPrint(const string &file1,
 		FastqRecord rec2;
 		bool good1;
 		bool good2;
+		size_t ordinal = 0;
 
 #pragma omp critical(sequence1)
 		{
 			good1 = sequence1 >> rec1;
 			good2 = sequence2 >> rec2;
-		}
-
-		if (good1 && good2) {
-#pragma omp critical(totalReads)
-			{
-				++totalReads;
+			//track read progress
+			if (good1 && good2) {
+				ordinal = totalReads++;
 				if (totalReads % 10000000 == 0) {
 					cerr << "Currently Reading Read Number: " << totalReads
 							<< endl;
 				}
 			}
+		}
+
+		if (good1 && good2) {
 
 			//hits results stored in hashmap of filter names and hits
 			unordered_map<string, bool> hits1(m_filterNum);
@@ -403,20 +550,15 @@ void BioBloomClassifier::filterPairPrint(const string &file1,
 			vector<double> scores1(m_filterNum, 0.0);
 			vector<double> scores2(m_filterNum, 0.0);
 
-			//for each hashSigniture/kmer combo multi, cut up read into kmer sized used
-			for (vector<string>::const_iterator j = m_hashSigs.begin();
-					j != m_hashSigs.end(); ++j)
-			{
-				string tempStr1 = rec1.id.substr(0, rec1.id.find_last_of("/"));
-				string tempStr2 = rec2.id.substr(0, rec2.id.find_last_of("/"));
-				if (tempStr1 == tempStr2) {
-					evaluateRead(rec1, *j, hits1, score1, scores1);
-					evaluateRead(rec2, *j, hits2, score2, scores2);
-				} else {
-					cerr << "Read IDs do not match" << "\n" << tempStr1 << "\n"
-							<< tempStr2 << endl;
-					exit(1);
-				}
+			string tempStr1 = rec1.id.substr(0, rec1.id.find_last_of("/"));
+			string tempStr2 = rec2.id.substr(0, rec2.id.find_last_of("/"));
+			if (tempStr1 == tempStr2) {
+				evaluateRead(rec1, hits1, score1, scores1);
+				evaluateRead(rec2, hits2, score2, scores2);
+			} else {
+				cerr << "Read IDs do not match" << "\n" << tempStr1 << "\n"
+						<< tempStr2 << endl;
+				exit(1);
 			}
 
 			//Evaluate hit data and record for summary
@@ -426,6 +568,8 @@ void BioBloomClassifier::filterPairPrint(const string &file1,
 			printPair(rec1, rec2, score1, score2, outputFileName);
 			printPairToFile(outputFileName, rec1, rec2, outputFiles, outputType,
 					score1, score2, scores1, scores2 );
+			printAssign(ordinal, outputFileName, score1, score2, scores1,
+					scores2);
 		} else
 			break;
 	}
@@ -450,7 +594,11 @@ void BioBloomClassifier::filterPairPrint(const string &file1,
 
 	Dynamicofstream summaryOutput(m_prefix + "_summary.tsv");
 	summaryOutput << resSummary.getResultsSummary(totalReads);
+	if (m_readCache) {
+		summaryOutput << m_readCache->getSummary();
+	}
 	summaryOutput.close();
+	closeAssignOutput();
 	cout.flush();
 }
 
@@ -520,13 +668,8 @@ void BioBloomClassifier::filterPairBAM(const string &file)
 				vector<double> scores1(m_filterNum, 0.0);
 				vector<double> scores2(m_filterNum, 0.0);
 
-				//for each hashSigniture/kmer combo multi, cut up read into kmer sized used
-				for (vector<string>::const_iterator j = m_hashSigs.begin();
-						j != m_hashSigs.end(); ++j)
-				{
-					evaluateRead(rec1, *j, hits1, score1, scores1);
-					evaluateRead(rec2, *j, hits2, score2, scores2);
-				}
+				evaluateRead(rec1, hits1, score1, scores1);
+				evaluateRead(rec2, hits2, score2, scores2);
 
 				//Evaluate hit data and record for summary
 				printPair(rec1, rec2, score1, score2,
@@ -542,6 +685,9 @@ void BioBloomClassifier::filterPairBAM(const string &file)
 
 	Dynamicofstream summaryOutput(m_prefix + "_summary.tsv");
 	summaryOutput << resSummary.getResultsSummary(totalReads);
+	if (m_readCache) {
+		summaryOutput << m_readCache->getSummary();
+	}
 	summaryOutput.close();
 	cout.flush();
 }
@@ -654,22 +800,17 @@ void BioBloomClassifier::filterPairBAMPrint(const string &file,
 				vector<double> scores1(m_filterNum, 0.0);
 				vector<double> scores2(m_filterNum, 0.0);
 
-				//for each hashSigniture/kmer combo multi, cut up read into kmer sized used
-				for (vector<string>::const_iterator j = m_hashSigs.begin();
-						j != m_hashSigs.end(); ++j)
-				{
-					string tempStr1 = rec1.id.substr(0,
-							rec1.id.find_last_of("/"));
-					string tempStr2 = rec2.id.substr(0,
-							rec2.id.find_last_of("/"));
-					if (tempStr1 == tempStr2) {
-						evaluateRead(rec1, *j, hits1, score1, scores1);
-						evaluateRead(rec2, *j, hits2, score2, scores2);
-					} else {
-						cerr << "Read IDs do not match" << "\n" << tempStr1
-								<< "\n" << tempStr2 << endl;
-						exit(1);
-					}
+				string tempStr1 = rec1.id.substr(0,
+						rec1.id.find_last_of("/"));
+				string tempStr2 = rec2.id.substr(0,
+						rec2.id.find_last_of("/"));
+				if (tempStr1 == tempStr2) {
+					evaluateRead(rec1, hits1, score1, scores1);
+					evaluateRead(rec2, hits2, score2, scores2);
+				} else {
+					cerr << "Read IDs do not match" << "\n" << tempStr1
+							<< "\n" << tempStr2 << endl;
+					exit(1);
 				}
 
 				//Evaluate hit data and record for summary
@@ -699,6 +840,9 @@ void BioBloomClassifier::filterPairBAMPrint(const string &file,
 
 	Dynamicofstream summaryOutput(m_prefix + "_summary.tsv");
 	summaryOutput << resSummary.getResultsSummary(totalReads);
+	if (m_readCache) {
+		summaryOutput << m_readCache->getSummary();
+	}
 	summaryOutput.close();
 	cout.flush();
 }
@@ -721,21 +865,24 @@ void BioBloomClassifier::loadFilters(const vector<string> &filterFilePaths)
 			cerr << "Error: " + (*it) + " File cannot be opened" << endl;
 			exit(1);
 		}
-		string infoFileName = (*it).substr(0, (*it).length() - 2) + "txt";
-		if (!fexists(infoFileName)) {
-			cerr
-					<< "Error: " + (infoFileName)
-							+ " File cannot be opened. A corresponding info file is needed."
-					<< endl;
-			exit(1);
-		}
 
-		//info file creation
+		//info is read from a single file filter or the info file next to it
+		BloomFilterFile filterFile(*it);
 		boost::shared_ptr<BloomFilterInfo> info(
-				new BloomFilterInfo(infoFileName));
+				new BloomFilterInfo(filterFile.getInfo()));
 		//append kmer size to hash signature to insure correct kmer size is used
 		stringstream hashSig;
 		hashSig << info->getHashNum() << info->getKmerSize();
+		//filters of minimizers can only be compared with the same sampling
+		if (info->getMinimizerWindow() > 0) {
+			hashSig << "w" << info->getMinimizerWindow();
+			m_sampled = true;
+		}
+		//filters of spaced seeds can only be compared with the same seed
+		if (!info->getSpacedSeed().empty()) {
+			hashSig << "s" << info->getSpacedSeed();
+			m_spaced = true;
+		}
 
 		//if hashSig exists add filter to list
 		if (m_infoFiles.count(hashSig.str()) != 1) {
@@ -752,16 +899,51 @@ void BioBloomClassifier::loadFilters(const vector<string> &filterFilePaths)
 						info->getHashNum(), info->getKmerSize(), *it));
 		m_filters[hashSig.str()]->addFilter(info->getFilterID(), filter);
 		m_filtersSingle[info->getFilterID()] = filter;
+		m_filterPaths[info->getFilterID()] = *it;
 		m_filterOrder.push_back(info->getFilterID());
 		cerr << "Loaded Filter: " + info->getFilterID() << endl;
 	}
-	if (m_scoreThreshold == 1 && m_hashSigs.size() > 1) {
-		cerr
-				<< "If -s = 1 (best hit mode) all filters must use the same k and same number of hash functions."
+	cerr << "Filter Loading Complete." << endl;
+}
+
+/*
+ * Opens assignment output file if enabled and writes header
+ * Header lists filter index of each filter ID, multiMatch and noMatch
+ */
+void BioBloomClassifier::openAssignOutput()
+{
+	if (!m_assign) {
+		return;
+	}
+	m_filterIndex.clear();
+	for (unsigned i = 0; i < m_filterOrder.size(); ++i) {
+		m_filterIndex[m_filterOrder[i]] = i;
+	}
+	m_filterIndex[MULTI_MATCH] = m_filterOrder.size();
+	m_filterIndex[NO_MATCH] = m_filterOrder.size() + 1;
+
+	m_assignOutput = boost::shared_ptr<Dynamicofstream>(
+			new Dynamicofstream(m_prefix + "_assign.tsv" + m_postfix));
+	stringstream header;
+	header << "#filters";
+	for (vector<string>::const_iterator i = m_filterOrder.begin();
+			i != m_filterOrder.end(); ++i)
+	{
+		header << "\t" << *i;
+	}
+	header << "\t" << MULTI_MATCH << "\t" << NO_MATCH << "\n";
+	header << "#read_ordinal\tfilter_index\n";
+	(*m_assignOutput) << header.str();
+}
+
+void BioBloomClassifier::closeAssignOutput()
+{
+	if (m_assignOutput) {
+		m_assignOutput->close();
+		cerr << "File written to: " << m_prefix + "_assign.tsv" + m_postfix
 				<< endl;
-		exit(1);
+		m_assignOutput.reset();
 	}
-	cerr << "Filter Loading Complete." << endl;
 }
 
 /*
@@ -773,6 +955,26 @@ bool BioBloomClassifier::fexists(const string &filename) const
 	return ifile;
 }
 
+/*
+ * Screens the read (unless minHit is 0) and evaluates it until threshold,
+ * continuing from currentLoc and score
+ * Returns true if the read is a hit
+ */
+template<typename Probe, typename HashCache>
+static inline bool screenAndEval(size_t seqLength, unsigned kmerSize,
+		const Probe &probe, HashCache &cache, unsigned minHit, double threshold,
+		double antiThreshold, unsigned &currentLoc, double &score)
+{
+	if (minHit > 0
+			&& SeqEval::screenCore(seqLength, kmerSize, probe, cache, minHit)
+					< minHit)
+	{
+		return false;
+	}
+	return SeqEval::evalCore(seqLength, kmerSize, probe, cache, threshold,
+			antiThreshold, currentLoc, score);
+}
+
 /*
  * Collaborative filtering method
  * Assume filters use the same k-mer size
@@ -780,11 +982,13 @@ bool BioBloomClassifier::fexists(const string &filename) const
 void BioBloomClassifier::evaluateReadCollab(const FastqRecord &rec,
 		const string &hashSig, unordered_map<string, bool> &hits)
 {
+	typedef SeqEval::FilterProbe<BloomFilter> Probe;
+
 	//get filterIDs to iterate through has in a consistent order
 	unsigned kmerSize = m_infoFiles.at(hashSig).front()->getKmerSize();
 
-	//todo: read proc possibly unneeded, see evalSingle
 	ReadsProcessor proc(kmerSize);
+	SeqEval::SharedNoHashCache cache(rec.seq, proc);
 
 	//create storage for hits per filter
 	std::multimap<unsigned, string> firstPassHits;
@@ -795,19 +999,10 @@ void BioBloomClassifier::evaluateReadCollab(const FastqRecord &rec,
 			i != m_filterOrder.end(); ++i)
 	{
 		hits[*i] = false;
-		unsigned screeningHits = 0;
-		size_t screeningLoc = rec.seq.length() % kmerSize / 2;
 		//First pass filtering
-		while (rec.seq.length() >= screeningLoc + kmerSize) {
-			const unsigned char* currentKmer = proc.prepSeq(rec.seq,
-					screeningLoc);
-			if (currentKmer != NULL) {
-				if (m_filtersSingle.at(*i)->contains(currentKmer)) {
-					++screeningHits;
-				}
-			}
-			screeningLoc += kmerSize;
-		}
+		unsigned screeningHits = SeqEval::screenCore(rec.seq.length(),
+				kmerSize, Probe(*m_filtersSingle.at(*i)), cache,
+				numeric_limits<unsigned>::max());
 		firstPassHits.insert(pair<unsigned, string>(screeningHits, *i));
 	}
 
@@ -820,8 +1015,11 @@ void BioBloomClassifier::evaluateReadCollab(const FastqRecord &rec,
 			firstPassHits.rbegin(); i != firstPassHits.rend(); ++i)
 	{
 		string filterID = i->second;
-		BloomFilter &tempFilter = *m_filtersSingle.at(filterID);
-		if(SeqEval::evalSingle(rec, kmerSize, tempFilter, threshold, antiThreshold))
+		unsigned currentLoc = 0;
+		double score = 0;
+		if (SeqEval::evalCore(rec.seq.length(), kmerSize,
+				Probe(*m_filtersSingle.at(filterID)), cache, threshold,
+				antiThreshold, currentLoc, score))
 		{
 			hits[filterID] = true;
 			break;
@@ -836,54 +1034,32 @@ void BioBloomClassifier::evaluateReadCollab(const FastqRecord &rec,
  * Faster variant that assume there a redundant tile of 0
  */
 void BioBloomClassifier::evaluateReadMin(const FastqRecord &rec,
-		const string &hashSig, unordered_map<string, bool> &hits)
+		const PackedRead &read, const string &hashSig,
+		unordered_map<string, bool> &hits)
 {
 	//get filterIDs to iterate through has in a consistent order
 	const vector<string> &idsInFilter = (*m_filters[hashSig]).getFilterIds();
 
 	//get kmersize for set of info files
-	unsigned kmerSize = m_infoFiles.at(hashSig).front()->getKmerSize();
-
-	unordered_map<string, unsigned> tempHits;
-
-	//Establish tiling pattern
-	unsigned startModifier1 = (rec.seq.length() % kmerSize) / 2;
-	size_t currentKmerNum = 0;
-
-	for (vector<string>::const_iterator i = idsInFilter.begin();
-			i != idsInFilter.end(); ++i)
-	{
-		tempHits[*i] = 0;
-	}
+	const BloomFilterInfo &info = *m_infoFiles.at(hashSig).front();
+	unsigned kmerSize = info.getKmerSize();
 
+	//tiles are hashed once for all filters
 	ReadsProcessor proc(kmerSize);
-	//cut read into kmer size given
-	while (rec.seq.length() >= (currentKmerNum + 1) * kmerSize) {
+	proc.setSpacedSeed(info.getSpacedSeed());
+	proc.setRead(read);
+	vector<bool> visited;
+	vector<vector<size_t> > hashValues;
+	initHashCache(rec, kmerSize, visited, hashValues);
+	SeqEval::ReuseHashes cache(rec.seq, kmerSize, info.getHashNum(), visited,
+			hashValues, proc);
 
-		const unsigned char* currentKmer = proc.prepSeq(rec.seq,
-				currentKmerNum * kmerSize + startModifier1);
-
-		//check to see if string is invalid
-		if (currentKmer != NULL) {
-
-			const unordered_map<string, bool> &results =
-					m_filters[hashSig]->multiContains(currentKmer);
-
-			//record hit number in order
-			for (vector<string>::const_iterator i = idsInFilter.begin();
-					i != idsInFilter.end(); ++i)
-			{
-				if (results.at(*i)) {
-					++tempHits[*i];
-				}
-			}
-		}
-		++currentKmerNum;
-	}
 	for (vector<string>::const_iterator i = idsInFilter.begin();
 			i != idsInFilter.end(); ++i)
 	{
-		hits[*i] = tempHits.at(*i) >= m_minHit;
+		hits[*i] = SeqEval::screenCore(rec.seq.length(), kmerSize,
+				SeqEval::FilterProbe<BloomFilter>(*m_filtersSingle.at(*i)),
+				cache, m_minHit) >= m_minHit;
 	}
 }
 
@@ -892,116 +1068,141 @@ void BioBloomClassifier::evaluateReadMin(const FastqRecord &rec,
  * Sections with ambiguity bases are treated as misses
  */
 void BioBloomClassifier::evaluateReadStd(const FastqRecord &rec,
-		const string &hashSig, unordered_map<string, bool> &hits)
+		const PackedRead &read, const string &hashSig,
+		unordered_map<string, bool> &hits)
 {
 
 	//get filterIDs to iterate through has in a consistent order
 	const vector<string> &idsInFilter = (*m_filters[hashSig]).getFilterIds();
 
-	unsigned kmerSize = m_infoFiles.at(hashSig).front()->getKmerSize();
-
-	//todo: read proc possibly unneeded, see evalSingle
-	ReadsProcessor proc(kmerSize);
+	const BloomFilterInfo &info = *m_infoFiles.at(hashSig).front();
+	unsigned kmerSize = info.getKmerSize();
 
 	double normalizationValue = rec.seq.length() - kmerSize + 1;
 	double threshold = m_scoreThreshold * normalizationValue;
 	size_t antiThreshold = static_cast<size_t>((1.0 - m_scoreThreshold) * normalizationValue);
 
+	//filters of a hash signature share k-mer hash values, which subtraction
+	//filters and repeat masks reuse
+	bool shared = idsInFilter.size() > 1 || !m_subtractFilters.empty()
+			|| !m_repeatMasks.empty();
+	ReadsProcessor proc(kmerSize);
+	proc.setSpacedSeed(info.getSpacedSeed());
+	proc.setRead(read);
+	vector<bool> visited;
+	vector<vector<size_t> > hashValues;
+	if (shared) {
+		initHashCache(rec, kmerSize, visited, hashValues);
+	}
+
+	SeqEval::ReuseHashes sharedCache(rec.seq, kmerSize, info.getHashNum(),
+			visited, hashValues, proc);
+	SeqEval::SharedNoHashCache cache(rec.seq, proc);
+
 	for (vector<string>::const_iterator i = idsInFilter.begin();
 			i != idsInFilter.end(); ++i)
 	{
-		bool pass = false;
-		hits[*i] = false;
-		if (m_minHit > 0) {
-			unsigned screeningHits = 0;
-			size_t screeningLoc = rec.seq.length() % kmerSize / 2;
-			//First pass filtering
-			while (rec.seq.length() >= screeningLoc + kmerSize) {
-				const unsigned char* currentKmer = proc.prepSeq(rec.seq,
-						screeningLoc);
-				if (currentKmer != NULL) {
-					if (m_filtersSingle.at(*i)->contains(currentKmer)) {
-						screeningHits++;
-						if (screeningHits >= m_minHit) {
-							pass = true;
-							break;
-						}
-					}
-				}
-				screeningLoc += kmerSize;
-			}
+		SeqEval::SubtractProbe<BloomFilter> probe(*m_filtersSingle.at(*i),
+				getSubtract(*i), getRepeats(*i));
+		unsigned currentLoc = 0;
+		double score = 0;
+		if (shared) {
+			hits[*i] = screenAndEval(rec.seq.length(), kmerSize, probe,
+					sharedCache, m_minHit, threshold, antiThreshold,
+					currentLoc, score);
 		} else {
-			pass = true;
-		}
-		if (pass) {
-			BloomFilter &tempFilter = *m_filtersSingle.at(*i);
-			hits[*i] = SeqEval::evalSingle(rec, kmerSize, tempFilter, threshold, antiThreshold);
+			hits[*i] = screenAndEval(rec.seq.length(), kmerSize, probe, cache,
+					m_minHit, threshold, antiThreshold, currentLoc, score);
 		}
 	}
 }
 
 /*
- * For a single read evaluate hits for a single hash signature
+ * For a single read evaluate hits for all hash signatures
  * Sections with ambiguity bases are treated as misses
- * Reads are assigned to best hit
+ * Reads are assigned to best hit (score normalized by number of k-mers)
+ * Filters are evaluated in lockstep, dropping filters whose reachable score
+ * falls below the score of the current leader (see SeqEval::bestHit)
  */
 double BioBloomClassifier::evaluateReadBestHit(const FastqRecord &rec,
-		const string &hashSig, unordered_map<string, bool> &hits)
+		unordered_map<string, bool> &hits)
 {
-	//get filterIDs to iterate through has in a consistent order
-	const vector<string> &idsInFilter = (*m_filters[hashSig]).getFilterIds();
+	typedef SeqEval::ExhaustEval<SeqEval::SubtractProbe<BloomFilter>,
+			SeqEval::ReuseHashes> Eval;
 
-	vector<string> bestFilters;
-	double maxScore = 0;
+	//hash values are shared by the filters of each hash signature
+	//and k-mers of all sizes are taken from a single encoding of the read
+	PackedRead read(rec.seq);
+	unsigned sigNum = m_hashSigs.size();
+#if _OPENMP
+	BestHitState &state = m_bestHitStates[omp_get_thread_num()];
+#else
+	BestHitState &state = m_bestHitStates[0];
+#endif
+	vector<vector<bool> > &visited = state.visited;
+	vector<vector<vector<size_t> > > &hashValues = state.hashValues;
+	vector<boost::shared_ptr<ReadsProcessor> > &procs = state.procs;
+	vector<boost::shared_ptr<SeqEval::ReuseHashes> > &caches = state.caches;
+	if (procs.empty()) {
+		visited.resize(sigNum);
+		hashValues.resize(sigNum);
+		procs.resize(sigNum);
+		caches.resize(sigNum);
+		for (unsigned j = 0; j < sigNum; ++j) {
+			const BloomFilterInfo &info =
+					*m_infoFiles.at(m_hashSigs[j]).front();
+			procs[j].reset(new ReadsProcessor(info.getKmerSize()));
+			procs[j]->setSpacedSeed(info.getSpacedSeed());
+			caches[j].reset(
+					new SeqEval::ReuseHashes(rec.seq, info.getKmerSize(),
+							info.getHashNum(), visited[j], hashValues[j],
+							*procs[j]));
+		}
+	}
 
-	unsigned kmerSize = m_infoFiles.at(hashSig).front()->getKmerSize();
+	vector<Eval> evals;
+	vector<string> evalIDs;
 
-	ReadsProcessor proc(kmerSize);
+	for (unsigned j = 0; j < sigNum; ++j) {
+		const BloomFilterInfo &info = *m_infoFiles.at(m_hashSigs[j]).front();
+		unsigned kmerSize = info.getKmerSize();
+		initHashCache(rec, kmerSize, visited[j], hashValues[j]);
+		procs[j]->setRead(read);
+		caches[j]->setSeq(rec.seq);
 
-	for (unsigned i = 0; i < idsInFilter.size(); ++i) {
-		bool pass = false;
-		hits[idsInFilter[i]] = false;
-		if (m_minHit > 0) {
-			unsigned screeningHits = 0;
-			size_t screeningLoc = rec.seq.length() % kmerSize / 2;
-			//First pass filtering
-			while (rec.seq.length() >= screeningLoc + kmerSize) {
-				const unsigned char* currentKmer = proc.prepSeq(rec.seq,
-						screeningLoc);
-				if (currentKmer != NULL) {
-					if (m_filtersSingle.at(idsInFilter[i])->contains(
-							currentKmer))
-					{
-						screeningHits++;
-						if (screeningHits >= m_minHit) {
-							pass = true;
-							break;
-						}
-					}
-				}
-				screeningLoc += kmerSize;
-			}
-		} else {
-			pass = true;
-		}
-		if (pass) {
-			BloomFilter &tempFilter = *m_filtersSingle.at(idsInFilter[i]);
-			double score = SeqEval::evalSingleExhaust(rec, kmerSize, tempFilter);
-			if (maxScore < score) {
-				maxScore = score;
-				bestFilters.clear();
-				bestFilters.push_back(idsInFilter[i]);
-			} else if (maxScore == score) {
-				bestFilters.push_back(idsInFilter[i]);
+		//get filterIDs to iterate through has in a consistent order
+		const vector<string> &idsInFilter =
+				(*m_filters[m_hashSigs[j]]).getFilterIds();
+		for (vector<string>::const_iterator i = idsInFilter.begin();
+				i != idsInFilter.end(); ++i)
+		{
+			hits[*i] = false;
+			const BloomFilter &tempFilter = *m_filtersSingle.at(*i);
+			const BloomFilter *subtract = getSubtract(*i);
+			const BloomFilter *repeats = getRepeats(*i);
+			SeqEval::SubtractProbe<BloomFilter> probe(tempFilter, subtract,
+					repeats);
+			if (m_minHit == 0
+					|| SeqEval::screenCore(rec.seq.length(), kmerSize, probe,
+							*caches[j], m_minHit) >= m_minHit)
+			{
+				evals.push_back(
+						Eval(rec.seq.length(), kmerSize, probe, *caches[j]));
+				evalIDs.push_back(*i);
 			}
 		}
 	}
-	if (maxScore > 0) {
-		for (unsigned i = 0; i < bestFilters.size(); ++i) {
-			hits[bestFilters[i]] = true;
-		}
+
+	vector<bool> best;
+	double leaderScore = SeqEval::bestHit(evals, best, true);
+	for (unsigned i = 0; i < evals.size(); ++i) {
+		hits[evalIDs[i]] = best[i];
 	}
-	return maxScore / (rec.seq.length() - kmerSize + 1);
+	//processors are kept for the next read, the encoding of this one is not
+	for (unsigned j = 0; j < sigNum; ++j) {
+		procs[j]->clearRead();
+	}
+	return leaderScore;
 }
 
 /*
@@ -1011,15 +1212,17 @@ double BioBloomClassifier::evaluateReadBestHit(const FastqRecord &rec,
  * Will return partial score if threshold is not met
  */
 void BioBloomClassifier::evaluateReadScore(const FastqRecord &rec,
-		const string &hashSig, unordered_map<string, bool> &hits, vector<double> &scores)
+		const PackedRead &read, const string &hashSig,
+		unordered_map<string, bool> &hits, vector<double> &scores)
 {
 	//get filterIDs to iterate through has in a consistent order
 	const vector<string> &idsInFilter = (*m_filters[hashSig]).getFilterIds();
 
 	unsigned kmerSize = m_infoFiles.at(hashSig).front()->getKmerSize();
 
-	//todo: read proc possibly unneeded, see evalSingle
 	ReadsProcessor proc(kmerSize);
+	proc.setSpacedSeed(m_infoFiles.at(hashSig).front()->getSpacedSeed());
+	proc.setRead(read);
 
 	size_t normalizationValue = rec.seq.length() - kmerSize + 1;
 	double threshold = m_scoreThreshold * normalizationValue;
@@ -1027,64 +1230,222 @@ void BioBloomClassifier::evaluateReadScore(const FastqRecord &rec,
 
 	unsigned hitCount = 0;
 
-	vector<vector<size_t> > hashValues(normalizationValue);
-	vector<bool> visited(normalizationValue);
+	vector<vector<size_t> > hashValues;
+	vector<bool> visited;
+	initHashCache(rec, kmerSize, visited, hashValues);
+
+	SeqEval::ReuseHashes cache(rec.seq, kmerSize,
+			m_infoFiles.at(hashSig).front()->getHashNum(), visited, hashValues,
+			proc);
 
 	//position of sequences
 	vector<unsigned> pos(idsInFilter.size(), 0);
 
 	//first pass
 	for (unsigned i = 0; i < idsInFilter.size(); ++i) {
-		bool pass = false;
-		hits[idsInFilter[i]] = false;
-		if (m_minHit > 0) {
-			unsigned screeningHits = 0;
-			size_t screeningLoc = rec.seq.length() % kmerSize / 2;
-			//First pass filtering
-			while (rec.seq.length() >= screeningLoc + kmerSize) {
-				const unsigned char* currentKmer = proc.prepSeq(rec.seq,
-						screeningLoc);
-				if (currentKmer != NULL) {
-					if (m_filtersSingle.at(idsInFilter[i])->contains(
-							currentKmer))
-					{
-						screeningHits++;
-						if (screeningHits >= m_minHit) {
-							pass = true;
-							break;
-						}
-					}
-				}
-				screeningLoc += kmerSize;
-			}
-		} else {
-			pass = true;
-		}
-		if (pass) {
-			BloomFilter &tempFilter = *m_filtersSingle.at(idsInFilter[i]);
-
-			//Evaluate sequences until threshold
-			//record end location
-			hits[idsInFilter[i]] = SeqEval::eval(rec, kmerSize, tempFilter, threshold,
-					antiThreshold, visited, hashValues, pos[i], scores[i], proc);
-			hitCount += hits[idsInFilter[i]];
-		}
+		SeqEval::SubtractProbe<BloomFilter> probe(
+				*m_filtersSingle.at(idsInFilter[i]),
+				getSubtract(idsInFilter[i]), getRepeats(idsInFilter[i]));
+		//Evaluate sequences until threshold
+		//record end location
+		hits[idsInFilter[i]] = screenAndEval(rec.seq.length(), kmerSize,
+				probe, cache, m_minHit, threshold, antiThreshold, pos[i],
+				scores[i]);
+		hitCount += hits[idsInFilter[i]];
 	}
 
 	//final pass if more than 2 reach threshold
 	if (hitCount > 1) {
 		for (unsigned i = 0; i < idsInFilter.size(); ++i) {
-			BloomFilter &tempFilter = *m_filtersSingle.at(idsInFilter[i]);
+			SeqEval::SubtractProbe<BloomFilter> probe(
+					*m_filtersSingle.at(idsInFilter[i]),
+					getSubtract(idsInFilter[i]), getRepeats(idsInFilter[i]));
 
 			//Evaluate sequences until threshold
 			//record end location
-			SeqEval::eval(rec, kmerSize, tempFilter, normalizationValue, 0, visited, hashValues,
-					pos[i], scores[i], proc);
+			SeqEval::evalCore(rec.seq.length(), kmerSize, probe, cache,
+					normalizationValue, 0, pos[i], scores[i]);
 			scores[i] /= normalizationValue;
 		}
 	}
 }
 
+/*
+ * For a single read evaluate hits for a single hash signature of filters
+ * made of minimizers (see MinimizerSampler)
+ * Only minimizers of the read are queried, a filter is hit if the fraction
+ * of minimizers found reaches the score threshold
+ */
+void BioBloomClassifier::evaluateReadSampled(const FastqRecord &rec,
+		const PackedRead &read, const string &hashSig,
+		unordered_map<string, bool> &hits, vector<double> &scores)
+{
+	//get filterIDs to iterate through has in a consistent order
+	const vector<string> &idsInFilter = (*m_filters[hashSig]).getFilterIds();
+
+	const BloomFilterInfo &info = *m_infoFiles.at(hashSig).front();
+	unsigned kmerSize = info.getKmerSize();
+
+	//hash values of minimizers are shared by all filters
+	ReadsProcessor proc(kmerSize);
+	proc.setSpacedSeed(info.getSpacedSeed());
+	proc.setRead(read);
+	MinimizerSampler sampler(kmerSize, info.getMinimizerWindow());
+	vector<vector<size_t> > hashValues;
+	for (size_t i = 0; i + kmerSize <= rec.seq.length(); ++i) {
+		if (sampler.add(proc.prepSeq(rec.seq, i))) {
+			hashValues.push_back(
+					multiHash(sampler.getMinimizer(), info.getHashNum(),
+							kmerSize));
+		}
+	}
+
+	double threshold = max(m_scoreThreshold * hashValues.size(), 1.0);
+	double antiThreshold = hashValues.size() - threshold;
+
+	for (unsigned i = 0; i < idsInFilter.size(); ++i) {
+		const BloomFilter &tempFilter = *m_filtersSingle.at(idsInFilter[i]);
+		unsigned hitCount = 0;
+		unsigned missCount = 0;
+		for (vector<vector<size_t> >::const_iterator j = hashValues.begin();
+				j != hashValues.end(); ++j)
+		{
+			if (tempFilter.contains(*j)) {
+				//scores need all minimizers
+				if (++hitCount >= threshold && m_mode != SCORES) {
+					break;
+				}
+			} else if (++missCount > antiThreshold && m_mode != SCORES) {
+				break;
+			}
+		}
+		hits[idsInFilter[i]] = hitCount >= threshold;
+		if (m_mode == SCORES && !hashValues.empty()) {
+			scores[i] = double(hitCount) / hashValues.size();
+		}
+	}
+}
+
+/*
+ * Sizes the per-read hash value cache shared by filters of a hash signature
+ */
+void BioBloomClassifier::initHashCache(const FastqRecord &rec,
+		unsigned kmerSize, vector<bool> &visited,
+		vector<vector<size_t> > &hashValues) const
+{
+	size_t kmerCount =
+			rec.seq.length() >= kmerSize ? rec.seq.length() - kmerSize + 1 : 0;
+	visited.assign(kmerCount, false);
+	hashValues.assign(kmerCount, vector<size_t>());
+}
+
+/*
+ * Opens read output files of each filter, multiMatch and noMatch
+ */
+void BioBloomClassifier::openOutputFiles(
+		unordered_map<string, boost::shared_ptr<Dynamicofstream> > &outputFiles,
+		const string &outputType)
+{
+	boost::shared_ptr<Dynamicofstream> no_match(
+			new Dynamicofstream(
+					m_prefix + "_" + NO_MATCH + "." + outputType + m_postfix));
+	boost::shared_ptr<Dynamicofstream> multi_match(
+			new Dynamicofstream(
+					m_prefix + "_" + MULTI_MATCH + "." + outputType
+							+ m_postfix));
+	outputFiles[NO_MATCH] = no_match;
+	outputFiles[MULTI_MATCH] = multi_match;
+
+	//initialize variables
+	for (vector<string>::const_iterator j = m_hashSigs.begin();
+			j != m_hashSigs.end(); ++j)
+	{
+		const vector<string> idsInFilter = (*m_filters[*j]).getFilterIds();
+		for (vector<string>::const_iterator i = idsInFilter.begin();
+				i != idsInFilter.end(); ++i)
+		{
+			boost::shared_ptr<Dynamicofstream> temp(
+					new Dynamicofstream(
+							m_prefix + "_" + *i + "." + outputType
+									+ m_postfix));
+			outputFiles[*i] = temp;
+		}
+	}
+}
+
+void BioBloomClassifier::closeOutputFiles(
+		unordered_map<string, boost::shared_ptr<Dynamicofstream> > &outputFiles,
+		const string &outputType)
+{
+	for (unordered_map<string, boost::shared_ptr<Dynamicofstream> >::iterator j =
+			outputFiles.begin(); j != outputFiles.end(); ++j)
+	{
+		j->second->close();
+		cerr << "File written to: "
+				<< m_prefix + "_" + j->first + "." + outputType + m_postfix
+				<< endl;
+	}
+}
+
+/*
+ * Filter ID a single read or window is assigned to, without updating summary
+ */
+const string BioBloomClassifier::getAssignment(
+		const unordered_map<string, bool> &hits) const
+{
+	string filterID = NO_MATCH;
+	for (vector<string>::const_iterator i = m_filterOrder.begin();
+			i != m_filterOrder.end(); ++i)
+	{
+		if (hits.at(*i)) {
+			if (filterID != NO_MATCH) {
+				return MULTI_MATCH;
+			}
+			filterID = *i;
+		}
+	}
+	return filterID;
+}
+
+/*
+ * Read level hits from the windows [first, last) of a read
+ * Filters with the most uniquely assigned windows are hits. If no window is
+ * uniquely assigned, filters hit by any window are hits (i.e. multiMatch)
+ * scores are set to the fraction of windows hit by each filter
+ * Returns fraction of windows uniquely assigned to the consensus
+ */
+double BioBloomClassifier::getConsensus(
+		const vector<unordered_map<string, bool> > &windowHits,
+		const vector<string> &windowIDs, size_t first, size_t last,
+		unordered_map<string, bool> &hits, vector<double> &scores) const
+{
+	unordered_map<string, unsigned> uniqueCounts;
+	unsigned maxCount = 0;
+	for (size_t i = first; i < last; ++i) {
+		if (windowIDs[i] != NO_MATCH && windowIDs[i] != MULTI_MATCH) {
+			maxCount = max(maxCount, ++uniqueCounts[windowIDs[i]]);
+		}
+	}
+	double windowNum = last - first;
+	for (unsigned j = 0; j < m_filterOrder.size(); ++j) {
+		const string &filterID = m_filterOrder[j];
+		unsigned hitCount = 0;
+		for (size_t i = first; i < last; ++i) {
+			hitCount += windowHits[i].at(filterID);
+		}
+		scores[j] = hitCount / windowNum;
+		if (maxCount > 0) {
+			unordered_map<string, unsigned>::const_iterator count =
+					uniqueCounts.find(filterID);
+			hits[filterID] = count != uniqueCounts.end()
+					&& count->second == maxCount;
+		} else {
+			hits[filterID] = hitCount > 0;
+		}
+	}
+	return maxCount / windowNum;
+}
+
 void BioBloomClassifier::setMainFilter(const string &filtername)
 {
 	if (m_filtersSingle.find(filtername) == m_filtersSingle.end()) {
@@ -1101,6 +1462,144 @@ void BioBloomClassifier::setMainFilter(const string &filtername)
 	m_mainFilter = filtername;
 }
 
+/*
+ * Loads filters whose k-mers are treated as misses (i.e. of a host shared by
+ * all targets), given as FILTER.bf for all filters or FILTERID:FILTER.bf for
+ * a single filter. Each file is loaded once.
+ * Subtraction filters are probed with the hash values of the filter they
+ * apply to, so they need the same k-mer size and spaced seed and at most as
+ * many hash functions.
+ */
+void BioBloomClassifier::setSubtractFilters(
+		const vector<string> &subtractFilters)
+{
+	if (m_mode == COLLAB || m_mode == MINHITONLY) {
+		cerr << "Subtraction filters cannot be used with -c or -o." << endl;
+		exit(1);
+	}
+	unordered_map<string, boost::shared_ptr<BloomFilter> > loaded;
+	for (vector<string>::const_iterator it = subtractFilters.begin();
+			it != subtractFilters.end(); ++it)
+	{
+		size_t split = it->find(':');
+		string path = split == string::npos ? *it : it->substr(split + 1);
+		string targetID = split == string::npos ? "" : it->substr(0, split);
+		if (!targetID.empty()
+				&& m_filtersSingle.find(targetID) == m_filtersSingle.end())
+		{
+			cerr << "Filter with this name \"" << targetID
+					<< "\" does not exist" << endl;
+			exit(1);
+		}
+		if (!fexists(path)) {
+			cerr << "Error: " + path + " File cannot be opened" << endl;
+			exit(1);
+		}
+		BloomFilterFile filterFile(path);
+		const BloomFilterInfo &info = filterFile.getInfo();
+		if (info.getMinimizerWindow() > 0) {
+			cerr << "Error: Minimizer filters cannot be used as subtraction "
+					"filters: " << path << endl;
+			exit(1);
+		}
+		if (loaded.find(path) == loaded.end()) {
+			loaded[path] = boost::shared_ptr<BloomFilter>(
+					new BloomFilter(info.getCalcuatedFilterSize(),
+							info.getHashNum(), info.getKmerSize(), path));
+			cerr << "Loaded Subtraction Filter: " + info.getFilterID() << endl;
+		}
+
+		for (vector<string>::const_iterator i = m_hashSigs.begin();
+				i != m_hashSigs.end(); ++i)
+		{
+			const vector<boost::shared_ptr<BloomFilterInfo> > &infos =
+					m_infoFiles.at(*i);
+			for (vector<boost::shared_ptr<BloomFilterInfo> >::const_iterator j =
+					infos.begin(); j != infos.end(); ++j)
+			{
+				const BloomFilterInfo &target = **j;
+				if (!targetID.empty() && target.getFilterID() != targetID) {
+					continue;
+				}
+				if (target.getMinimizerWindow() > 0) {
+					cerr << "Error: Subtraction filters cannot be applied to "
+							"minimizer filters: " << target.getFilterID()
+							<< endl;
+					exit(1);
+				}
+				if (info.getKmerSize() != target.getKmerSize()
+						|| info.getSpacedSeed() != target.getSpacedSeed()
+						|| info.getHashNum() > target.getHashNum())
+				{
+					cerr << "Error: " << path
+							<< " cannot be subtracted from "
+							<< target.getFilterID()
+							<< ". Subtraction filters need the same k-mer size "
+									"and spaced seed and at most as many hash "
+									"functions." << endl;
+					exit(1);
+				}
+				if (m_subtractFilters.find(target.getFilterID())
+						!= m_subtractFilters.end())
+				{
+					cerr << "Error: More than one subtraction filter given for "
+							<< target.getFilterID()
+							<< ". Filters can be combined with biobloommaker "
+									"-M." << endl;
+					exit(1);
+				}
+				m_subtractFilters[target.getFilterID()] = loaded[path];
+			}
+		}
+	}
+}
+
+/*
+ * k-mers counted more than maxAbundance times in the reference of a filter
+ * (see biobloommaker -A) are treated as misses
+ * The counts stored next to each filter are turned into a mask of one bit
+ * per counter, set for counters above maxAbundance. A k-mer is in the mask
+ * only if all its counters are, so exactly when its count (the smallest of
+ * its counters) is above maxAbundance. The mask is then probed like a
+ * subtraction filter.
+ */
+void BioBloomClassifier::setMaxAbundance(unsigned maxAbundance)
+{
+	if (m_mode == COLLAB || m_mode == MINHITONLY) {
+		cerr << "Abundance limits cannot be used with -c or -o." << endl;
+		exit(1);
+	}
+	for (vector<string>::const_iterator i = m_hashSigs.begin();
+			i != m_hashSigs.end(); ++i)
+	{
+		const vector<boost::shared_ptr<BloomFilterInfo> > &infos =
+				m_infoFiles.at(*i);
+		for (vector<boost::shared_ptr<BloomFilterInfo> >::const_iterator j =
+				infos.begin(); j != infos.end(); ++j)
+		{
+			const BloomFilterInfo &info = **j;
+			if (info.getAbundanceCounters() == 0) {
+				cerr << "Warning: " << info.getFilterID()
+						<< " has no k-mer counts (biobloommaker -A), all its "
+								"k-mers are used." << endl;
+				continue;
+			}
+			const string &path = m_filterPaths.at(info.getFilterID());
+			string countsPath = path.substr(0, path.length() - 2) + "counts";
+			boost::shared_ptr<BloomFilter> mask(
+					new BloomFilter(info.getAbundanceCounters(),
+							info.getHashNum(), info.getKmerSize()));
+			{
+				CountingBloomFilter counts(info.getAbundanceCounters(),
+						info.getHashNum(), countsPath);
+				counts.maskAbove(maxAbundance, *mask);
+			}
+			m_repeatMasks[info.getFilterID()] = mask;
+			cerr << "Loaded K-mer Counts: " + countsPath << endl;
+		}
+	}
+}
+
 BioBloomClassifier::~BioBloomClassifier()
 {
 }
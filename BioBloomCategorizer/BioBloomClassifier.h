@@ -9,6 +9,7 @@
 #define BIOBLOOMCLASSIFIER_H_
 #include <vector>
 #include <string>
+#include <sstream>
 #include "boost/unordered/unordered_map.hpp"
 #include "boost/shared_ptr.hpp"
 #include "Common/BloomFilterInfo.h"
@@ -20,6 +21,7 @@
 #include "ResultsManager.h"
 #include "Common/Dynamicofstream.h"
 #include "Common/SeqEval.h"
+#include "ReadCache.h"
 
 using namespace std;
 using namespace boost;
@@ -43,6 +45,8 @@ public:
 	void filter(const vector<string> &inputFiles);
 	void filterPrint(const vector<string> &inputFiles,
 			const string &outputType);
+	void filterWindowed(const vector<string> &inputFiles,
+			const string &outputType);
 	void filterPair(const string &file1, const string &file2);
 	void filterPairPrint(const string &file1, const string &file2,
 			const string &outputType);
@@ -52,6 +56,14 @@ public:
 	void setCollabFilter()
 	{
 		m_mode = COLLAB;
+		if (m_sampled) {
+			cerr << "Minimizer filters cannot be used with -c." << endl;
+			exit(1);
+		}
+		if (m_spaced) {
+			cerr << "Spaced seed filters cannot be used with -c." << endl;
+			exit(1);
+		}
 		if (m_hashSigs.size() != 1) {
 			cerr
 					<< "To use collaborative filtering all filters must use the same k and same number of hash functions."
@@ -65,7 +77,30 @@ public:
 		m_inclusive = true;
 	}
 
+	/*
+	 * Classify reads in windows of windowSize bp (see filterWindowed)
+	 */
+	void setWindowSize(size_t windowSize)
+	{
+		m_windowSize = windowSize;
+	}
+
+	/*
+	 * Reuse classification of reads identical to a previous read
+	 */
+	void setReadCache(size_t capacity)
+	{
+		m_readCache.reset(new ReadCache(capacity));
+	}
+
+	void setAssignOutput()
+	{
+		m_assign = true;
+	}
+
 	void setMainFilter(const string &filtername);
+	void setSubtractFilters(const vector<string> &subtractFilters);
+	void setMaxAbundance(unsigned maxAbundance);
 
 	virtual ~BioBloomClassifier();
 
@@ -74,6 +109,13 @@ private:
 	unordered_map<string, vector<boost::shared_ptr<BloomFilterInfo> > > m_infoFiles;
 	unordered_map<string, boost::shared_ptr<MultiFilter> > m_filters;
 	unordered_map<string, boost::shared_ptr<BloomFilter> > m_filtersSingle;
+	//filters whose k-mers are treated as misses, by ID of the filter they
+	//apply to (filters given more than once are shared)
+	unordered_map<string, boost::shared_ptr<BloomFilter> > m_subtractFilters;
+	//k-mers of each filter occurring too often in its reference (see
+	//setMaxAbundance)
+	unordered_map<string, boost::shared_ptr<BloomFilter> > m_repeatMasks;
+	unordered_map<string, string> m_filterPaths;
 	vector<string> m_filterOrder;
 	vector<string> m_hashSigs;
 	double m_scoreThreshold;
@@ -88,18 +130,80 @@ private:
 	string m_mainFilter;
 	bool m_inclusive;
 
+	//compact per-read assignment output (read ordinal and filter index)
+	bool m_assign;
+	boost::shared_ptr<Dynamicofstream> m_assignOutput;
+	unordered_map<string, unsigned> m_filterIndex;
+	boost::shared_ptr<ReadCache> m_readCache;
+	size_t m_windowSize;
+	//true if any filter is made of minimizers
+	bool m_sampled;
+	//true if any filter uses a spaced seed
+	bool m_spaced;
+
+	//state of best hit evaluation of a thread, created on its first read and
+	//reset for each following read
+	struct BestHitState {
+		vector<vector<bool> > visited;
+		vector<vector<vector<size_t> > > hashValues;
+		vector<boost::shared_ptr<ReadsProcessor> > procs;
+		vector<boost::shared_ptr<SeqEval::ReuseHashes> > caches;
+	};
+	vector<BestHitState> m_bestHitStates;
+
+	//windows evaluated per thread in each batch of windowed mode
+	static const size_t s_windowsPerThread = 64;
+
 	void loadFilters(const vector<string> &filterFilePaths);
+
+	/*
+	 * Subtraction filter of a filter, NULL if there is none
+	 */
+	const BloomFilter *getSubtract(const string &filterID) const
+	{
+		unordered_map<string, boost::shared_ptr<BloomFilter> >::const_iterator it =
+				m_subtractFilters.find(filterID);
+		return it == m_subtractFilters.end() ? NULL : it->second.get();
+	}
+
+	/*
+	 * Mask of repetitive k-mers of a filter, NULL if there is none
+	 */
+	const BloomFilter *getRepeats(const string &filterID) const
+	{
+		unordered_map<string, boost::shared_ptr<BloomFilter> >::const_iterator it =
+				m_repeatMasks.find(filterID);
+		return it == m_repeatMasks.end() ? NULL : it->second.get();
+	}
+	void openAssignOutput();
+	void closeAssignOutput();
 	bool fexists(const string &filename) const;
-	void evaluateReadStd(const FastqRecord &rec, const string &hashSig,
-			unordered_map<string, bool> &hits);
-	void evaluateReadMin(const FastqRecord &rec, const string &hashSig,
-			unordered_map<string, bool> &hits);
+	void evaluateReadStd(const FastqRecord &rec, const PackedRead &read,
+			const string &hashSig, unordered_map<string, bool> &hits);
+	void evaluateReadMin(const FastqRecord &rec, const PackedRead &read,
+			const string &hashSig, unordered_map<string, bool> &hits);
 	void evaluateReadCollab(const FastqRecord &rec, const string &hashSig,
 			unordered_map<string, bool> &hits);
-	double evaluateReadBestHit(const FastqRecord &rec, const string &hashSig,
+	double evaluateReadBestHit(const FastqRecord &rec,
 			unordered_map<string, bool> &hits);
-	void evaluateReadScore(const FastqRecord &rec, const string &hashSig,
-			unordered_map<string, bool> &hits, vector<double> &scores);
+	void evaluateReadScore(const FastqRecord &rec, const PackedRead &read,
+			const string &hashSig, unordered_map<string, bool> &hits,
+			vector<double> &scores);
+	void openOutputFiles(
+			unordered_map<string, boost::shared_ptr<Dynamicofstream> > &outputFiles,
+			const string &outputType);
+	void closeOutputFiles(
+			unordered_map<string, boost::shared_ptr<Dynamicofstream> > &outputFiles,
+			const string &outputType);
+	const string getAssignment(const unordered_map<string, bool> &hits) const;
+	double getConsensus(const vector<unordered_map<string, bool> > &windowHits,
+			const vector<string> &windowIDs, size_t first, size_t last,
+			unordered_map<string, bool> &hits, vector<double> &scores) const;
+	void evaluateReadSampled(const FastqRecord &rec, const PackedRead &read,
+			const string &hashSig, unordered_map<string, bool> &hits,
+			vector<double> &scores);
+	void initHashCache(const FastqRecord &rec, unsigned kmerSize,
+			vector<bool> &visited, vector<vector<size_t> > &hashValues) const;
 
 	inline void printSingle(const FastqRecord &rec, double score,
 			const string &filterID)
@@ -120,6 +224,56 @@ private:
 		}
 	}
 
+	/*
+	 * Writes read ordinal, index of assigned filter and optionally scores
+	 * Filter indexes are listed in the header of the assignment file
+	 */
+	inline void printAssign(size_t ordinal, const string &filterID,
+			double score, const vector<double> &scores)
+	{
+		if (m_assign) {
+			stringstream line;
+			line << ordinal << "\t" << m_filterIndex.at(filterID);
+			appendScores(line, score, scores);
+			line << "\n";
+#pragma omp critical(assignOutput)
+			{
+				(*m_assignOutput) << line.str();
+			}
+		}
+	}
+
+	inline void printAssign(size_t ordinal, const string &filterID,
+			double score1, double score2, const vector<double> &scores1,
+			const vector<double> &scores2)
+	{
+		if (m_assign) {
+			stringstream line;
+			line << ordinal << "\t" << m_filterIndex.at(filterID);
+			appendScores(line, score1, scores1);
+			appendScores(line, score2, scores2);
+			line << "\n";
+#pragma omp critical(assignOutput)
+			{
+				(*m_assignOutput) << line.str();
+			}
+		}
+	}
+
+	inline void appendScores(stringstream &line, double score,
+			const vector<double> &scores) const
+	{
+		if (m_mode == SCORES) {
+			for (vector<double>::const_iterator i = scores.begin();
+					i != scores.end(); ++i)
+			{
+				line << "\t" << *i;
+			}
+		} else if (m_mode == BESTHIT) {
+			line << "\t" << score;
+		}
+	}
+
 	inline void printSingleToFile(const string &outputFileName,
 			const FastqRecord &rec,
 			unordered_map<string, boost::shared_ptr<Dynamicofstream> > &outputFiles,
@@ -293,28 +447,65 @@ private:
 		}
 	}
 
-	inline void evaluateRead(const FastqRecord &rec, const string &hashSig,
-			unordered_map<string, bool> &hits, double &score, vector<double> &scores)
+	/*
+	 * Evaluates read against filters of all hash signatures, or copies the
+	 * result of an identical read from the read cache
+	 */
+	inline void evaluateRead(const FastqRecord &rec,
+			unordered_map<string, bool> &hits, double &score,
+			vector<double> &scores)
 	{
+		ReadCache::Result cached;
+		if (m_readCache && m_readCache->lookup(rec.seq, cached)) {
+			hits = cached.hits;
+			score = cached.score;
+			scores = cached.scores;
+			return;
+		}
+		if (m_mode == BESTHIT) {
+			//best hit compares filters of all hash signatures at once
+			score = evaluateReadBestHit(rec, hits);
+		} else {
+			//read is encoded once for the k-mer sizes of all hash signatures
+			PackedRead read(rec.seq);
+			//for each hashSigniture/kmer combo multi, cut up read into kmer sized used
+			for (vector<string>::const_iterator j = m_hashSigs.begin();
+					j != m_hashSigs.end(); ++j)
+			{
+				evaluateRead(rec, read, *j, hits, scores);
+			}
+		}
+		if (m_readCache) {
+			cached.hits = hits;
+			cached.score = score;
+			cached.scores = scores;
+			m_readCache->store(rec.seq, cached);
+		}
+	}
+
+	inline void evaluateRead(const FastqRecord &rec, const PackedRead &read,
+			const string &hashSig, unordered_map<string, bool> &hits,
+			vector<double> &scores)
+	{
+		if (m_sampled && m_infoFiles.at(hashSig).front()->getMinimizerWindow()) {
+			evaluateReadSampled(rec, read, hashSig, hits, scores);
+			return;
+		}
 		switch(m_mode) {
 		case COLLAB:{
 			evaluateReadCollab(rec, hashSig, hits);
 			break;
 		}
 		case MINHITONLY: {
-			evaluateReadMin(rec, hashSig, hits);
-			break;
-		}
-		case BESTHIT: {
-			score = evaluateReadBestHit(rec, hashSig, hits);
+			evaluateReadMin(rec, read, hashSig, hits);
 			break;
 		}
 		case SCORES: {
-			evaluateReadScore(rec, hashSig, hits, scores);
+			evaluateReadScore(rec, read, hashSig, hits, scores);
 			break;
 		}
 		default: {
-			evaluateReadStd(rec, hashSig, hits);
+			evaluateReadStd(rec, read, hashSig, hits);
 			break;
 		}
 		}
@@ -0,0 +1,160 @@
+/*
+ * BioBloomExtractor.cpp
+ *
+ * Extracts the reads of a single category from the original input files
+ * using the compact assignment file (--assign) of biobloomcategorizer
+ *
+ *  Created on: Oct 18, 2026
+ */
+#include <sstream>
+#include <string>
+#include <getopt.h>
+#include <iostream>
+#include <vector>
+#include "DataLayer/Options.h"
+#include "ReadExtractor.h"
+#include "config.h"
+
+using namespace std;
+
+#define PROGRAM "biobloomextractor"
+
+void printVersion()
+{
+	const char VERSION_MESSAGE[] = PROGRAM " (" PACKAGE_NAME ") " VERSION "\n";
+	cerr << VERSION_MESSAGE << endl;
+	exit(EXIT_SUCCESS);
+}
+
+void printHelpDialog()
+{
+	const char dialog[] =
+	"Usage: biobloomextractor [OPTION]... -a [ASSIGN_FILE] -c [CATEGORY] [FILE]...\n"
+	"biobloomextractor [OPTION]... -e -a [ASSIGN_FILE] -c [CATEGORY] [FILE1.fq] [FILE2.fq]\n"
+	"Extracts the reads assigned to a category from the original input files given\n"
+	"to biobloomcategorizer, using the assignment file created with --assign.\n"
+	"Input files must be given in the same order and with the same read filtering\n"
+	"options (-l, --chastity) used when categorizing. Reads are written to stdout.\n"
+	"\n"
+	"  -a, --assign_file=N    Assignment file created by biobloomcategorizer.\n"
+	"                         Required option.\n"
+	"  -c, --category=N       Filter ID, multiMatch or noMatch. Required option.\n"
+	"  -e, --paired_mode      Input is a pair of files. Pairs are output interlaced.\n"
+	"      --fa               Output reads in Fasta format.\n"
+	"      --chastity         Discard and do not evaluate unchaste reads.\n"
+	"      --no-chastity      Do not discard unchaste reads. [default]\n"
+	"  -l  --length_cutoff=N  Discard reads shorter that the cutoff N. [0]\n"
+	"  -v  --version          Display version information.\n"
+	"  -h, --help             Display this dialog.\n"
+	"Report bugs to <cjustin@bcgsc.ca>.";
+
+	cerr << dialog << endl;
+	exit(EXIT_SUCCESS);
+}
+
+int main(int argc, char *argv[])
+{
+	opt::chastityFilter = 0;
+	opt::trimMasked = 0;
+
+	//switch statement variable
+	int c;
+
+	//control variables
+	bool die = false;
+
+	//command line variables
+	string assignFile = "";
+	string category = "";
+	bool paired = false;
+	int fasta = 0;
+
+	//long form arguments
+	static struct option long_options[] = { {
+		"assign_file", required_argument, NULL, 'a' }, {
+		"category", required_argument, NULL, 'c' }, {
+		"paired_mode", no_argument, NULL, 'e' }, {
+		"fa", no_argument, &fasta, 1 }, {
+		"chastity", no_argument, &opt::chastityFilter, 1 }, {
+		"no-chastity", no_argument, &opt::chastityFilter, 0 }, {
+		"length_cutoff", required_argument, NULL, 'l' }, {
+		"version", no_argument, NULL, 'v' }, {
+		"help", no_argument, NULL, 'h' }, {
+		NULL, 0, NULL, 0 } };
+
+	int option_index = 0;
+	while ((c = getopt_long(argc, argv, "a:c:el:vh", long_options,
+			&option_index)) != -1)
+	{
+		switch (c) {
+		case 'a': {
+			assignFile = optarg;
+			break;
+		}
+		case 'c': {
+			category = optarg;
+			break;
+		}
+		case 'e': {
+			paired = true;
+			break;
+		}
+		case 'l': {
+			stringstream convert(optarg);
+			if (!(convert >> opt::minLength)) {
+				cerr << "Error - Invalid parameter! l: " << optarg << endl;
+				exit(EXIT_FAILURE);
+			}
+			break;
+		}
+		case 'v': {
+			printVersion();
+			break;
+		}
+		case 'h': {
+			printHelpDialog();
+			break;
+		}
+		case '?': {
+			die = true;
+			break;
+		}
+		}
+	}
+
+	vector<string> inputFiles;
+	while (optind < argc) {
+		inputFiles.push_back(argv[optind]);
+		optind++;
+	}
+
+	//Check needed options
+	if (inputFiles.size() == 0) {
+		cerr << "Error: Need Input File" << endl;
+		die = true;
+	}
+	if (assignFile.empty()) {
+		cerr << "Error: Need Assignment File (-a)" << endl;
+		die = true;
+	}
+	if (category.empty()) {
+		cerr << "Error: Need Category (-c)" << endl;
+		die = true;
+	}
+	if (paired && inputFiles.size() != 2) {
+		cerr << "Error: Paired mode requires exactly two input files" << endl;
+		die = true;
+	}
+	if (die) {
+		cerr << "Try '--help' for more information.\n";
+		exit(EXIT_FAILURE);
+	}
+
+	ReadExtractor extractor(assignFile, category);
+	size_t extracted = paired ?
+			extractor.extractPairs(inputFiles[0], inputFiles[1], cout, fasta) :
+			extractor.extract(inputFiles, cout, fasta);
+	cout.flush();
+	cerr << "Reads extracted: " << extracted << endl;
+	return 0;
+}
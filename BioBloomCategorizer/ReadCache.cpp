@@ -0,0 +1,110 @@
+/*
+ * ReadCache.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "ReadCache.h"
+#include <sstream>
+#include "Common/city.h"
+
+ReadCache::ReadCache(size_t capacity) :
+		m_shards(new Shard[s_shardNum]), m_shardCapacity(
+				capacity / s_shardNum > 0 ? capacity / s_shardNum : 1), m_lookups(
+				0), m_hits(0), m_evictions(0)
+{
+	for (unsigned i = 0; i < s_shardNum; ++i) {
+		m_shards[i].order.resize(m_shardCapacity);
+		m_shards[i].next = 0;
+#if _OPENMP
+		omp_init_lock(&m_shards[i].lock);
+#endif
+	}
+}
+
+ReadCache::Shard &ReadCache::getShard(uint64_t fingerprint)
+{
+	//low bits are used by the hash table of the shard
+	return m_shards[(fingerprint >> 58) % s_shardNum];
+}
+
+/*
+ * Copies cached result of sequence into result
+ * Returns false if sequence was not cached
+ */
+bool ReadCache::lookup(const string &seq, Result &result)
+{
+	uint64_t fingerprint = CityHash64(seq.c_str(), seq.length());
+	Shard &shard = getShard(fingerprint);
+	bool found = false;
+	__sync_fetch_and_add(&m_lookups, 1);
+#if _OPENMP
+	omp_set_lock(&shard.lock);
+#endif
+	unordered_map<uint64_t, Entry>::const_iterator it = shard.entries.find(
+			fingerprint);
+	//full sequence is compared to rule out fingerprint collisions
+	if (it != shard.entries.end() && it->second.seq == seq) {
+		result = it->second.result;
+		found = true;
+	}
+#if _OPENMP
+	omp_unset_lock(&shard.lock);
+#endif
+	if (found) {
+		__sync_fetch_and_add(&m_hits, 1);
+	}
+	return found;
+}
+
+/*
+ * Caches result of sequence, evicting the oldest entry of the shard if full
+ */
+void ReadCache::store(const string &seq, const Result &result)
+{
+	uint64_t fingerprint = CityHash64(seq.c_str(), seq.length());
+	Shard &shard = getShard(fingerprint);
+#if _OPENMP
+	omp_set_lock(&shard.lock);
+#endif
+	unordered_map<uint64_t, Entry>::iterator it = shard.entries.find(
+			fingerprint);
+	if (it == shard.entries.end()) {
+		if (shard.entries.size() >= m_shardCapacity) {
+			shard.entries.erase(shard.order[shard.next]);
+			__sync_fetch_and_add(&m_evictions, 1);
+		}
+		shard.order[shard.next] = fingerprint;
+		shard.next = (shard.next + 1) % m_shardCapacity;
+		it = shard.entries.insert(make_pair(fingerprint, Entry())).first;
+	}
+	it->second.seq = seq;
+	it->second.result = result;
+#if _OPENMP
+	omp_unset_lock(&shard.lock);
+#endif
+}
+
+/*
+ * Summary of cache use, appended to the summary file
+ */
+const string ReadCache::getSummary() const
+{
+	stringstream summaryOutput;
+	summaryOutput << "cache_id\tlookups\thits\tevictions\trate_hit\n";
+	summaryOutput << "read_cache\t" << m_lookups << "\t" << m_hits << "\t"
+			<< m_evictions << "\t"
+			<< (m_lookups > 0 ? double(m_hits) / double(m_lookups) : 0.0)
+			<< "\n";
+	return summaryOutput.str();
+}
+
+ReadCache::~ReadCache()
+{
+#if _OPENMP
+	for (unsigned i = 0; i < s_shardNum; ++i) {
+		omp_destroy_lock(&m_shards[i].lock);
+	}
+#endif
+	delete[] m_shards;
+}
@@ -0,0 +1,73 @@
+/*
+ * ReadCache.h
+ *
+ * Bounded cache of read classifications keyed by a fingerprint of the read
+ * sequence, so that duplicate reads are only evaluated once
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef READCACHE_H_
+#define READCACHE_H_
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include "boost/unordered/unordered_map.hpp"
+#if _OPENMP
+# include <omp.h>
+#endif
+
+using namespace std;
+using namespace boost;
+
+class ReadCache {
+public:
+	/*
+	 * Outcome of evaluating a read against all filters
+	 */
+	struct Result {
+		unordered_map<string, bool> hits;
+		double score;
+		vector<double> scores;
+	};
+
+	explicit ReadCache(size_t capacity);
+
+	bool lookup(const string &seq, Result &result);
+	void store(const string &seq, const Result &result);
+
+	const string getSummary() const;
+
+	virtual ~ReadCache();
+private:
+	struct Entry {
+		string seq;
+		Result result;
+	};
+
+	//cache is split into independently locked shards to limit contention
+	struct Shard {
+		unordered_map<uint64_t, Entry> entries;
+		//insertion order of keys, oldest entry is evicted first
+		vector<uint64_t> order;
+		size_t next;
+#if _OPENMP
+		omp_lock_t lock;
+#endif
+	};
+
+	ReadCache(const ReadCache& that); //to prevent copy construction
+
+	Shard &getShard(uint64_t fingerprint);
+
+	static const unsigned s_shardNum = 64;
+	Shard *m_shards;
+	size_t m_shardCapacity;
+
+	size_t m_lookups;
+	size_t m_hits;
+	size_t m_evictions;
+};
+
+#endif /* READCACHE_H_ */
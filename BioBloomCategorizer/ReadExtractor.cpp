@@ -0,0 +1,154 @@
+/*
+ * ReadExtractor.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "ReadExtractor.h"
+#include <sstream>
+#include <fstream>
+#include <cstdlib>
+#include "Common/Uncompress.h"
+
+/*
+ * Loads the reads of category (a filter ID, multiMatch or noMatch) from the
+ * assignment file (which may be compressed)
+ */
+ReadExtractor::ReadExtractor(const string &assignFile, const string &category)
+{
+	loadAssignments(assignFile, category);
+}
+
+/*
+ * Reads the assignment file and marks the ordinals of reads in the category
+ */
+void ReadExtractor::loadAssignments(const string &assignFile,
+		const string &category)
+{
+	ifstream assignStream(assignFile.c_str());
+	if (!assignStream) {
+		cerr << "Error: " << assignFile << " File cannot be opened" << endl;
+		exit(1);
+	}
+	string line;
+	unsigned categoryIndex = 0;
+	bool categoryFound = false;
+	while (getline(assignStream, line)) {
+		if (line.empty()) {
+			continue;
+		}
+		if (line[0] == '#') {
+			//header lists filter IDs in order of their indexes
+			stringstream header(line);
+			string field;
+			header >> field;
+			if (field == "#filters") {
+				for (unsigned i = 0; header >> field; ++i) {
+					if (field == category) {
+						categoryIndex = i;
+						categoryFound = true;
+					}
+				}
+				if (!categoryFound) {
+					cerr << "Error: category \"" << category
+							<< "\" is not listed in " << assignFile << endl;
+					exit(1);
+				}
+			}
+			continue;
+		}
+		if (!categoryFound) {
+			cerr << "Error: " << assignFile
+					<< " does not have a filter header" << endl;
+			exit(1);
+		}
+		stringstream converter(line);
+		size_t ordinal;
+		unsigned index;
+		if (!(converter >> ordinal >> index)) {
+			cerr << "Error: malformed line in " << assignFile << "\n" << line
+					<< endl;
+			exit(1);
+		}
+		if (index == categoryIndex) {
+			if (ordinal >= m_selected.size()) {
+				m_selected.resize(ordinal + 1, false);
+			}
+			m_selected[ordinal] = true;
+		}
+	}
+}
+
+/*
+ * Writes the reads of the category in inputFiles (in the order they were
+ * categorized) to out
+ * Returns the number of reads extracted
+ */
+size_t ReadExtractor::extract(const vector<string> &inputFiles, ostream &out,
+		bool fasta) const
+{
+	size_t ordinal = 0;
+	size_t extracted = 0;
+	for (vector<string>::const_iterator it = inputFiles.begin();
+			it != inputFiles.end() && ordinal < m_selected.size(); ++it)
+	{
+		FastaReader sequence(it->c_str(), FastaReader::NO_FOLD_CASE);
+		for (FastqRecord rec;
+				ordinal < m_selected.size() && sequence >> rec; ++ordinal)
+		{
+			if (m_selected[ordinal]) {
+				printRead(rec, out, fasta);
+				++extracted;
+			}
+		}
+		sequence.breakClose();
+	}
+	checkEnd(ordinal);
+	return extracted;
+}
+
+/*
+ * Writes the pairs of reads of the category in file1 and file2 to out,
+ * interlaced
+ * Returns the number of pairs extracted
+ */
+size_t ReadExtractor::extractPairs(const string &file1, const string &file2,
+		ostream &out, bool fasta) const
+{
+	size_t ordinal = 0;
+	size_t extracted = 0;
+	FastaReader sequence1(file1.c_str(), FastaReader::NO_FOLD_CASE);
+	FastaReader sequence2(file2.c_str(), FastaReader::NO_FOLD_CASE);
+	FastqRecord rec1;
+	FastqRecord rec2;
+	while (ordinal < m_selected.size() && sequence1 >> rec1
+			&& sequence2 >> rec2)
+	{
+		if (m_selected[ordinal]) {
+			printRead(rec1, out, fasta);
+			printRead(rec2, out, fasta);
+			++extracted;
+		}
+		++ordinal;
+	}
+	sequence1.breakClose();
+	sequence2.breakClose();
+	checkEnd(ordinal);
+	return extracted;
+}
+
+/*
+ * Warns if input ended at ordinal before the last read of the category
+ */
+void ReadExtractor::checkEnd(size_t ordinal) const
+{
+	if (ordinal < m_selected.size()) {
+		cerr << "Warning: input ended at read " << ordinal
+				<< " before the last assigned read " << m_selected.size() - 1
+				<< ". Check input files and order." << endl;
+	}
+}
+
+ReadExtractor::~ReadExtractor()
+{
+}
@@ -0,0 +1,51 @@
+/*
+ * ReadExtractor.h
+ *
+ * Extracts the reads of a single category from the original input files
+ * using the compact assignment file (--assign) of biobloomcategorizer
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef READEXTRACTOR_H_
+#define READEXTRACTOR_H_
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include "DataLayer/FastaReader.h"
+
+using namespace std;
+
+class ReadExtractor {
+public:
+	explicit ReadExtractor(const string &assignFile, const string &category);
+
+	size_t extract(const vector<string> &inputFiles, ostream &out,
+			bool fasta) const;
+	size_t extractPairs(const string &file1, const string &file2,
+			ostream &out, bool fasta) const;
+
+	virtual ~ReadExtractor();
+private:
+	ReadExtractor(const ReadExtractor& that); //to prevent copy construction
+
+	void loadAssignments(const string &assignFile, const string &category);
+	void checkEnd(size_t ordinal) const;
+
+	//reads in the category, by ordinal
+	vector<bool> m_selected;
+
+	inline void printRead(const FastqRecord &rec, ostream &out,
+			bool fasta) const
+	{
+		if (fasta || rec.qual.empty()) {
+			out << ">" << rec.id << "\n" << rec.seq << "\n";
+		} else {
+			out << "@" << rec.id << "\n" << rec.seq << "\n+\n" << rec.qual
+					<< "\n";
+		}
+	}
+};
+
+#endif /* READEXTRACTOR_H_ */
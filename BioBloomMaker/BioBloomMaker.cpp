@@ -9,8 +9,13 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <cstdio>
 #include "BloomFilterGenerator.h"
+#include "BloomFilterMerger.h"
+#include "BloomFilterFolder.h"
 #include "Common/BloomFilterInfo.h"
+#include "Common/BloomFilterFile.h"
+#include "Common/ReadsProcessor.h"
 #include <boost/unordered/unordered_map.hpp>
 #include <getopt.h>
 #include "config.h"
@@ -40,6 +45,11 @@ void printHelpDialog() {
 	static const char dialog[] =
 		"Usage: biobloommaker -p [FILTERID] [OPTION]... [FILE]...\n"
 		"Usage: biobloommaker -p [FILTERID] -r 0.2 [FILE]... [FASTQ1] [FASTQ2] \n"
+		"Usage: biobloommaker -p [FILTERID] -M [FILTER.bf]...\n"
+		"Usage: biobloommaker -p [FILTERID] -O difference [FILTER.bf]...\n"
+		"Usage: biobloommaker -p [FILTERID] -q 3 [FASTQ]...\n"
+		"Usage: biobloommaker -p [FILTERID] -H 1 [FILTER.bf]\n"
+		"Usage: biobloommaker -a 1000000 [FILTER.bf]...\n"
 		"Creates a bf and txt file from a list of fasta files. The input sequences are\n"
 		"cut into a k-mers with a sliding window and their hash signatures are inserted\n"
 		"into a bloom filter.\n"
@@ -49,7 +59,8 @@ void printHelpDialog() {
 		"  -h, --help             Display this dialog.\n"
 		"  -v  --version          Display version information.\n"
 		"  -t, --threads=N        The number of threads to use. Experimental. [1]\n"
-		"                         Currently only active with the (-r) option.\n"
+		"                         Currently only active with the (-r), (-e), (-M),\n"
+		"                         (-H), (-q), (-F), (-z) and (-a) options.\n"
 		"\nAdvanced options:\n"
 		"  -f, --fal_pos_rate=N   Maximum false positive rate to use in filter. [0.0075]\n"
 		"  -g, --hash_num=N       Set number of hash functions to use in filter instead\n"
@@ -62,17 +73,208 @@ void printHelpDialog() {
 		"                         wish to create.\n"
 		"  -n, --num_ele=N        Set the number of expected elements. If set to 0 number\n"
 		"                         is determined from sequences sizes within files. [0]\n"
+		"  -e, --estimate         Determine the number of expected elements from an\n"
+		"                         estimate of the number of distinct k-mers in the\n"
+		"                         files (extra pass over files). Recommended for\n"
+		"                         redundant sequences. Cannot be used with (-n).\n"
 		"  -r, --progressive=N    Progressive filter creation. After initial seeding,\n"
 		"                         filter is created by greedly incorporating reads\n"
 		"                         into filter according to score threshold of N.\n"
 		"  -i, --inclusive        If one paired read matches, both reads will be included\n"
 		"                         in the filter. Only active with the (-r) option.\n"
+		"  -d, --deterministic    Make the same filter regardless of the number of\n"
+		"                         threads (-t). Reads are evaluated in parallel in\n"
+		"                         batches and inserted in input order. Only active\n"
+		"                         with the (-r) option.\n"
+		"  -w, --minimizer=N      Only insert minimizers of windows of N k-mers. Creates\n"
+		"                         a filter about (N+1)/2 times smaller, for fast coarse\n"
+		"                         screening. Cannot be used with (-s) or (-r).\n"
+		"  -m, --spaced_seed=N    Spaced seed mask of 1s (bases used) and 0s (bases\n"
+		"                         ignored) applied to each k-mer, eg. 1101011 for k=7.\n"
+		"                         Must be symmetric, start with 1 and have length k.\n"
+		"                         Cannot be used with (-s) or (-r).\n"
+		"  -u, --update=N         Path to an existing filter (a single file or with its\n"
+		"                         txt file in the same directory) into which the\n"
+		"                         sequences of the input files are inserted. The\n"
+		"                         updated filter keeps the size, k-mer size and hash\n"
+		"                         functions of the existing one.\n"
+		"                         Cannot be used with (-s), (-r), (-n) or (-e).\n"
+		"  -S, --shard=I/N        Only insert the I-th of N disjoint subsets of the\n"
+		"                         sequences (split by sequence, or by file for files\n"
+		"                         without an index), eg. 1/4. Every shard has the size\n"
+		"                         of a filter of all sequences, run once for each I\n"
+		"                         with the same files and options and merge the\n"
+		"                         shards with (-M). Cannot be used with (-r), (-u)\n"
+		"                         or (-e).\n"
+		"  -M, --merge            Input files are filters (single files or with their\n"
+		"                         txt files in the same directory) of the same size,\n"
+		"                         k-mer size and hash functions, eg. shards, to combine\n"
+		"                         into one filter.\n"
+		"  -O, --operation=N      Combine the input filters as with (-M) into their\n"
+		"                         union, intersection (k-mers in all filters) or\n"
+		"                         difference (k-mers of the first filter not in the\n"
+		"                         others). The difference is approximate: k-mers of\n"
+		"                         the first filter sharing bits with the others are\n"
+		"                         removed as well, the fraction removed is printed.\n"
+		"                         If it is over 5% the difference is not written;\n"
+		"                         use biobloomcategorizer --subtract instead.\n"
+		"                         [union]\n"
+		"  -x, --force            Write the difference (-O difference) even if over 5%\n"
+		"                         of the k-mers of the first filter are removed with it.\n"
+		"  -H, --fold=N           Input file is a filter (a single file or with its txt\n"
+		"                         file in the same directory) to shrink to 1/2^N of\n"
+		"                         its size without rebuilding it, eg. a filter larger\n"
+		"                         than needed. The folded filter is the same as one\n"
+		"                         built with the smaller size. Cannot be used with\n"
+		"                         (-s), (-r), (-u), (-S), (-M), (-q) or (-a).\n"
+		"  -F, --single_file      Output the filter and its information as a single .bf\n"
+		"                         file, with a binary header and checksums verified\n"
+		"                         when the filter is loaded, instead of a bf and a txt\n"
+		"                         file.\n"
+		"  -z, --compress         Output a single file (-F) in which blocks of the filter\n"
+		"                         with few (or many) bits set are compressed, eg. for\n"
+		"                         filters larger than needed. Smaller to copy, but\n"
+		"                         cannot be memory mapped.\n"
+		"  -C, --checkpoint=N     Save the filter and progress of the build every N\n"
+		"                         seconds to [FILTERID].ckpt.txt and .bf files in the\n"
+		"                         output directory, so that an interrupted build can\n"
+		"                         be resumed with (-R). Checkpoints are removed once\n"
+		"                         the filter is complete. [0 (off)]\n"
+		"  -R, --resume           Continue an interrupted build from its last\n"
+		"                         checkpoint, using the same files and options.\n"
+		"                         Checkpoints cannot be used with (-q), (-M), (-H) or\n"
+		"                         with (-s) without (-r).\n"
+		"  -q, --solid=N          Input files are reads (FastQ or FastA). Only k-mers\n"
+		"                         seen at least N times (max 255) are inserted, so\n"
+		"                         k-mers of sequencing errors are left out. K-mers are\n"
+		"                         counted in a first pass, which also estimates the\n"
+		"                         number of expected elements unless (-n) is set.\n"
+		"                         Cannot be used with (-s), (-r), (-w), (-u), (-S),\n"
+		"                         (-M) or (-e).\n"
+		"  -A, --abundance        Also count how many times each k-mer occurs in the\n"
+		"                         files and store the counts as [FILTERID].counts, so\n"
+		"                         biobloomcategorizer can leave out repetitive k-mers\n"
+		"                         (--max_abundance). Cannot be used with (-s), (-r),\n"
+		"                         (-w), (-u), (-S), (-M), (-H), (-q), (-a) or\n"
+		"                         checkpoints (-C, -R).\n"
+		"  -c, --counters=N       Number of counters (bytes of memory) used to count\n"
+		"                         k-mers with (-q) or (-A). More counters give more\n"
+		"                         accurate counts. [268435456]\n"
+		"  -a, --stats=N          Input files are filters. Measure the fraction of bits\n"
+		"                         set in each filter and the false positive rate of N\n"
+		"                         random k-mers (none if N is 0), write them to the\n"
+		"                         information of the filter and print them as a table.\n"
+		"                         No prefix (-p) is needed.\n"
 		"\n"
 		"Report bugs to <cjustin@bcgsc.ca>.";
 	cerr << dialog << endl;
 	exit(0);
 }
 
+/*
+ * Outputs the information of a filter as a txt file next to the bf file, or
+ * combines both into a single file (compressed or not)
+ */
+void storeInfo(const BloomFilterInfo &info, const string &filterPath,
+		bool singleFile, bool compress) {
+	if (singleFile || compress) {
+		BloomFilterFile::store(filterPath + ".bf", info, compress);
+	} else {
+		info.printInfoFile(filterPath + ".txt");
+	}
+}
+
+/*
+ * Measures the occupancy (and false positive rate of random k-mers) of
+ * filters, writes the measurements into their information and prints them
+ */
+int measureFilters(const vector<string> &filterFiles, size_t queries) {
+	BloomFilterInfo::printStatsHeader(cout);
+	for (vector<string>::const_iterator i = filterFiles.begin();
+			i != filterFiles.end(); ++i) {
+		if (i->length() < 3 || i->substr(i->length() - 3) != ".bf") {
+			cerr << "Error: Filter to measure must end in .bf: " << *i << endl;
+			exit(1);
+		}
+		BloomFilterFile file(*i);
+		BloomFilterInfo info(file.getInfo());
+		BloomFilter filter(info.getCalcuatedFilterSize(), info.getHashNum(),
+				info.getKmerSize(), *i);
+		info.measure(filter, queries);
+		if (file.isSingleFile()) {
+			//rewritten next to the filter, which is only replaced once done
+			string rawPath = *i + ".raw";
+			filter.storeFilter(rawPath);
+			BloomFilterFile::store(rawPath, info, file.isCompressed());
+			if (rename(rawPath.c_str(), i->c_str()) != 0) {
+				cerr << "file \"" << *i << "\" could not be written." << endl;
+				exit(1);
+			}
+		} else {
+			info.printInfoFile(i->substr(0, i->length() - 2) + "txt");
+		}
+		info.printStats(cout);
+	}
+	return 0;
+}
+
+/*
+ * Inserts sequences of files into an existing filter, which keeps the
+ * parameters it was created with, and outputs it under a new prefix
+ */
+int updateExisting(const string &existingFilter,
+		const vector<string> &inputFiles, const string &filterPrefix,
+		const string &outputDir, unsigned checkpointInterval, bool resume,
+		bool singleFile, bool compress) {
+	if (existingFilter.length() < 3
+			|| existingFilter.substr(existingFilter.length() - 3) != ".bf") {
+		cerr << "Error: Filter to update must end in .bf: " << existingFilter
+				<< endl;
+		exit(1);
+	}
+	//info is in the filter or in the info file next to it
+	BloomFilterInfo info(BloomFilterFile(existingFilter).getInfo());
+	size_t oldEntries = info.getTotalNum();
+	size_t oldRedundancy = info.getRedundancy();
+
+	//size is given so files do not need to be counted
+	BloomFilterGenerator filterGen(inputFiles, info.getKmerSize(),
+			info.getHashNum(), info.getExpectedNum());
+	filterGen.setMinimizerWindow(info.getMinimizerWindow());
+	filterGen.setSpacedSeed(info.getSpacedSeed());
+	filterGen.setFilterSize(info.getCalcuatedFilterSize());
+	if (checkpointInterval > 0 || resume) {
+		filterGen.setCheckpoint(outputDir + filterPrefix, checkpointInterval,
+				resume);
+	}
+	cerr << "Updating filter " << existingFilter << " of "
+			<< info.getCalcuatedFilterSize() << " bits" << endl;
+
+	size_t redundNum = filterGen.update(outputDir + filterPrefix + ".bf",
+			existingFilter);
+
+	info.setFilterID(filterPrefix);
+	info.addSeqSrcs(inputFiles);
+	//counts of the existing filter do not include the new sequences
+	info.setAbundanceCounters(0);
+	info.setTotalNum(oldEntries + filterGen.getTotalEntries());
+	info.setRedundancy(oldRedundancy + redundNum);
+	cerr << "Inserted " << filterGen.getTotalEntries() << " new entries ("
+			<< info.getTotalNum() << " in total)" << endl;
+
+	if (info.getFPR() > info.getDesiredFPR()) {
+		cerr << "Warning: The approximate false positive rate of the updated "
+				"filter (" << info.getFPR()
+				<< ") exceeds the desired false positive rate ("
+				<< info.getDesiredFPR()
+				<< "). Consider rebuilding the filter from all sequences." << endl;
+	}
+
+	storeInfo(info, outputDir + filterPrefix, singleFile, compress);
+	cerr << "Filter Update Complete." << endl;
+	return 0;
+}
+
 int main(int argc, char *argv[]) {
 
 	bool die = false;
@@ -90,6 +292,26 @@ int main(int argc, char *argv[]) {
 	size_t entryNum = 0;
 	double progressive = -1;
 	bool inclusive = false;
+	bool deterministic = false;
+	unsigned minimizerWindow = 0;
+	string spacedSeed = "";
+	bool estimate = false;
+	string updateFilter = "";
+	unsigned shard = 0;
+	unsigned shardNum = 0;
+	bool mergeFilters = false;
+	bool force = false;
+	BloomFilterMerger::Operation operation = BloomFilterMerger::UNION;
+	unsigned folds = 0;
+	unsigned minCount = 0;
+	unsigned checkpointInterval = 0;
+	bool resume = false;
+	size_t counterNum = size_t(1) << 28;
+	bool singleFile = false;
+	bool compress = false;
+	bool stats = false;
+	bool abundance = false;
+	size_t statsQueries = 0;
 
 	//long form arguments
 	static struct option long_options[] = {
@@ -99,6 +321,7 @@ int main(int argc, char *argv[]) {
 					"output_dir", required_argument, NULL, 'o' }, {
 					"threads", required_argument, NULL, 't' }, {
 					"inclusive", no_argument, NULL, 'i' }, {
+					"deterministic", no_argument, NULL, 'd' }, {
 					"version", no_argument, NULL, 'v' }, {
 					"hash_num", required_argument, NULL, 'g' }, {
 					"kmer_size", required_argument, NULL, 'k' }, {
@@ -106,11 +329,28 @@ int main(int argc, char *argv[]) {
 					"num_ele", required_argument, NULL, 'n' }, {
 					"help", no_argument, NULL, 'h' }, {
 					"progressive", required_argument, NULL, 'r' }, {
+					"minimizer", required_argument, NULL, 'w' }, {
+					"spaced_seed", required_argument, NULL, 'm' }, {
+					"estimate", no_argument, NULL, 'e' }, {
+					"update", required_argument, NULL, 'u' }, {
+					"shard", required_argument, NULL, 'S' }, {
+					"merge", no_argument, NULL, 'M' }, {
+					"operation", required_argument, NULL, 'O' }, {
+					"force", no_argument, NULL, 'x' }, {
+					"fold", required_argument, NULL, 'H' }, {
+					"single_file", no_argument, NULL, 'F' }, {
+					"compress", no_argument, NULL, 'z' }, {
+					"checkpoint", required_argument, NULL, 'C' }, {
+					"resume", no_argument, NULL, 'R' }, {
+					"solid", required_argument, NULL, 'q' }, {
+					"counters", required_argument, NULL, 'c' }, {
+					"abundance", no_argument, NULL, 'A' }, {
+					"stats", required_argument, NULL, 'a' }, {
 					NULL, 0, NULL, 0 } };
 
 	//actual checking step
 	int option_index = 0;
-	while ((c = getopt_long(argc, argv, "f:p:o:k:n:g:hvs:n:t:r:i", long_options,
+	while ((c = getopt_long(argc, argv, "f:p:o:k:n:g:hvs:n:t:r:idw:m:eu:S:MO:xH:FzC:Rq:c:Aa:", long_options,
 			&option_index)) != -1) {
 		switch (c) {
 		case 'f': {
@@ -149,6 +389,10 @@ int main(int argc, char *argv[]) {
 			inclusive = true;
 			break;
 		}
+		case 'd': {
+			deterministic = true;
+			break;
+		}
 		case 'k': {
 			stringstream convert(optarg);
 			if (!(convert >> kmerSize)) {
@@ -207,6 +451,125 @@ int main(int argc, char *argv[]) {
 			}
 			break;
 		}
+		case 'w': {
+			stringstream convert(optarg);
+			if (!(convert >> minimizerWindow) || minimizerWindow == 0) {
+				cerr << "Error - Invalid set of bloom filter parameters! w: "
+						<< optarg << endl;
+				exit(EXIT_FAILURE);
+			}
+			break;
+		}
+		case 'm': {
+			spacedSeed = optarg;
+			break;
+		}
+		case 'e': {
+			estimate = true;
+			break;
+		}
+		case 'u': {
+			updateFilter = optarg;
+			break;
+		}
+		case 'S': {
+			stringstream convert(optarg);
+			char slash = 0;
+			if (!(convert >> shard >> slash >> shardNum) || slash != '/'
+					|| shard == 0 || shard > shardNum) {
+				cerr << "Error - Invalid set of bloom filter parameters! S: "
+						<< optarg << endl;
+				exit(EXIT_FAILURE);
+			}
+			break;
+		}
+		case 'M': {
+			mergeFilters = true;
+			break;
+		}
+		case 'O': {
+			string name = optarg;
+			if (name == "union") {
+				operation = BloomFilterMerger::UNION;
+			} else if (name == "intersection") {
+				operation = BloomFilterMerger::INTERSECTION;
+			} else if (name == "difference") {
+				operation = BloomFilterMerger::DIFFERENCE;
+			} else {
+				cerr << "Error - Invalid set of bloom filter parameters! O: "
+						<< optarg << endl;
+				exit(EXIT_FAILURE);
+			}
+			mergeFilters = true;
+			break;
+		}
+		case 'x': {
+			force = true;
+			break;
+		}
+		case 'H': {
+			stringstream convert(optarg);
+			if (!(convert >> folds) || folds == 0) {
+				cerr << "Error - Invalid set of bloom filter parameters! H: "
+						<< optarg << endl;
+				exit(EXIT_FAILURE);
+			}
+			break;
+		}
+		case 'F': {
+			singleFile = true;
+			break;
+		}
+		case 'z': {
+			compress = true;
+			break;
+		}
+		case 'C': {
+			stringstream convert(optarg);
+			if (!(convert >> checkpointInterval)) {
+				cerr << "Error - Invalid set of bloom filter parameters! C: "
+						<< optarg << endl;
+				exit(EXIT_FAILURE);
+			}
+			break;
+		}
+		case 'R': {
+			resume = true;
+			break;
+		}
+		case 'q': {
+			stringstream convert(optarg);
+			if (!(convert >> minCount) || minCount == 0
+					|| minCount > CountingBloomFilter::s_maxCount) {
+				cerr << "Error - Invalid set of bloom filter parameters! q: "
+						<< optarg << endl;
+				exit(EXIT_FAILURE);
+			}
+			break;
+		}
+		case 'c': {
+			stringstream convert(optarg);
+			if (!(convert >> counterNum) || counterNum == 0) {
+				cerr << "Error - Invalid set of bloom filter parameters! c: "
+						<< optarg << endl;
+				exit(EXIT_FAILURE);
+			}
+			break;
+		}
+		case 'A': {
+			abundance = true;
+			break;
+		}
+		case 'a': {
+			stringstream convert(optarg);
+			if (!(convert >> statsQueries)) {
+				cerr << "Error - Invalid set of bloom filter parameters! a: "
+						<< optarg << endl;
+				exit(EXIT_FAILURE);
+			}
+			stats = true;
+			break;
+		}
 		default: {
 			die = true;
 			break;
@@ -232,7 +595,7 @@ int main(int argc, char *argv[]) {
 		cerr << "Need Input File" << endl;
 		die = true;
 	}
-	if (filterPrefix.size() == 0) {
+	if (filterPrefix.size() == 0 && !stats) {
 		cerr << "Need Filter Prefix ID" << endl;
 		die = true;
 	}
@@ -240,11 +603,125 @@ int main(int argc, char *argv[]) {
 		cerr << "Prefix ID cannot have '/' characters" << endl;
 		die = true;
 	}
+	if (minimizerWindow > 0 && (!subtractFilter.empty() || progressive != -1)) {
+		cerr << "Minimizer filters (-w) cannot be made with (-s) or (-r)" << endl;
+		die = true;
+	}
+	if (estimate && entryNum != 0) {
+		cerr << "(-e) cannot be used with (-n)" << endl;
+		die = true;
+	}
+	if (!updateFilter.empty()
+			&& (!subtractFilter.empty() || progressive != -1 || entryNum != 0
+					|| estimate)) {
+		cerr << "(-u) cannot be used with (-s), (-r), (-n) or (-e)" << endl;
+		die = true;
+	}
+	if (mergeFilters
+			&& (!subtractFilter.empty() || progressive != -1
+					|| !updateFilter.empty() || shardNum > 0)) {
+		cerr << "(-M) cannot be used with (-s), (-r), (-u) or (-S)" << endl;
+		die = true;
+	}
+	if (force && operation != BloomFilterMerger::DIFFERENCE) {
+		cerr << "(-x) can only be used with (-O difference)" << endl;
+		die = true;
+	}
+	if (folds > 0
+			&& (!subtractFilter.empty() || progressive != -1
+					|| !updateFilter.empty() || shardNum > 0 || mergeFilters
+					|| minCount > 0 || stats)) {
+		cerr << "(-H) cannot be used with (-s), (-r), (-u), (-S), (-M), (-q) "
+				"or (-a)" << endl;
+		die = true;
+	}
+	if (folds > 0 && inputFiles.size() > 1) {
+		cerr << "(-H) folds a single filter at once" << endl;
+		die = true;
+	}
+	if (minCount > 0
+			&& (!subtractFilter.empty() || progressive != -1
+					|| minimizerWindow > 0 || !updateFilter.empty()
+					|| shardNum > 0 || mergeFilters || estimate)) {
+		cerr << "(-q) cannot be used with (-s), (-r), (-w), (-u), (-S), (-M) "
+				"or (-e)" << endl;
+		die = true;
+	}
+	if ((checkpointInterval > 0 || resume)
+			&& (minCount > 0 || mergeFilters || folds > 0
+					|| (!subtractFilter.empty() && progressive == -1))) {
+		cerr << "Checkpoints (-C, -R) cannot be used with (-q), (-M), (-H) or "
+				"with (-s) without (-r)" << endl;
+		die = true;
+	}
+	if (stats
+			&& (!subtractFilter.empty() || progressive != -1
+					|| !updateFilter.empty() || shardNum > 0 || mergeFilters
+					|| minCount > 0)) {
+		cerr << "(-a) cannot be used with (-s), (-r), (-u), (-S), (-M) or (-q)"
+				<< endl;
+		die = true;
+	}
+	if (abundance
+			&& (!subtractFilter.empty() || progressive != -1
+					|| minimizerWindow > 0 || !updateFilter.empty()
+					|| shardNum > 0 || mergeFilters || folds > 0
+					|| minCount > 0 || stats || checkpointInterval > 0
+					|| resume)) {
+		cerr << "(-A) cannot be used with (-s), (-r), (-w), (-u), (-S), (-M), "
+				"(-H), (-q), (-a) or checkpoints (-C, -R)" << endl;
+		die = true;
+	}
+	if (shardNum > 0
+			&& (progressive != -1 || !updateFilter.empty() || estimate)) {
+		cerr << "(-S) cannot be used with (-r), (-u) or (-e)" << endl;
+		die = true;
+	}
+	if (!spacedSeed.empty()) {
+		if (!ReadsProcessor::isValidSpacedSeed(spacedSeed, kmerSize)) {
+			cerr << "Invalid spaced seed (-m) " << spacedSeed
+					<< " for k-mer size " << kmerSize << endl;
+			die = true;
+		}
+		if (!subtractFilter.empty() || progressive != -1) {
+			cerr << "Spaced seed filters (-m) cannot be made with (-s) or (-r)"
+					<< endl;
+			die = true;
+		}
+	}
 	if (die) {
 		cerr << "Try '--help' for more information.\n";
 		exit(EXIT_FAILURE);
 	}
 
+	if (stats) {
+		return measureFilters(inputFiles, statsQueries);
+	}
+
+	if (mergeFilters) {
+		BloomFilterMerger merger(inputFiles, operation);
+		merger.setForce(force);
+		merger.merge(outputDir + filterPrefix + ".bf");
+		storeInfo(merger.getMergedInfo(filterPrefix), outputDir + filterPrefix,
+				singleFile, compress);
+		cerr << "Filter Merge Complete." << endl;
+		return 0;
+	}
+
+	if (folds > 0) {
+		BloomFilterFolder folder(inputFiles.front(), folds);
+		folder.fold(outputDir + filterPrefix + ".bf");
+		storeInfo(folder.getFoldedInfo(filterPrefix), outputDir + filterPrefix,
+				singleFile, compress);
+		cerr << "Filter Fold Complete." << endl;
+		return 0;
+	}
+
+	if (!updateFilter.empty()) {
+		return updateExisting(updateFilter, inputFiles, filterPrefix,
+				outputDir, checkpointInterval, resume, singleFile, compress);
+	}
+
 	//set number of hash functions used
 	if (hashNum == 0) {
 		//get optimal number of hash functions
@@ -269,19 +746,72 @@ int main(int argc, char *argv[]) {
 
 	//create filter
 	BloomFilterGenerator filterGen(inputFiles, kmerSize, hashNum, entryNum);
+	bool solidEstimate = false;
 
 	if (entryNum == 0) {
 		filterGen = BloomFilterGenerator(inputFiles, kmerSize, hashNum);
+	}
+	if (minimizerWindow > 0) {
+		filterGen.setMinimizerWindow(minimizerWindow);
+	}
+	filterGen.setSpacedSeed(spacedSeed);
+	filterGen.setDeterministic(deterministic);
+	if (shardNum > 0) {
+		//estimates of a shard would give each shard a different size
+		if (filterGen.hasStreamedFiles() && entryNum == 0) {
+			cerr << "Some files are not indexed or are compressed, number of "
+					"expected elements (-n) of all files is needed with (-S)"
+					<< endl;
+			exit(EXIT_FAILURE);
+		}
+		filterGen.setShard(shard - 1, shardNum);
+	}
+	if (minCount > 0) {
+		cerr << "Counting k-mers" << endl;
+		size_t solidNum = filterGen.countKmers(minCount, counterNum);
+		cerr << "Estimated " << solidNum << " distinct k-mers seen at least "
+				<< minCount << " times" << endl;
+		if (entryNum == 0) {
+			entryNum = solidNum;
+			solidEstimate = true;
+		}
+	}
+	//size of files read without an index is only known from an estimate
+	else if (filterGen.hasStreamedFiles() && entryNum == 0 && !estimate) {
+		cerr << "Some files are not indexed or are compressed, "
+				"number of expected elements will be estimated (-e)" << endl;
+		estimate = true;
+	}
+	if (estimate) {
+		cerr << "Estimating number of distinct k-mers" << endl;
+		entryNum = filterGen.estimateEntries();
+		cerr << "Estimated " << entryNum << " distinct k-mers" << endl;
+	}
+	if (entryNum == 0) {
 		entryNum = filterGen.getExpectedEntries();
 	}
 
 	BloomFilterInfo info(filterPrefix, kmerSize, hashNum, fpr, entryNum,
 			inputFiles);
+	info.setMinimizerWindow(minimizerWindow);
+	info.setSpacedSeed(spacedSeed);
+	if (estimate || solidEstimate) {
+		info.setDistinctEstimate(entryNum);
+	}
 
 	//get calculated size of Filter
 	size_t filterSize = info.getCalcuatedFilterSize();
 	cerr << "Allocating " << filterSize << " bits of space for filter and will output filter this size" << endl;
 	filterGen.setFilterSize(filterSize);
+	if (abundance) {
+		//counters are read back as a mask of one bit per counter
+		counterNum = (counterNum + 63) / 64 * 64;
+		filterGen.setAbundance(counterNum);
+	}
+	if (checkpointInterval > 0 || resume) {
+		filterGen.setCheckpoint(outputDir + filterPrefix, checkpointInterval,
+				resume);
+	}
 
 	size_t redundNum = 0;
 	//output filter
@@ -304,29 +834,36 @@ int main(int argc, char *argv[]) {
 		redundNum = filterGen.generateProgressive(
 				outputDir + filterPrefix + ".bf", progressive, file1, file2,
 				mode);
+	} else if (minCount > 0) {
+		redundNum = filterGen.generateSolid(outputDir + filterPrefix + ".bf");
 	} else {
 		redundNum = filterGen.generate(outputDir + filterPrefix + ".bf");
 	}
 	info.setTotalNum(filterGen.getTotalEntries());
 	info.setRedundancy(redundNum);
+	if (abundance) {
+		filterGen.storeAbundance(outputDir + filterPrefix + ".counts");
+		info.setAbundanceCounters(counterNum);
+	}
 
 	//code for redundancy checking
 	//calculate redundancy rate
 	double redunRate = double(redundNum) / double(filterGen.getTotalEntries())
 			- info.getRedundancyFPR();
-	if (redunRate > 0.25) {
+	//filters sized from an estimate are not affected by redundancy
+	if (redunRate > 0.25 && !estimate && minCount == 0) {
 		cerr
 				<< "The ratio between redundant k-mers and unique k-mers is approximately: "
 				<< redunRate << endl;
 		cerr
 				<< "Consider checking your files for duplicate sequences and adjusting them accordingly.\n"
 						"High redundancy will cause filter sizes used overestimated, potentially resulting in a larger than needed filter.\n"
-						"Alternatively you can set the number of elements wanted in the filter with (-n) and ignore this message."
+						"Alternatively you can set the number of elements wanted in the filter with (-n) or estimate it with (-e) and ignore this message."
 				<< endl;
 	}
 
 	//output info
-	info.printInfoFile(outputDir + filterPrefix + ".txt");
+	storeInfo(info, outputDir + filterPrefix, singleFile, compress);
 	cerr << "Filter Creation Complete." << endl;
 
 	return 0;
@@ -0,0 +1,124 @@
+/*
+ * BloomFilterFolder.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "BloomFilterFolder.h"
+#include "Common/BloomFilter.h"
+#include "Common/IOUtil.h"
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#if _OPENMP
+# include <omp.h>
+#endif
+
+/*
+ * Loads the information of the filter (single file or next to the .bf file)
+ * and checks that it can be folded the given number of times
+ */
+BloomFilterFolder::BloomFilterFolder(const string &filterFile, unsigned folds) :
+		m_filterFile(filterFile), m_file(filterFile), m_folds(folds)
+{
+	if (filterFile.length() < 3
+			|| filterFile.substr(filterFile.length() - 3) != ".bf") {
+		cerr << "Error: Filter to fold must end in .bf: " << filterFile << endl;
+		exit(1);
+	}
+	size_t size = m_file.getInfo().getCalcuatedFilterSize();
+	//folded filter must still be a whole number of bytes
+	if (folds == 0 || folds >= 48 || size % (size_t(bitsPerChar) << folds) != 0) {
+		cerr << "Error: " << filterFile << " of " << size
+				<< " bits cannot be folded " << folds
+				<< " times. Size must be a multiple of 2^(N+3) bits to be "
+						"folded N times." << endl;
+		exit(1);
+	}
+}
+
+/*
+ * Outputs the folded filter to a filename
+ * Each block of the folded filter is the OR of the blocks at the same
+ * position of each of the 2^folds segments of the filter, combined in parallel
+ */
+void BloomFilterFolder::fold(const string &filename) const
+{
+	size_t sizeInBytes = m_file.getInfo().getCalcuatedFilterSize()
+			/ bitsPerChar;
+	size_t foldedSize = sizeInBytes >> m_folds;
+	size_t segmentNum = size_t(1) << m_folds;
+
+	int fd = open(m_filterFile.c_str(), O_RDONLY);
+	struct stat sb;
+	if (fd == -1 || fstat(fd, &sb) == -1) {
+		cerr << "file \"" << m_filterFile << "\" could not be read." << endl;
+		exit(1);
+	}
+	//sizes of single files are checked when their header is read
+	if (!m_file.isSingleFile() && size_t(sb.st_size) != sizeInBytes) {
+		cerr << "Error: " << m_filterFile
+				<< " does not match size given by its information file. Size: "
+				<< sb.st_size << " vs " << sizeInBytes << " bytes." << endl;
+		exit(1);
+	}
+	//output replaces the file only once done, so it may be an input
+	string tempPath = filename + ".tmp";
+	int out = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (out == -1 || ftruncate(out, foldedSize) == -1) {
+		cerr << "file \"" << tempPath << "\" could not be written." << endl;
+		exit(1);
+	}
+
+	cerr << "Folding filter of " << sizeInBytes << " bytes into "
+			<< foldedSize << " bytes." << endl;
+	size_t blockNum = (foldedSize + s_blockSize - 1) / s_blockSize;
+#pragma omp parallel
+	{
+		vector<unsigned char> folded(s_blockSize);
+		vector<unsigned char> block(s_blockSize);
+#pragma omp for schedule(dynamic)
+		for (long i = 0; i < long(blockNum); ++i) {
+			size_t offset = size_t(i) * s_blockSize;
+			size_t size = min(s_blockSize, foldedSize - offset);
+			m_file.readBlocks(fd, &folded[0], offset, size);
+			for (size_t j = 1; j < segmentNum; ++j) {
+				m_file.readBlocks(fd, &block[0], j * foldedSize + offset,
+						size);
+				for (size_t k = 0; k < size; ++k) {
+					folded[k] |= block[k];
+				}
+			}
+			writeBlock(out, &folded[0], size, offset, tempPath);
+		}
+	}
+
+	close(fd);
+	if (close(out) != 0 || rename(tempPath.c_str(), filename.c_str()) != 0) {
+		cerr << "file \"" << filename << "\" could not be written." << endl;
+		exit(1);
+	}
+}
+
+/*
+ * Information of the folded filter, entries are unchanged and false positive
+ * rates are recalculated for the smaller size
+ */
+BloomFilterInfo BloomFilterFolder::getFoldedInfo(
+		const string &filterID) const
+{
+	BloomFilterInfo info(m_file.getInfo());
+	info.setFilterID(filterID);
+	info.setFilterSize(info.getCalcuatedFilterSize() >> m_folds);
+	//counts are kept next to the original filter
+	info.setAbundanceCounters(0);
+	return info;
+}
+
+BloomFilterFolder::~BloomFilterFolder()
+{
+}
@@ -0,0 +1,44 @@
+/*
+ * BloomFilterFolder.h
+ *
+ * Shrinks a filter that is larger than needed by a power of two without
+ * rebuilding it. Positions are the hash values modulo the filter size, so
+ * when the size is halved each bit of the upper half lands on the bit at the
+ * same position of the lower half: the folded filter is the bitwise OR of the
+ * two halves, equal to a filter built with half the size.
+ *
+ * The filter is streamed in blocks so memory use does not depend on its size.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef BLOOMFILTERFOLDER_H_
+#define BLOOMFILTERFOLDER_H_
+
+#include <string>
+#include "Common/BloomFilterInfo.h"
+#include "Common/BloomFilterFile.h"
+
+using namespace std;
+
+class BloomFilterFolder {
+public:
+	explicit BloomFilterFolder(const string &filterFile, unsigned folds);
+
+	void fold(const string &filename) const;
+	BloomFilterInfo getFoldedInfo(const string &filterID) const;
+
+	virtual ~BloomFilterFolder();
+private:
+	BloomFilterFolder(const BloomFilterFolder& that); //to prevent copy construction
+
+	string m_filterFile;
+	BloomFilterFile m_file;
+	//number of times the size is halved
+	unsigned m_folds;
+
+	//bytes of the folded filter processed at once by a thread
+	static const size_t s_blockSize = 1 << 22;
+};
+
+#endif /* BLOOMFILTERFOLDER_H_ */
@@ -16,13 +16,40 @@
 #include <assert.h>
 #include "WindowedFileParser.h"
 #include "Common/BloomFilterInfo.h"
+#include "Common/BloomFilterFile.h"
 #include <cassert>
 #include <cmath>
 #include <FastaReader.h>
 #include "Common/SeqEval.h"
+#include "Common/MinimizerSampler.h"
+#include "Common/HyperLogLog.h"
+#include <boost/shared_ptr.hpp>
+#include <algorithm>
+#include "Common/Uncompress.h"
 
 //Todo Refactor to remove repetitive and potentially error prone parts of code
 
+/*
+ * Files are read through their fasta index unless they are compressed or
+ * not indexed, in which case they are streamed
+ */
+static bool isIndexed(const string &fileName)
+{
+	static const char* const compressed[] = { ".gz", ".bz2", ".xz", ".zip",
+			".Z" };
+	for (unsigned i = 0; i < sizeof(compressed) / sizeof(compressed[0]); ++i) {
+		string ext(compressed[i]);
+		if (fileName.length() > ext.length()
+				&& fileName.compare(fileName.length() - ext.length(),
+						ext.length(), ext) == 0)
+		{
+			return false;
+		}
+	}
+	ifstream indexFile((fileName + ".fai").c_str());
+	return indexFile.good();
+}
+
 /*
  * Constructor:
  * User must specify kmer size used in sliding window and give it a list of
@@ -31,11 +58,16 @@
 BloomFilterGenerator::BloomFilterGenerator(vector<string> const &filenames,
 		unsigned kmerSize, unsigned hashNum):
 		m_kmerSize(kmerSize), m_hashNum(hashNum), m_expectedEntries(0), m_filterSize(0), m_totalEntries(
-				0), m_redundancy(0){
+				0), m_redundancy(0), m_minimizerWindow(0), m_derivedEntries(true), m_minCount(0), m_deterministic(false), m_sequencesDone(0), m_readPairsDone(0), m_resumed(false){
 
 	//for each file loop over all headers and obtain max number of elements
+	//size of streamed files is unknown and must be estimated
 	for (vector<string>::const_iterator i = filenames.begin();
 			i != filenames.end(); ++i) {
+		if (!isIndexed(*i)) {
+			m_streamedFiles.push_back(*i);
+			continue;
+		}
 		WindowedFileParser parser(*i, kmerSize);
 		m_fileNamesAndHeaders[*i] = parser.getHeaders();
 		for (vector<string>::iterator j = m_fileNamesAndHeaders[*i].begin();
@@ -55,15 +87,136 @@ BloomFilterGenerator::BloomFilterGenerator(vector<string> const &filenames,
 BloomFilterGenerator::BloomFilterGenerator(vector<string> const &filenames,
 		unsigned kmerSize, unsigned hashNum, size_t numElements) :
 		m_kmerSize(kmerSize), m_hashNum(hashNum),  m_expectedEntries(numElements), m_filterSize(
-				0), m_totalEntries(0), m_redundancy(0) {
+				0), m_totalEntries(0), m_redundancy(0), m_minimizerWindow(0), m_derivedEntries(
+				false), m_minCount(0), m_deterministic(false), m_sequencesDone(0), m_readPairsDone(0), m_resumed(false) {
 	//for each file loop over all headers and obtain max number of elements
 	for (vector<string>::const_iterator i = filenames.begin();
 			i != filenames.end(); ++i) {
+		if (!isIndexed(*i)) {
+			m_streamedFiles.push_back(*i);
+			continue;
+		}
 		WindowedFileParser parser(*i, kmerSize);
 		m_fileNamesAndHeaders[*i] = parser.getHeaders();
 	}
 }
 
+/*
+ * Pre-pass over all sequences estimating the number of distinct k-mers (or
+ * minimizers) that will be inserted, sequences are split between threads
+ * The estimate replaces the expected number of entries and is returned
+ */
+size_t BloomFilterGenerator::estimateEntries() {
+	vector<pair<string, string> > seqs;
+	for (boost::unordered_map<string, vector<string> >::iterator i =
+			m_fileNamesAndHeaders.begin(); i != m_fileNamesAndHeaders.end(); ++i) {
+		for (vector<string>::iterator j = i->second.begin();
+				j != i->second.end(); ++j) {
+			seqs.push_back(make_pair(i->first, *j));
+		}
+	}
+
+	unsigned kmerSizeInBytes = (m_kmerSize + 3) / 4;
+	HyperLogLog sketch;
+#pragma omp parallel
+	{
+		HyperLogLog threadSketch;
+		//one parser per file for each thread
+		boost::unordered_map<string, boost::shared_ptr<WindowedFileParser> > parsers;
+#pragma omp for schedule(dynamic)
+		for (long i = 0; i < long(seqs.size()); ++i) {
+			boost::shared_ptr<WindowedFileParser> &parser =
+					parsers[seqs[i].first];
+			if (!parser) {
+				parser.reset(new WindowedFileParser(seqs[i].first, m_kmerSize));
+				parser->setSpacedSeed(m_spacedSeed);
+			}
+			parser->setLocationByHeader(seqs[i].second);
+			if (m_minimizerWindow > 0) {
+				MinimizerSampler sampler(m_kmerSize, m_minimizerWindow);
+				while (parser->notEndOfSeqeunce()) {
+					if (sampler.add(parser->getNextSeq())) {
+						threadSketch.add(sampler.getMinimizer(),
+								kmerSizeInBytes);
+					}
+				}
+				continue;
+			}
+			while (parser->notEndOfSeqeunce()) {
+				const unsigned char* currentSeq = parser->getNextSeq();
+				if (currentSeq != NULL) {
+					threadSketch.add(currentSeq, kmerSizeInBytes);
+				}
+			}
+		}
+		//streamed files cannot be split, one thread per file
+#pragma omp for schedule(dynamic)
+		for (long i = 0; i < long(m_streamedFiles.size()); ++i) {
+			boost::shared_ptr<FastaReader> reader;
+			//opening compressed files is not thread safe
+#pragma omp critical(openStreamed)
+			reader.reset(
+					new FastaReader(m_streamedFiles[i].c_str(),
+							FastaReader::NO_FOLD_CASE));
+			ReadsProcessor proc(m_kmerSize);
+			proc.setSpacedSeed(m_spacedSeed);
+			for (FastqRecord rec; (*reader) >> rec;) {
+				MinimizerSampler sampler(m_kmerSize, m_minimizerWindow);
+				for (size_t j = 0; j + m_kmerSize <= rec.seq.length(); ++j) {
+					const unsigned char* currentSeq = proc.prepSeq(rec.seq, j);
+					if (m_minimizerWindow == 0) {
+						if (currentSeq != NULL) {
+							threadSketch.add(currentSeq, kmerSizeInBytes);
+						}
+					} else if (sampler.add(currentSeq)) {
+						threadSketch.add(sampler.getMinimizer(),
+								kmerSizeInBytes);
+					}
+				}
+			}
+		}
+#pragma omp critical(sketch)
+		sketch.merge(threadSketch);
+	}
+	m_expectedEntries = max(sketch.estimate(), size_t(1));
+	return m_expectedEntries;
+}
+
+/*
+ * Inserts k-mers (or minimizers) of a fasta file read sequentially, so no
+ * index is needed and compressed files can be used
+ * K-mers found in subtract (if not NULL) are not inserted
+ * Returns the number of k-mers not inserted because of subtract
+ */
+size_t BloomFilterGenerator::insertStreamed(const string &fileName,
+		BloomFilter &filter, const BloomFilter *subtract) {
+	cerr << "Processing File: " << fileName << endl;
+	size_t kmerRemoved = 0;
+	FastaReader reader(fileName.c_str(), FastaReader::NO_FOLD_CASE);
+	ReadsProcessor proc(m_kmerSize);
+	proc.setSpacedSeed(m_spacedSeed);
+	for (FastqRecord rec; reader >> rec;) {
+		MinimizerSampler sampler(m_kmerSize, m_minimizerWindow);
+		for (size_t i = 0; i + m_kmerSize <= rec.seq.length(); ++i) {
+			const unsigned char* currentSeq = proc.prepSeq(rec.seq, i);
+			if (m_minimizerWindow > 0) {
+				//only insert minimizers
+				if (!sampler.add(currentSeq)) {
+					continue;
+				}
+				currentSeq = sampler.getMinimizer();
+			}
+			if (subtract != NULL && currentSeq != NULL
+					&& subtract->contains(currentSeq)) {
+				++kmerRemoved;
+				continue;
+			}
+			checkAndInsertKmer(currentSeq, filter);
+		}
+	}
+	return kmerRemoved;
+}
+
 /*
  * Generates a bloom filter outputting it to a filename
  * Returns the m_redundancy rate of a Bloom Filter generated from a file.
@@ -81,7 +234,39 @@ size_t BloomFilterGenerator::generate(const string &filename) {
 
 	//setup bloom filter
 	BloomFilter filter(m_filterSize, m_hashNum, m_kmerSize);
+	insertSequences(filter);
+	filter.storeFilter(filename);
+	finishCheckpoint();
+	return m_redundancy;
+}
+
+/*
+ * Inserts sequences into an existing filter (of size set by setFilterSize)
+ * outputting the updated filter to a filename (which may be the existing one)
+ * Returns the m_redundancy rate of the sequences inserted
+ */
+size_t BloomFilterGenerator::update(const string &filename,
+		const string &existingFilter) {
+
+	//need the number of hash functions used to be greater than 0
+	assert(m_hashNum > 0);
+
+	BloomFilter filter(m_filterSize, m_hashNum, m_kmerSize, existingFilter);
+	insertSequences(filter);
+	filter.storeFilter(filename);
+	finishCheckpoint();
+	return m_redundancy;
+}
 
+/*
+ * Inserts all k-mers (or minimizers) of the input files into filter
+ */
+void BloomFilterGenerator::insertSequences(BloomFilter &filter) {
+	if (m_resumed) {
+		filter.loadFilter(m_checkpoint->getFilterPath());
+		m_resumed = false;
+	}
+	size_t sequence = 0;
 	//for each file loop over all headers and obtain seq
 	//load input file + make filter
 	for (boost::unordered_map<string, vector<string> >::iterator i =
@@ -89,20 +274,64 @@ size_t BloomFilterGenerator::generate(const string &filename) {
 		//let user know that files are being read
 		cerr << "Processing File: " << i->first << endl;
 		WindowedFileParser parser(i->first, m_kmerSize);
+		parser.setSpacedSeed(m_spacedSeed);
 		for (vector<string>::iterator j = i->second.begin();
 				j != i->second.end(); ++j) {
+			//already inserted before the build was interrupted
+			if (sequence++ < m_sequencesDone) {
+				continue;
+			}
 			parser.setLocationByHeader(*j);
 			//object to process reads
 			//insert elements into filter
 			//read fasta file line by line and split using sliding window
-			while (parser.notEndOfSeqeunce()) {
-				const unsigned char* currentSeq = parser.getNextSeq();
-				checkAndInsertKmer(currentSeq, filter);
+			if (m_minimizerWindow > 0) {
+				//only insert minimizers
+				MinimizerSampler sampler(m_kmerSize, m_minimizerWindow);
+				while (parser.notEndOfSeqeunce()) {
+					if (sampler.add(parser.getNextSeq())) {
+						checkAndInsertKmer(sampler.getMinimizer(), filter);
+					}
+				}
+			} else {
+				while (parser.notEndOfSeqeunce()) {
+					const unsigned char* currentSeq = parser.getNextSeq();
+					checkAndInsertKmer(currentSeq, filter);
+				}
 			}
+			++m_sequencesDone;
+			checkpoint(filter);
 		}
 	}
-	filter.storeFilter(filename);
-	return m_redundancy;
+	for (vector<string>::const_iterator i = m_streamedFiles.begin();
+			i != m_streamedFiles.end(); ++i) {
+		if (sequence++ < m_sequencesDone) {
+			continue;
+		}
+		insertStreamed(*i, filter, NULL);
+		++m_sequencesDone;
+		checkpoint(filter);
+	}
+}
+
+/*
+ * Saves filter and progress if a checkpoint is due (see setCheckpoint)
+ */
+void BloomFilterGenerator::checkpoint(const BloomFilter &filter) {
+	if (m_checkpoint && m_checkpoint->isDue()) {
+		BuildCheckpoint::State state = { m_sequencesDone, m_readPairsDone,
+				m_totalEntries, m_redundancy };
+		m_checkpoint->save(filter, state);
+	}
+}
+
+/*
+ * Build is complete, checkpoint files are no longer needed
+ */
+void BloomFilterGenerator::finishCheckpoint() {
+	if (m_checkpoint) {
+		m_checkpoint->finish();
+	}
 }
 
 /*
@@ -111,6 +340,7 @@ size_t BloomFilterGenerator::generate(const string &filename) {
  * Currently only supports fasta files for initial seeding
  *
  * Uses fastq files to stream in additional sequence
+ * k-mers in subtract filter are not counted when evaluating reads
  * Stops after m_expectedEntries of entries
  *
  * Outputs to fileName path
@@ -130,9 +360,8 @@ size_t BloomFilterGenerator::generateProgressive(const string &filename,
 	BloomFilter filter(m_filterSize, m_hashNum, m_kmerSize);
 
 	//load other bloom filter info
-	string infoFileName = (subtractFilter).substr(0,
-			(subtractFilter).length() - 2) + "txt";
-	BloomFilterInfo subInfo(infoFileName);
+	BloomFilterFile subFile(subtractFilter);
+	const BloomFilterInfo &subInfo = subFile.getInfo();
 
 	//load other bloomfilter
 	BloomFilter filterSub(subInfo.getCalcuatedFilterSize(),
@@ -145,167 +374,11 @@ size_t BloomFilterGenerator::generateProgressive(const string &filename,
 		exit(1);
 	}
 
-	//for each file loop over all headers and obtain seq
-	//load input file + make filter
-	for (boost::unordered_map<string, vector<string> >::iterator i =
-			m_fileNamesAndHeaders.begin(); i != m_fileNamesAndHeaders.end(); ++i) {
-		//let user know that files are being read
-		cerr << "Processing File: " << i->first << endl;
-		WindowedFileParser parser(i->first, m_kmerSize);
-		for (vector<string>::iterator j = i->second.begin();
-				j != i->second.end(); ++j) {
-			parser.setLocationByHeader(*j);
-			//object to process reads
-			//insert elements into filter
-			//read fasta file line by line and split using sliding window
-			while (parser.notEndOfSeqeunce()) {
-				const unsigned char* currentSeq = parser.getNextSeq();
-				checkAndInsertKmer(currentSeq, filter);
-			}
-		}
-	}
-
-	size_t totalReads = 0;
-
-	FastaReader sequence1(file1.c_str(), FastaReader::NO_FOLD_CASE);
-	FastaReader sequence2(file2.c_str(), FastaReader::NO_FOLD_CASE);
-#pragma omp parallel
-	for (FastqRecord rec1;;) {
-		FastqRecord rec2;
-		bool good1;
-		bool good2;
-
-		if (m_totalEntries >= m_expectedEntries) {
-			//so threshold message only printed once
-			if (sequence1.eof() || sequence1.eof()) {
-				break;
-			}
-#pragma omp critical(breakClose)
-			{
-				sequence1.breakClose();
-				sequence2.breakClose();
-				cerr << "K-mer threshold reached at read " << totalReads << endl;
-			}
-		}
-
-#pragma omp critical(sequence)
-		{
-			good1 = sequence1 >> rec1;
-			good2 = sequence2 >> rec2;
-		}
-
-		if (good1 && good2) {
-#pragma omp critical(totalReads)
-			{
-				++totalReads;
-				if (totalReads % 10000000 == 0) {
-					cerr << "Currently Reading Read Number: " << totalReads
-							<< endl;
-				}
-			}
-			ReadsProcessor proc(m_kmerSize);
-			string tempStr1 = rec1.id.substr(0, rec1.id.find_last_of("/"));
-			string tempStr2 = rec2.id.substr(0, rec2.id.find_last_of("/"));
-			if (tempStr1 == tempStr2) {
-				unsigned size1 = rec1.seq.length() - m_kmerSize + 1;
-				unsigned size2 = rec2.seq.length() - m_kmerSize + 1;
-				vector<vector<size_t> > hashValues1(size1);
-				vector<vector<size_t> > hashValues2(size2);
-				switch (mode) {
-				case PROG_INC: {
-					if (SeqEval::evalSingle(rec1, m_kmerSize, filter,
-									score * double(size1),
-									(1.0 - score) * double(size1), m_hashNum,
-									hashValues1, filterSub)) {
-						//load remaining sequences
-						for (unsigned i = 0; i < size1; ++i) {
-							if (hashValues1[i].empty()) {
-								const unsigned char* currentSeq = proc.prepSeq(
-										rec1.seq, i);
-								checkAndInsertKmer(currentSeq, filter);
-							} else {
-								insertKmer(hashValues1[i], filter);
-							}
-						}
-						//load store second read
-						for (unsigned i = 0; i < size2; ++i) {
-							const unsigned char* currentSeq = proc.prepSeq(
-									rec2.seq, i);
-							checkAndInsertKmer(currentSeq, filter);
-						}
-					} else if (SeqEval::evalSingle(rec2, m_kmerSize, filter,
-									score * size2, (1.0 - score) * size2, m_hashNum,
-									hashValues2, filterSub)) {
-						//load remaining sequences
-						for (unsigned i = 0; i < size1; ++i) {
-							if (hashValues1[i].empty()) {
-								const unsigned char* currentSeq = proc.prepSeq(
-										rec1.seq, i);
-								checkAndInsertKmer(currentSeq, filter);
-							} else {
-								insertKmer(hashValues1[i], filter);
-							}
-						}
-						//load store second read
-						for (unsigned i = 0; i < size2; ++i) {
-							if (hashValues2[i].empty()) {
-								const unsigned char* currentSeq = proc.prepSeq(
-										rec2.seq, i);
-								checkAndInsertKmer(currentSeq, filter);
-							} else {
-								insertKmer(hashValues2[i], filter);
-							}
-						}
-					}
-					break;
-				}
-				case PROG_STD: {
-					if (SeqEval::evalSingle(rec1, m_kmerSize, filter,
-							score * double(size1),
-							(1.0 - score) * double(size1), m_hashNum,
-							hashValues1, filterSub)
-							&& SeqEval::evalSingle(rec2, m_kmerSize, filter,
-									score * size2, (1.0 - score) * size2,
-									m_hashNum, hashValues2, filterSub)) {
-						//load remaining sequences
-						for (unsigned i = 0; i < size1; ++i) {
-							if (hashValues1[i].empty()) {
-								const unsigned char* currentSeq = proc.prepSeq(
-										rec1.seq, i);
-								checkAndInsertKmer(currentSeq, filter);
-							} else {
-								insertKmer(hashValues1[i], filter);
-							}
-						}
-						//load store second read
-						for (unsigned i = 0; i < size2; ++i) {
-							if (hashValues2[i].empty()) {
-								const unsigned char* currentSeq = proc.prepSeq(
-										rec2.seq, i);
-								checkAndInsertKmer(currentSeq, filter);
-							} else {
-								insertKmer(hashValues2[i], filter);
-							}
-						}
-					}
-					break;
-				}
-				}
-			} else {
-				cerr << "Read IDs do not match" << "\n" << tempStr1 << "\n"
-						<< tempStr2 << endl;
-				exit(1);
-			}
-		} else
-			break;
-	}
-	if (!sequence1.eof() || !sequence2.eof()) {
-		cerr
-				<< "error: eof bit not flipped. Input files may be different lengths"
-				<< endl;
-	}
+	insertSequences(filter);
+	insertReadPairs(filter, score, file1, file2, mode, &filterSub);
 
 	filter.storeFilter(filename);
+	finishCheckpoint();
 	return m_redundancy;
 }
 
@@ -332,170 +405,310 @@ size_t BloomFilterGenerator::generateProgressive(const string &filename,
 	//setup bloom filter
 	BloomFilter filter(m_filterSize, m_hashNum, m_kmerSize);
 
-	//for each file loop over all headers and obtain seq
-	//load input file + make filter
-	for (boost::unordered_map<string, vector<string> >::iterator i =
-			m_fileNamesAndHeaders.begin(); i != m_fileNamesAndHeaders.end(); ++i) {
-		//let user know that files are being read
-		cerr << "Processing File: " << i->first << endl;
-		WindowedFileParser parser(i->first, m_kmerSize);
-		for (vector<string>::iterator j = i->second.begin();
-				j != i->second.end(); ++j) {
-			parser.setLocationByHeader(*j);
-			//object to process reads
-			//insert elements into filter
-			//read fasta file line by line and split using sliding window
-			while (parser.notEndOfSeqeunce()) {
-				const unsigned char* currentSeq = parser.getNextSeq();
-				checkAndInsertKmer(currentSeq, filter);
-			}
+	insertSequences(filter);
+	insertReadPairs(filter, score, file1, file2, mode, NULL);
+
+	filter.storeFilter(filename);
+	finishCheckpoint();
+	return m_redundancy;
+}
+
+/*
+ * Reads up to s_batchSize pairs of reads into batch
+ * Returns the number of pairs read
+ */
+size_t BloomFilterGenerator::readPairs(FastaReader &sequence1,
+		FastaReader &sequence2, ReadPairBatch &batch, size_t &totalReads)
+{
+	batch.size = 0;
+	while (batch.size < s_batchSize && sequence1 >> batch.reads1[batch.size]
+			&& sequence2 >> batch.reads2[batch.size]) {
+		++batch.size;
+		if (++totalReads % 10000000 == 0) {
+			cerr << "Currently Reading Read Number: " << totalReads << endl;
 		}
 	}
+	return batch.size;
+}
 
+/*
+ * Greedily inserts pairs of reads of file1 and file2 into filter (see
+ * insertPair) until m_expectedEntries is reached
+ * Pairs are processed in batches split between threads, while one thread
+ * reads the next batch
+ *
+ * In deterministic mode pairs of a batch are evaluated in parallel against
+ * the filter as it was at the start of the batch, then inserted in input
+ * order by a single thread, so the filter does not depend on the number of
+ * threads (see setDeterministic)
+ */
+void BloomFilterGenerator::insertReadPairs(BloomFilter &filter, double score,
+		const string &file1, const string &file2, createMode mode,
+		const BloomFilter *subtract)
+{
 	size_t totalReads = 0;
+	size_t readsProcessed = 0;
 
 	FastaReader sequence1(file1.c_str(), FastaReader::NO_FOLD_CASE);
 	FastaReader sequence2(file2.c_str(), FastaReader::NO_FOLD_CASE);
-#pragma omp parallel
-	for (FastqRecord rec1;;) {
-		FastqRecord rec2;
-		bool good1;
-		bool good2;
 
-		if (m_totalEntries >= m_expectedEntries) {
-			//so threshold message only printed once
-			if (sequence1.eof() || sequence1.eof()) {
-				break;
-			}
-#pragma omp critical(breakClose)
-			{
-				sequence1.breakClose();
-				sequence2.breakClose();
-				cerr << "K-mer threshold reached at read " << totalReads << endl;
-			}
-		}
+	//pairs evaluated before the build was interrupted
+	for (FastqRecord rec1, rec2;
+			readsProcessed < m_readPairsDone && sequence1 >> rec1
+					&& sequence2 >> rec2; ++readsProcessed) {
+	}
+	totalReads = readsProcessed;
 
-#pragma omp critical(sequence)
-		{
-			good1 = sequence1 >> rec1;
-			good2 = sequence2 >> rec2;
+	ReadPairBatch batches[2];
+	for (unsigned i = 0; i < 2; ++i) {
+		batches[i].reads1.resize(s_batchSize);
+		batches[i].reads2.resize(s_batchSize);
+		batches[i].size = 0;
+		if (m_deterministic) {
+			batches[i].pass.resize(s_batchSize);
+			batches[i].hashValues1.resize(s_batchSize);
+			batches[i].hashValues2.resize(s_batchSize);
 		}
+	}
+	ReadPairBatch *current = &batches[0];
+	ReadPairBatch *next = &batches[1];
+	readPairs(sequence1, sequence2, *current, totalReads);
+	bool thresholdReached = false;
+	//pair whose insertion reached the threshold (counted from 1)
+	size_t thresholdRead = 0;
 
-		if (good1 && good2) {
-#pragma omp critical(totalReads)
+#pragma omp parallel
+	{
+		//buffers reused for every read of a thread
+		ReadsProcessor proc(m_kmerSize);
+		vector<vector<size_t> > hashValues1;
+		vector<vector<size_t> > hashValues2;
+
+		while (current->size > 0) {
+#pragma omp single nowait
 			{
-				++totalReads;
-				if (totalReads % 10000000 == 0) {
-					cerr << "Currently Reading Read Number: " << totalReads
-							<< endl;
+				if (!thresholdReached) {
+					readPairs(sequence1, sequence2, *next, totalReads);
 				}
 			}
-			ReadsProcessor proc(m_kmerSize);
-			string tempStr1 = rec1.id.substr(0, rec1.id.find_last_of("/"));
-			string tempStr2 = rec2.id.substr(0, rec2.id.find_last_of("/"));
-			if (tempStr1 == tempStr2) {
-				unsigned size1 = rec1.seq.length() - m_kmerSize + 1;
-				unsigned size2 = rec2.seq.length() - m_kmerSize + 1;
-				vector<vector<size_t> > hashValues1(size1);
-				vector<vector<size_t> > hashValues2(size2);
-				switch (mode) {
-				case PROG_INC: {
-					if (SeqEval::evalSingle(rec1, m_kmerSize, filter,
-									score * double(size1),
-									(1.0 - score) * double(size1), m_hashNum,
-									hashValues1)) {
-						//load remaining sequences
-						for (unsigned i = 0; i < size1; ++i) {
-							if (hashValues1[i].empty()) {
-								const unsigned char* currentSeq = proc.prepSeq(
-										rec1.seq, i);
-								checkAndInsertKmer(currentSeq, filter);
-							} else {
-								insertKmer(hashValues1[i], filter);
-							}
-						}
-						//load store second read
-						for (unsigned i = 0; i < size2; ++i) {
-							const unsigned char* currentSeq = proc.prepSeq(
-									rec2.seq, i);
-							checkAndInsertKmer(currentSeq, filter);
-						}
-					} else if (SeqEval::evalSingle(rec2, m_kmerSize, filter,
-									score * size2, (1.0 - score) * size2, m_hashNum,
-									hashValues2)) {
-						//load remaining sequences
-						for (unsigned i = 0; i < size1; ++i) {
-							if (hashValues1[i].empty()) {
-								const unsigned char* currentSeq = proc.prepSeq(
-										rec1.seq, i);
-								checkAndInsertKmer(currentSeq, filter);
-							} else {
-								insertKmer(hashValues1[i], filter);
-							}
-						}
-						//load store second read
-						for (unsigned i = 0; i < size2; ++i) {
-							if (hashValues2[i].empty()) {
-								const unsigned char* currentSeq = proc.prepSeq(
-										rec2.seq, i);
-								checkAndInsertKmer(currentSeq, filter);
-							} else {
-								insertKmer(hashValues2[i], filter);
+			if (m_deterministic) {
+#pragma omp for schedule(dynamic, 16)
+				for (long i = 0; i < long(current->size); ++i) {
+					current->pass[i] = evalPair(current->reads1[i],
+							current->reads2[i], score, mode, filter, subtract,
+							proc, current->hashValues1[i],
+							current->hashValues2[i]);
+				}
+			} else {
+#pragma omp for schedule(dynamic, 16)
+				for (long i = 0; i < long(current->size); ++i) {
+					//no need to evaluate further once threshold is reached
+					if (m_totalEntries < m_expectedEntries) {
+						insertPair(current->reads1[i], current->reads2[i],
+								score, mode, filter, subtract, proc,
+								hashValues1, hashValues2);
+						if (m_totalEntries >= m_expectedEntries) {
+#pragma omp critical(thresholdRead)
+							{
+								size_t read = readsProcessed + i + 1;
+								if (thresholdRead == 0 || read < thresholdRead) {
+									thresholdRead = read;
+								}
 							}
 						}
 					}
-					break;
 				}
-				case PROG_STD: {
-					if (SeqEval::evalSingle(rec1, m_kmerSize, filter,
-							score * double(size1),
-							(1.0 - score) * double(size1), m_hashNum,
-							hashValues1)
-							&& SeqEval::evalSingle(rec2, m_kmerSize, filter,
-									score * size2, (1.0 - score) * size2,
-									m_hashNum, hashValues2)) {
-						//load remaining sequences
-						for (unsigned i = 0; i < size1; ++i) {
-							if (hashValues1[i].empty()) {
-								const unsigned char* currentSeq = proc.prepSeq(
-										rec1.seq, i);
-								checkAndInsertKmer(currentSeq, filter);
-							} else {
-								insertKmer(hashValues1[i], filter);
-							}
-						}
-						//load store second read
-						for (unsigned i = 0; i < size2; ++i) {
-							if (hashValues2[i].empty()) {
-								const unsigned char* currentSeq = proc.prepSeq(
-										rec2.seq, i);
-								checkAndInsertKmer(currentSeq, filter);
-							} else {
-								insertKmer(hashValues2[i], filter);
-							}
-						}
+			}
+#pragma omp single
+			{
+				if (m_deterministic) {
+					size_t committed = commitPairs(*current, filter, proc);
+					if (thresholdRead == 0
+							&& m_totalEntries >= m_expectedEntries) {
+						thresholdRead = readsProcessed + committed;
 					}
-					break;
 				}
+				readsProcessed += current->size;
+				m_readPairsDone = readsProcessed;
+				checkpoint(filter);
+				swap(current, next);
+				if (!thresholdReached && m_totalEntries >= m_expectedEntries) {
+					thresholdReached = true;
+					current->size = 0;
+					sequence1.breakClose();
+					sequence2.breakClose();
+					cerr << "K-mer threshold reached at read "
+							<< (thresholdRead > 0 ? thresholdRead : readsProcessed)
+							<< endl;
 				}
-			} else {
-				cerr << "Read IDs do not match" << "\n" << tempStr1 << "\n"
-						<< tempStr2 << endl;
-				exit(1);
 			}
-		} else
-			break;
+		}
 	}
 	if (!sequence1.eof() || !sequence2.eof()) {
 		cerr
 				<< "error: eof bit not flipped. Input files may be different lengths"
 				<< endl;
 	}
+}
 
-	filter.storeFilter(filename);
-	return m_redundancy;
+/*
+ * Clears the hash values of the k-mers of a sequence
+ * Returns the number of k-mers of the sequence
+ */
+static size_t resetHashes(vector<vector<size_t> > &hashValues,
+		size_t seqLength, unsigned kmerSize)
+{
+	size_t size = seqLength >= kmerSize ? seqLength - kmerSize + 1 : 0;
+	if (hashValues.size() < size) {
+		hashValues.resize(size);
+	}
+	for (size_t i = 0; i < size; ++i) {
+		hashValues[i].clear();
+	}
+	return size;
 }
 
+/*
+ * Inserts a pair of reads into filter if their score is high enough
+ * With PROG_STD both reads must pass, with PROG_INC either one
+ */
+void BloomFilterGenerator::insertPair(const FastqRecord &rec1,
+		const FastqRecord &rec2, double score, createMode mode,
+		BloomFilter &filter, const BloomFilter *subtract, ReadsProcessor &proc,
+		vector<vector<size_t> > &hashValues1,
+		vector<vector<size_t> > &hashValues2)
+{
+	if (scorePair(rec1, rec2, score, mode, filter, subtract, hashValues1,
+			hashValues2)) {
+		insertRead(rec1, hashValues1, proc, filter);
+		insertRead(rec2, hashValues2, proc, filter);
+	}
+}
+
+/*
+ * Evaluates a pair of reads without inserting it, for deterministic mode
+ * Hash values of all k-mers of passing pairs are computed so they can be
+ * inserted quickly by commitPairs
+ */
+bool BloomFilterGenerator::evalPair(const FastqRecord &rec1,
+		const FastqRecord &rec2, double score, createMode mode,
+		const BloomFilter &filter, const BloomFilter *subtract,
+		ReadsProcessor &proc, vector<vector<size_t> > &hashValues1,
+		vector<vector<size_t> > &hashValues2) const
+{
+	if (!scorePair(rec1, rec2, score, mode, filter, subtract, hashValues1,
+			hashValues2)) {
+		return false;
+	}
+	completeHashes(rec1, hashValues1, proc);
+	completeHashes(rec2, hashValues2, proc);
+	return true;
+}
+
+/*
+ * Inserts the passing pairs of an evaluated batch in input order
+ * Stops once m_expectedEntries is reached
+ * Returns the number of pairs of the batch committed
+ */
+size_t BloomFilterGenerator::commitPairs(const ReadPairBatch &batch,
+		BloomFilter &filter, ReadsProcessor &proc)
+{
+	for (size_t i = 0; i < batch.size; ++i) {
+		if (m_totalEntries >= m_expectedEntries) {
+			return i;
+		}
+		if (batch.pass[i]) {
+			insertRead(batch.reads1[i], batch.hashValues1[i], proc, filter);
+			insertRead(batch.reads2[i], batch.hashValues2[i], proc, filter);
+		}
+	}
+	return batch.size;
+}
+
+/*
+ * Computes hash values of the k-mers of a read not computed by evalRead
+ */
+void BloomFilterGenerator::completeHashes(const FastqRecord &rec,
+		vector<vector<size_t> > &hashValues, ReadsProcessor &proc) const
+{
+	for (size_t i = 0; i + m_kmerSize <= rec.seq.length(); ++i) {
+		if (hashValues[i].empty()) {
+			const unsigned char* currentSeq = proc.prepSeq(rec.seq, i);
+			if (currentSeq != NULL) {
+				hashValues[i] = multiHash(currentSeq, m_hashNum, m_kmerSize);
+			}
+		}
+	}
+}
+
+/*
+ * Scores a pair of reads against filter, true if it should be inserted
+ * Hash values computed are stored
+ */
+bool BloomFilterGenerator::scorePair(const FastqRecord &rec1,
+		const FastqRecord &rec2, double score, createMode mode,
+		const BloomFilter &filter, const BloomFilter *subtract,
+		vector<vector<size_t> > &hashValues1,
+		vector<vector<size_t> > &hashValues2) const
+{
+	string tempStr1 = rec1.id.substr(0, rec1.id.find_last_of("/"));
+	string tempStr2 = rec2.id.substr(0, rec2.id.find_last_of("/"));
+	if (tempStr1 != tempStr2) {
+		cerr << "Read IDs do not match" << "\n" << tempStr1 << "\n"
+				<< tempStr2 << endl;
+		exit(1);
+	}
+	size_t size1 = resetHashes(hashValues1, rec1.seq.length(), m_kmerSize);
+	size_t size2 = resetHashes(hashValues2, rec2.seq.length(), m_kmerSize);
+
+	bool pass = false;
+	switch (mode) {
+	case PROG_INC: {
+		pass = evalRead(rec1, size1, score, filter, subtract, hashValues1)
+				|| evalRead(rec2, size2, score, filter, subtract, hashValues2);
+		break;
+	}
+	case PROG_STD: {
+		pass = evalRead(rec1, size1, score, filter, subtract, hashValues1)
+				&& evalRead(rec2, size2, score, filter, subtract, hashValues2);
+		break;
+	}
+	}
+	return pass;
+}
+
+/*
+ * Evaluates read against filter, storing the hash values computed
+ */
+bool BloomFilterGenerator::evalRead(const FastqRecord &rec, size_t size,
+		double score, const BloomFilter &filter, const BloomFilter *subtract,
+		vector<vector<size_t> > &hashValues) const
+{
+	SeqEval::StoreHashes cache(rec.seq, m_kmerSize, m_hashNum, hashValues);
+	unsigned currentLoc = 0;
+	double readScore = 0;
+	return SeqEval::evalCore(rec.seq.length(), m_kmerSize,
+			SeqEval::SubtractProbe<BloomFilter>(filter, subtract), cache,
+			score * double(size), (1.0 - score) * double(size), currentLoc,
+			readScore);
+}
+
+/*
+ * Inserts all k-mers of read, reusing hash values computed by evalRead
+ */
+void BloomFilterGenerator::insertRead(const FastqRecord &rec,
+		const vector<vector<size_t> > &hashValues, ReadsProcessor &proc,
+		BloomFilter &filter)
+{
+	for (size_t i = 0; i + m_kmerSize <= rec.seq.length(); ++i) {
+		if (hashValues[i].empty()) {
+			const unsigned char* currentSeq = proc.prepSeq(rec.seq, i);
+			checkAndInsertKmer(currentSeq, filter);
+		} else {
+			insertKmer(hashValues[i], filter);
+		}
+	}
+}
 
 /*
  * Generates a bloom filter outputting it to a filename
@@ -518,9 +731,8 @@ size_t BloomFilterGenerator::generate(const string &filename,
 	BloomFilter filter(m_filterSize, m_hashNum, m_kmerSize);
 
 	//load other bloom filter info
-	string infoFileName = (subtractFilter).substr(0,
-			(subtractFilter).length() - 2) + "txt";
-	BloomFilterInfo subInfo(infoFileName);
+	BloomFilterFile subFile(subtractFilter);
+	const BloomFilterInfo &subInfo = subFile.getInfo();
 
 	//load other bloomfilter
 	BloomFilter filterSub(subInfo.getCalcuatedFilterSize(),
@@ -593,6 +805,15 @@ size_t BloomFilterGenerator::generate(const string &filename,
 			}
 		}
 	}
+	if (subInfo.getKmerSize() == m_kmerSize) {
+		for (vector<string>::const_iterator i = m_streamedFiles.begin();
+				i != m_streamedFiles.end(); ++i) {
+			kmerRemoved += insertStreamed(*i, filter, &filterSub);
+		}
+	} else if (!m_streamedFiles.empty()) {
+		cerr << "ERROR: Must use identical size k-mers in subtractive filter"
+				<< endl;
+	}
 
 	cerr << "Total Number of K-mers not added: " << kmerRemoved << endl;
 
@@ -600,11 +821,215 @@ size_t BloomFilterGenerator::generate(const string &filename,
 	return m_redundancy;
 }
 
+/*
+ * Counts the k-mers of all files (ie. reads) in a counting filter of
+ * counterNum counters, first pass of generateSolid()
+ * Returns an estimate of the number of distinct k-mers seen at least
+ * minCount times, which replaces the expected number of entries
+ */
+size_t BloomFilterGenerator::countKmers(unsigned minCount,
+		size_t counterNum) {
+	assert(minCount > 0 && minCount <= CountingBloomFilter::s_maxCount);
+	m_minCount = minCount;
+	m_counts.reset(new CountingBloomFilter(counterNum, m_hashNum));
+	HyperLogLog sketch;
+	scanReads(NULL, &sketch);
+	m_expectedEntries = max(sketch.estimate(), size_t(1));
+	return m_expectedEntries;
+}
+
+/*
+ * Generates a bloom filter of the solid k-mers of the files (ie. reads),
+ * k-mers seen at least the minimum number of times given to countKmers()
+ * outputting it to a filename
+ * Returns the m_redundancy rate of the k-mers inserted
+ */
+size_t BloomFilterGenerator::generateSolid(const string &filename) {
+	//k-mers must be counted first
+	assert(m_counts);
+
+	BloomFilter filter(m_filterSize, m_hashNum, m_kmerSize);
+	scanReads(&filter, NULL);
+	filter.storeFilter(filename);
+	return m_redundancy;
+}
+
+/*
+ * Reads all files sequentially, with reads split between threads
+ * If filter is NULL k-mers are counted and the ones reaching the minimum
+ * count added to sketch, otherwise k-mers with the minimum count are inserted
+ */
+void BloomFilterGenerator::scanReads(BloomFilter *filter,
+		HyperLogLog *sketch) {
+	vector<string> fileNames;
+	for (boost::unordered_map<string, vector<string> >::iterator i =
+			m_fileNamesAndHeaders.begin(); i != m_fileNamesAndHeaders.end(); ++i) {
+		fileNames.push_back(i->first);
+	}
+	sort(fileNames.begin(), fileNames.end());
+	fileNames.insert(fileNames.end(), m_streamedFiles.begin(),
+			m_streamedFiles.end());
+
+	for (vector<string>::const_iterator i = fileNames.begin();
+			i != fileNames.end(); ++i) {
+		cerr << "Processing File: " << *i << endl;
+		FastaReader sequence(i->c_str(), FastaReader::NO_FOLD_CASE);
+#pragma omp parallel
+		{
+			ReadsProcessor proc(m_kmerSize);
+			proc.setSpacedSeed(m_spacedSeed);
+			HyperLogLog threadSketch;
+			for (FastqRecord rec;;) {
+				bool good;
+#pragma omp critical(sequence)
+				good = sequence >> rec;
+				if (!good) {
+					break;
+				}
+				for (size_t j = 0; j + m_kmerSize <= rec.seq.length(); ++j) {
+					const unsigned char* currentSeq = proc.prepSeq(rec.seq, j);
+					if (currentSeq == NULL) {
+						continue;
+					}
+					const vector<size_t> &tempHash = multiHash(currentSeq,
+							m_hashNum, m_kmerSize);
+					if (filter == NULL) {
+						if (m_counts->insert(tempHash) >= m_minCount) {
+							threadSketch.add(tempHash[0]);
+						}
+					} else if (m_counts->count(tempHash) >= m_minCount) {
+						insertKmer(tempHash, *filter);
+					}
+				}
+			}
+			if (sketch != NULL) {
+#pragma omp critical(sketch)
+				sketch->merge(threadSketch);
+			}
+		}
+	}
+}
+
 //setters
 void BloomFilterGenerator::setFilterSize(size_t bits) {
 	m_filterSize = bits;
 }
 
+/*
+ * Saves filter and progress to prefix.ckpt.txt/.bf every interval seconds
+ * (never if 0), must be called after setFilterSize
+ * If resume, the build continues from the last checkpoint if there is one
+ */
+void BloomFilterGenerator::setCheckpoint(const string &prefix,
+		unsigned interval, bool resume) {
+	m_checkpoint.reset(
+			new BuildCheckpoint(prefix, interval, m_filterSize, m_hashNum,
+					m_kmerSize));
+	if (!resume) {
+		return;
+	}
+	if (!m_checkpoint->load()) {
+		cerr << "No checkpoint found, starting from the beginning" << endl;
+		return;
+	}
+	const BuildCheckpoint::State &state = m_checkpoint->getState();
+	m_sequencesDone = state.sequencesDone;
+	m_readPairsDone = state.readPairsDone;
+	m_totalEntries = state.totalEntries;
+	m_redundancy = state.redundancy;
+	m_resumed = true;
+	cerr << "Resuming from checkpoint " << m_checkpoint->getFilterPath()
+			<< " (" << m_sequencesDone << " sequences and " << m_readPairsDone
+			<< " read pairs done)" << endl;
+}
+
+/*
+ * Progressive filters are made the same regardless of the number of threads
+ * (reads of a batch do not see the k-mers inserted by each other)
+ */
+void BloomFilterGenerator::setDeterministic(bool deterministic) {
+	m_deterministic = deterministic;
+}
+
+/*
+ * Only minimizers of windows of w k-mers are inserted into the filter
+ * Expected entries derived from sequence sizes are scaled accordingly
+ */
+void BloomFilterGenerator::setMinimizerWindow(unsigned window) {
+	m_minimizerWindow = window;
+	if (m_derivedEntries) {
+		m_expectedEntries = size_t(
+				m_expectedEntries * MinimizerSampler::getDensity(window)) + 1;
+	}
+}
+
+/*
+ * Counts the occurrences of the k-mers inserted in counterNum counters, so
+ * repetitive k-mers of the filter can be found (see storeAbundance)
+ */
+void BloomFilterGenerator::setAbundance(size_t counterNum) {
+	m_abundance.reset(new CountingBloomFilter(counterNum, m_hashNum));
+}
+
+/*
+ * Outputs the counters of setAbundance to a filename
+ */
+void BloomFilterGenerator::storeAbundance(const string &filename) const {
+	assert(m_abundance);
+	m_abundance->storeFilter(filename);
+}
+
+/*
+ * Sets spaced seed mask applied to each k-mer inserted
+ */
+void BloomFilterGenerator::setSpacedSeed(const string &seed) {
+	m_spacedSeed = seed;
+}
+
+/*
+ * Restricts the sequences inserted to one of shardNum disjoint subsets of the
+ * input (shard counts from 0), so that shards can be built separately and
+ * merged. Indexed sequences are split by header and streamed files by file.
+ * Expected entries are not changed so all shards have the same size.
+ */
+void BloomFilterGenerator::setShard(unsigned shard, unsigned shardNum) {
+	assert(shard < shardNum);
+	//order must not depend on the hash map so every shard sees the same split
+	vector<string> fileNames;
+	for (boost::unordered_map<string, vector<string> >::iterator i =
+			m_fileNamesAndHeaders.begin(); i != m_fileNamesAndHeaders.end(); ++i) {
+		fileNames.push_back(i->first);
+	}
+	sort(fileNames.begin(), fileNames.end());
+
+	size_t index = 0;
+	boost::unordered_map<string, vector<string> > shardHeaders;
+	for (vector<string>::iterator i = fileNames.begin(); i != fileNames.end();
+			++i) {
+		const vector<string> &headers = m_fileNamesAndHeaders[*i];
+		vector<string> kept;
+		for (vector<string>::const_iterator j = headers.begin();
+				j != headers.end(); ++j) {
+			if (index++ % shardNum == shard) {
+				kept.push_back(*j);
+			}
+		}
+		if (!kept.empty()) {
+			shardHeaders[*i] = kept;
+		}
+	}
+	m_fileNamesAndHeaders.swap(shardHeaders);
+
+	vector<string> shardStreamed;
+	for (vector<string>::iterator i = m_streamedFiles.begin();
+			i != m_streamedFiles.end(); ++i) {
+		if (index++ % shardNum == shard) {
+			shardStreamed.push_back(*i);
+		}
+	}
+	m_streamedFiles.swap(shardStreamed);
+}
+
 //getters
 
 /*
@@ -614,6 +1039,14 @@ size_t BloomFilterGenerator::getTotalEntries() const {
 	return m_totalEntries;
 }
 
+/*
+ * True if some files are streamed, their k-mers are not counted in the
+ * expected number of entries derived from sequence sizes
+ */
+bool BloomFilterGenerator::hasStreamedFiles() const {
+	return !m_streamedFiles.empty();
+}
+
 /*
  * Returns the maximum possible number of expected filter entries based on inputs
  */
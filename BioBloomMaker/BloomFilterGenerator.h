@@ -10,10 +10,17 @@
 #include <boost/unordered/unordered_map.hpp>
 #include <vector>
 #include "Common/BloomFilter.h"
+#include "Common/CountingBloomFilter.h"
+#include "Common/ReadsProcessor.h"
+#include "DataLayer/FastaReader.h"
+#include "BuildCheckpoint.h"
+#include <boost/shared_ptr.hpp>
 using namespace std;
 
 enum createMode{PROG_STD, PROG_INC};
 
+class HyperLogLog;
+
 class BloomFilterGenerator {
 public:
 	explicit BloomFilterGenerator(vector<string> const &filenames,
@@ -23,19 +30,32 @@ public:
 			unsigned kmerSize, unsigned hashNum);
 
 
+	size_t estimateEntries();
+	size_t countKmers(unsigned minCount, size_t counterNum);
+
 	//TODO: THREAD ME!
 	size_t generate(const string &filename);
 	size_t generate(const string &filename, const string &subtractFilter);
+	size_t update(const string &filename, const string &existingFilter);
+	size_t generateSolid(const string &filename);
 	size_t generateProgressive(const string &filename, double score,
 			const string &file1, const string &file2, createMode mode);
 	size_t generateProgressive(const string &filename, double score,
 			const string &file1, const string &file2, createMode mode,
 			const string &subtractFilter);
 	void setFilterSize(size_t bits);
+	void setDeterministic(bool deterministic);
+	void setCheckpoint(const string &prefix, unsigned interval, bool resume);
+	void setAbundance(size_t counterNum);
+	void storeAbundance(const string &filename) const;
 
 	void setHashFuncs(unsigned numFunc);
+	void setMinimizerWindow(unsigned window);
+	void setSpacedSeed(const string &seed);
+	void setShard(unsigned shard, unsigned shardNum);
 	size_t getTotalEntries() const;
 	size_t getExpectedEntries() const;
+	bool hasStreamedFiles() const;
 
 	virtual ~BloomFilterGenerator();
 private:
@@ -45,8 +65,81 @@ private:
 	size_t m_filterSize;
 	size_t m_totalEntries;
 	size_t m_redundancy;
+	unsigned m_minimizerWindow;
+	//expected entries derived from sequence size rather than set by user
+	bool m_derivedEntries;
+	//empty if all bases of each k-mer are used
+	string m_spacedSeed;
 
 	boost::unordered_map<string, vector<string> > m_fileNamesAndHeaders;
+	//files without fasta index (or compressed) are read sequentially
+	vector<string> m_streamedFiles;
+
+	//occurrences of k-mers of reads, only k-mers seen m_minCount times are
+	//inserted by generateSolid()
+	boost::shared_ptr<CountingBloomFilter> m_counts;
+	unsigned m_minCount;
+	//occurrences of k-mers inserted, including redundant ones (see
+	//setAbundance)
+	boost::shared_ptr<CountingBloomFilter> m_abundance;
+	//progressive filters do not depend on thread scheduling
+	bool m_deterministic;
+
+	//progress of build, saved in checkpoints
+	boost::shared_ptr<BuildCheckpoint> m_checkpoint;
+	size_t m_sequencesDone;
+	size_t m_readPairsDone;
+	//filter must be restored from checkpoint
+	bool m_resumed;
+
+	size_t insertStreamed(const string &fileName, BloomFilter &filter,
+			const BloomFilter *subtract);
+	void insertSequences(BloomFilter &filter);
+	void checkpoint(const BloomFilter &filter);
+	void finishCheckpoint();
+	void scanReads(BloomFilter *filter, HyperLogLog *sketch);
+
+	//pairs of reads processed at once in progressive mode
+	struct ReadPairBatch {
+		vector<FastqRecord> reads1;
+		vector<FastqRecord> reads2;
+		size_t size;
+		//evaluation results kept until insertion in deterministic mode
+		vector<char> pass;
+		vector<vector<vector<size_t> > > hashValues1;
+		vector<vector<vector<size_t> > > hashValues2;
+	};
+	static const size_t s_batchSize = 4096;
+
+	size_t readPairs(FastaReader &sequence1, FastaReader &sequence2,
+			ReadPairBatch &batch, size_t &totalReads);
+	void insertReadPairs(BloomFilter &filter, double score,
+			const string &file1, const string &file2, createMode mode,
+			const BloomFilter *subtract);
+	void insertPair(const FastqRecord &rec1, const FastqRecord &rec2,
+			double score, createMode mode, BloomFilter &filter,
+			const BloomFilter *subtract, ReadsProcessor &proc,
+			vector<vector<size_t> > &hashValues1,
+			vector<vector<size_t> > &hashValues2);
+	bool evalPair(const FastqRecord &rec1, const FastqRecord &rec2,
+			double score, createMode mode, const BloomFilter &filter,
+			const BloomFilter *subtract, ReadsProcessor &proc,
+			vector<vector<size_t> > &hashValues1,
+			vector<vector<size_t> > &hashValues2) const;
+	size_t commitPairs(const ReadPairBatch &batch, BloomFilter &filter,
+			ReadsProcessor &proc);
+	bool scorePair(const FastqRecord &rec1, const FastqRecord &rec2,
+			double score, createMode mode, const BloomFilter &filter,
+			const BloomFilter *subtract, vector<vector<size_t> > &hashValues1,
+			vector<vector<size_t> > &hashValues2) const;
+	bool evalRead(const FastqRecord &rec, size_t size, double score,
+			const BloomFilter &filter, const BloomFilter *subtract,
+			vector<vector<size_t> > &hashValues) const;
+	void completeHashes(const FastqRecord &rec,
+			vector<vector<size_t> > &hashValues, ReadsProcessor &proc) const;
+	void insertRead(const FastqRecord &rec,
+			const vector<vector<size_t> > &hashValues, ReadsProcessor &proc,
+			BloomFilter &filter);
 
 	inline void checkAndInsertKmer(const unsigned char* currentSeq,
 			BloomFilter &filter)
@@ -61,6 +154,9 @@ private:
 	inline void insertKmer(const vector<size_t> &hashVals,
 			BloomFilter &filter)
 	{
+		if (m_abundance) {
+			m_abundance->insert(hashVals);
+		}
 		if (filter.contains(hashVals)) {
 #pragma omp atomic
 			m_redundancy++;
@@ -0,0 +1,220 @@
+/*
+ * BloomFilterMerger.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "BloomFilterMerger.h"
+#include "Common/BloomFilter.h"
+#include "Common/IOUtil.h"
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <cassert>
+#include <cmath>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#if _OPENMP
+# include <omp.h>
+#endif
+
+const double BloomFilterMerger::s_maxLoss = 0.05;
+
+/*
+ * Loads the information of the filters (single files or next to each .bf
+ * file) and checks that the filters can be combined
+ */
+BloomFilterMerger::BloomFilterMerger(const vector<string> &filterFiles,
+		Operation operation) :
+		m_filterFiles(filterFiles), m_operation(operation), m_setBits(0), m_force(
+				false)
+{
+	assert(!filterFiles.empty());
+	for (vector<string>::const_iterator i = filterFiles.begin();
+			i != filterFiles.end(); ++i) {
+		if (i->length() < 3 || i->substr(i->length() - 3) != ".bf") {
+			cerr << "Error: Filter to combine must end in .bf: " << *i << endl;
+			exit(1);
+		}
+		m_files.push_back(
+				boost::shared_ptr<BloomFilterFile>(new BloomFilterFile(*i)));
+		m_infos.push_back(m_files.back()->getInfo());
+		const BloomFilterInfo &first = m_infos.front();
+		const BloomFilterInfo &info = m_infos.back();
+		if (info.getCalcuatedFilterSize() != first.getCalcuatedFilterSize()
+				|| info.getHashNum() != first.getHashNum()
+				|| info.getKmerSize() != first.getKmerSize()
+				|| info.getMinimizerWindow() != first.getMinimizerWindow()
+				|| info.getSpacedSeed() != first.getSpacedSeed()) {
+			cerr << "Error: " << *i << " cannot be combined with "
+					<< filterFiles.front()
+					<< ". Filters must have the same size, number of hash "
+							"functions, k-mer size, minimizer window and "
+							"spaced seed." << endl;
+			exit(1);
+		}
+	}
+}
+
+/*
+ * Writes the difference even if more than s_maxLoss of the entries of the
+ * first filter are estimated to be lost
+ */
+void BloomFilterMerger::setForce(bool force)
+{
+	m_force = force;
+}
+
+/*
+ * Outputs the union, intersection or difference of the filters to a filename
+ * Blocks of the filters are read and combined in parallel, bits set are
+ * counted as they are written
+ */
+void BloomFilterMerger::merge(const string &filename)
+{
+	size_t sizeInBytes = m_infos.front().getCalcuatedFilterSize() / bitsPerChar;
+
+	vector<int> fds;
+	for (vector<string>::const_iterator i = m_filterFiles.begin();
+			i != m_filterFiles.end(); ++i) {
+		int fd = open(i->c_str(), O_RDONLY);
+		struct stat sb;
+		if (fd == -1 || fstat(fd, &sb) == -1) {
+			cerr << "file \"" << *i << "\" could not be read." << endl;
+			exit(1);
+		}
+		//sizes of single files are checked when their header is read
+		if (!m_files[fds.size()]->isSingleFile()
+				&& size_t(sb.st_size) != sizeInBytes) {
+			cerr << "Error: " << *i
+					<< " does not match size given by its information file. Size: "
+					<< sb.st_size << " vs " << sizeInBytes << " bytes." << endl;
+			exit(1);
+		}
+		fds.push_back(fd);
+	}
+	//output replaces the file only once done, so it may be an input
+	string tempPath = filename + ".tmp";
+	int out = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (out == -1 || ftruncate(out, sizeInBytes) == -1) {
+		cerr << "file \"" << tempPath << "\" could not be written." << endl;
+		exit(1);
+	}
+
+	cerr << "Merging " << fds.size() << " filters. Filter is " << sizeInBytes
+			<< "bytes." << endl;
+	size_t blockNum = (sizeInBytes + s_blockSize - 1) / s_blockSize;
+	size_t setBits = 0;
+	size_t otherSetBits = 0;
+#pragma omp parallel reduction(+:setBits, otherSetBits)
+	{
+		vector<unsigned char> merged(s_blockSize);
+		vector<unsigned char> others(s_blockSize);
+		vector<unsigned char> block(s_blockSize);
+#pragma omp for schedule(dynamic)
+		for (long i = 0; i < long(blockNum); ++i) {
+			off_t offset = off_t(i) * s_blockSize;
+			size_t size = min(s_blockSize, sizeInBytes - size_t(offset));
+			m_files[0]->readBlocks(fds[0], &merged[0], offset, size);
+			fill(others.begin(), others.begin() + size, 0);
+			for (size_t j = 1; j < fds.size(); ++j) {
+				m_files[j]->readBlocks(fds[j], &block[0], offset, size);
+				if (m_operation == INTERSECTION) {
+					for (size_t k = 0; k < size; ++k) {
+						merged[k] &= block[k];
+					}
+				} else {
+					for (size_t k = 0; k < size; ++k) {
+						others[k] |= block[k];
+					}
+				}
+			}
+			for (size_t k = 0; k < size; ++k) {
+				if (m_operation == UNION) {
+					merged[k] |= others[k];
+				} else if (m_operation == DIFFERENCE) {
+					merged[k] &= ~others[k];
+				}
+				setBits += __builtin_popcount(merged[k]);
+				otherSetBits += __builtin_popcount(others[k]);
+			}
+			writeBlock(out, &merged[0], size, offset, tempPath);
+		}
+	}
+	m_setBits = setBits;
+	for (vector<int>::iterator i = fds.begin(); i != fds.end(); ++i) {
+		close(*i);
+	}
+
+	if (m_operation == DIFFERENCE) {
+		//a remaining entry is lost if any of its bits is set in the others
+		double otherOccupancy = double(otherSetBits)
+				/ double(sizeInBytes * bitsPerChar);
+		double lost = 1.0
+				- pow(1.0 - otherOccupancy,
+						double(m_infos.front().getHashNum()));
+		if (lost > s_maxLoss && !m_force) {
+			close(out);
+			unlink(tempPath.c_str());
+			cerr << "Error: About " << lost * 100 << "% of the entries of "
+					<< m_filterFiles.front()
+					<< " not in the other filters would be removed as well, "
+							"so the difference was not written. Use "
+							"biobloomcategorizer --subtract to leave out the "
+							"k-mers of the other filters when classifying, or "
+							"-x to write the difference anyway." << endl;
+			exit(1);
+		}
+		cerr << "Warning: The difference of filters is approximate. About "
+				<< lost * 100 << "% of the entries of " << m_filterFiles.front()
+				<< " not in the other filters were removed as well." << endl;
+	}
+	if (close(out) != 0 || rename(tempPath.c_str(), filename.c_str()) != 0) {
+		cerr << "file \"" << filename << "\" could not be written." << endl;
+		exit(1);
+	}
+}
+
+/*
+ * Information of the combined filter, with the fraction of bits set counted
+ * by merge()
+ * For the union entry and redundancy counts are summed (k-mers found in
+ * several filters are counted more than once, so the false positive rate
+ * given is an upper bound). Otherwise the number of entries is estimated from
+ * the fraction of bits set, n = -m / h * ln(1 - occupancy).
+ */
+BloomFilterInfo BloomFilterMerger::getMergedInfo(const string &filterID) const
+{
+	BloomFilterInfo info(m_infos.front());
+	info.setFilterID(filterID);
+	size_t totalNum = 0;
+	size_t redundancy = 0;
+	for (vector<BloomFilterInfo>::const_iterator i = m_infos.begin();
+			i != m_infos.end(); ++i) {
+		if (i != m_infos.begin()) {
+			info.addSeqSrcs(i->getSeqSrcs());
+		}
+		totalNum += i->getTotalNum();
+		redundancy += i->getRedundancy();
+	}
+	double size = double(info.getCalcuatedFilterSize());
+	double occupancy = double(m_setBits) / size;
+	if (m_operation != UNION) {
+		//bounded for a filter with every bit set, information needs an entry
+		double empty = max(1.0 - occupancy, 1.0 / size);
+		totalNum = max(size_t(-size / info.getHashNum() * log(empty) + 0.5),
+				size_t(1));
+		redundancy = 0;
+	}
+	info.setTotalNum(totalNum);
+	info.setRedundancy(redundancy);
+	info.setOccupancy(occupancy);
+	//counts are kept next to each filter and are not combined
+	info.setAbundanceCounters(0);
+	return info;
+}
+
+BloomFilterMerger::~BloomFilterMerger()
+{
+}
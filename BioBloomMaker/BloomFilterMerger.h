@@ -0,0 +1,61 @@
+/*
+ * BloomFilterMerger.h
+ *
+ * Combines filters built separately with the same parameters into a single
+ * filter: the union of their entries (bitwise OR, i.e. shards of a reference
+ * too large to be built at once), their intersection (bitwise AND) or the
+ * entries of the first filter not in the others (AND NOT).
+ *
+ * The difference is approximate: entries of the first filter sharing any bit
+ * with the other filters are removed as well (false negatives). It is not
+ * written if too many are estimated to be lost, unless forced.
+ *
+ * Filters are streamed in blocks so memory use does not depend on filter size.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef BLOOMFILTERMERGER_H_
+#define BLOOMFILTERMERGER_H_
+
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include "Common/BloomFilterInfo.h"
+#include "Common/BloomFilterFile.h"
+
+using namespace std;
+
+class BloomFilterMerger {
+public:
+	enum Operation {
+		UNION, INTERSECTION, DIFFERENCE
+	};
+
+	explicit BloomFilterMerger(const vector<string> &filterFiles,
+			Operation operation = UNION);
+
+	void setForce(bool force);
+	void merge(const string &filename);
+	BloomFilterInfo getMergedInfo(const string &filterID) const;
+
+	virtual ~BloomFilterMerger();
+private:
+	BloomFilterMerger(const BloomFilterMerger& that); //to prevent copy construction
+
+	vector<string> m_filterFiles;
+	vector<boost::shared_ptr<BloomFilterFile> > m_files;
+	vector<BloomFilterInfo> m_infos;
+	Operation m_operation;
+	//bits set in the combined filter, counted by merge()
+	size_t m_setBits;
+	//difference is written whatever the fraction of entries lost
+	bool m_force;
+
+	//bytes of each filter processed at once by a thread
+	static const size_t s_blockSize = 1 << 22;
+	//largest estimated fraction of entries lost by a difference not forced
+	static const double s_maxLoss;
+};
+
+#endif /* BLOOMFILTERMERGER_H_ */
@@ -0,0 +1,194 @@
+/*
+ * BuildCheckpoint.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "BuildCheckpoint.h"
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/ini_parser.hpp>
+
+/*
+ * Files written are prefix.ckpt.txt (state) and prefix.ckpt.N.bf (filter of
+ * the N-th checkpoint)
+ */
+BuildCheckpoint::BuildCheckpoint(const string &prefix, unsigned interval,
+		size_t filterSize, unsigned hashNum, unsigned kmerSize) :
+		m_statePath(prefix + ".ckpt.txt"), m_prefix(prefix), m_interval(
+				interval), m_filterSize(filterSize), m_hashNum(hashNum), m_kmerSize(
+				kmerSize), m_lastSave(time(NULL)), m_writer(0), m_generation(0)
+{
+	m_state.sequencesDone = 0;
+	m_state.readPairsDone = 0;
+	m_state.totalEntries = 0;
+	m_state.redundancy = 0;
+}
+
+const string BuildCheckpoint::filterPath(unsigned generation) const
+{
+	stringstream path;
+	path << m_prefix << ".ckpt." << generation << ".bf";
+	return path.str();
+}
+
+/*
+ * Loads the state of the last checkpoint
+ * Returns false if there is no checkpoint
+ */
+bool BuildCheckpoint::load()
+{
+	ifstream stateFile(m_statePath.c_str());
+	if (!stateFile.good()) {
+		return false;
+	}
+	boost::property_tree::ptree pt;
+	boost::property_tree::ini_parser::read_ini(stateFile, pt);
+	if (pt.get<size_t>("checkpoint.size") != m_filterSize
+			|| pt.get<unsigned>("checkpoint.number_of_hash_functions")
+					!= m_hashNum
+			|| pt.get<unsigned>("checkpoint.kmer_size") != m_kmerSize) {
+		cerr << "Error: Checkpoint " << m_statePath
+				<< " was made with a different filter size, number of hash "
+						"functions or k-mer size." << endl;
+		exit(1);
+	}
+	m_generation = pt.get<unsigned>("checkpoint.generation");
+	m_filterPath = filterPath(m_generation);
+	m_state.sequencesDone = pt.get<size_t>("checkpoint.sequences_done");
+	m_state.readPairsDone = pt.get<size_t>("checkpoint.read_pairs_done");
+	m_state.totalEntries = pt.get<size_t>("checkpoint.num_entries");
+	m_state.redundancy = pt.get<size_t>("checkpoint.redundant_sequences");
+	return true;
+}
+
+/*
+ * True once the interval has passed since the last checkpoint
+ * (never if interval is 0)
+ */
+bool BuildCheckpoint::isDue() const
+{
+	return m_interval > 0 && difftime(time(NULL), m_lastSave) >= m_interval;
+}
+
+/*
+ * Writes filter and state from a child process
+ * Skipped if the previous checkpoint is still being written
+ */
+void BuildCheckpoint::save(const BloomFilter &filter, const State &state)
+{
+	if (!waitWriter(false)) {
+		return;
+	}
+	m_lastSave = time(NULL);
+
+	//everything the child needs is prepared here, it must not allocate memory
+	unsigned generation = m_generation + 1;
+	string newFilterPath = filterPath(generation);
+	string oldFilterPath = m_filterPath;
+	string tempStatePath = m_statePath + ".tmp";
+	stringstream stateStream;
+	stateStream << "[checkpoint]\ngeneration=" << generation << "\nsize="
+			<< m_filterSize << "\nnumber_of_hash_functions=" << m_hashNum
+			<< "\nkmer_size=" << m_kmerSize << "\nsequences_done="
+			<< state.sequencesDone << "\nread_pairs_done="
+			<< state.readPairsDone << "\nnum_entries=" << state.totalEntries
+			<< "\nredundant_sequences=" << state.redundancy << "\n";
+	string stateText = stateStream.str();
+
+	pid_t pid = fork();
+	if (pid == -1) {
+		cerr << "Warning: Checkpoint could not be written." << endl;
+		return;
+	}
+	if (pid == 0) {
+		int fd = open(newFilterPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+				0644);
+		if (fd == -1 || !filter.storeFilter(fd) || fsync(fd) != 0
+				|| close(fd) != 0) {
+			_exit(1);
+		}
+		fd = open(tempStatePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd == -1
+				|| write(fd, stateText.c_str(), stateText.length())
+						!= ssize_t(stateText.length()) || fsync(fd) != 0
+				|| close(fd) != 0
+				|| rename(tempStatePath.c_str(), m_statePath.c_str()) != 0) {
+			_exit(1);
+		}
+		if (!oldFilterPath.empty()) {
+			unlink(oldFilterPath.c_str());
+		}
+		_exit(0);
+	}
+	m_writer = pid;
+	m_pendingState = state;
+}
+
+/*
+ * Waits for (or if not block, checks) the process writing the last checkpoint
+ * The checkpoint replaces the previous one only if it was written completely,
+ * otherwise its partial files are removed
+ * Returns true if no checkpoint is being written
+ */
+bool BuildCheckpoint::waitWriter(bool block)
+{
+	if (m_writer == 0) {
+		return true;
+	}
+	int status;
+	pid_t pid = waitpid(m_writer, &status, block ? 0 : WNOHANG);
+	if (pid == 0) {
+		return false;
+	}
+	m_writer = 0;
+	string newFilterPath = filterPath(m_generation + 1);
+	if (pid == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		cerr << "Warning: Checkpoint " << newFilterPath
+				<< " could not be written." << endl;
+		unlink(newFilterPath.c_str());
+		unlink((m_statePath + ".tmp").c_str());
+		return true;
+	}
+	++m_generation;
+	m_filterPath = newFilterPath;
+	m_state = m_pendingState;
+	return true;
+}
+
+/*
+ * Build is complete, checkpoint files are removed
+ */
+void BuildCheckpoint::finish()
+{
+	waitWriter(true);
+	remove(m_statePath.c_str());
+	if (!m_filterPath.empty()) {
+		remove(m_filterPath.c_str());
+	}
+}
+
+const BuildCheckpoint::State &BuildCheckpoint::getState() const
+{
+	return m_state;
+}
+
+/*
+ * Filter of the checkpoint loaded (or last written)
+ */
+const string &BuildCheckpoint::getFilterPath() const
+{
+	return m_filterPath;
+}
+
+BuildCheckpoint::~BuildCheckpoint()
+{
+	waitWriter(true);
+}
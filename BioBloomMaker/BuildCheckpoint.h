@@ -0,0 +1,71 @@
+/*
+ * BuildCheckpoint.h
+ *
+ * Periodically saves the filter being built and the progress of the build,
+ * so that interrupted builds can be resumed
+ *
+ * Checkpoints are written by a child process from a copy-on-write snapshot
+ * of the filter (fork), so insertion continues while they are written. The
+ * state file is replaced last, it always refers to a complete filter file.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef BUILDCHECKPOINT_H_
+#define BUILDCHECKPOINT_H_
+
+#include <string>
+#include <ctime>
+#include <sys/types.h>
+#include "Common/BloomFilter.h"
+
+using namespace std;
+
+class BuildCheckpoint {
+public:
+	//progress of a build
+	struct State {
+		//sequences (or files read without index) inserted
+		size_t sequencesDone;
+		//pairs of reads evaluated in progressive mode
+		size_t readPairsDone;
+		size_t totalEntries;
+		size_t redundancy;
+	};
+
+	explicit BuildCheckpoint(const string &prefix, unsigned interval,
+			size_t filterSize, unsigned hashNum, unsigned kmerSize);
+
+	bool load();
+	bool isDue() const;
+	void save(const BloomFilter &filter, const State &state);
+	void finish();
+
+	const State &getState() const;
+	const string &getFilterPath() const;
+
+	virtual ~BuildCheckpoint();
+private:
+	BuildCheckpoint(const BuildCheckpoint& that); //to prevent copy construction
+
+	bool waitWriter(bool block);
+	const string filterPath(unsigned generation) const;
+
+	string m_statePath;
+	string m_prefix;
+	unsigned m_interval;
+	size_t m_filterSize;
+	unsigned m_hashNum;
+	unsigned m_kmerSize;
+
+	time_t m_lastSave;
+	//child process writing the last checkpoint, 0 if none
+	pid_t m_writer;
+	unsigned m_generation;
+	State m_state;
+	string m_filterPath;
+	//state of the checkpoint being written, kept once it is complete
+	State m_pendingState;
+};
+
+#endif /* BUILDCHECKPOINT_H_ */
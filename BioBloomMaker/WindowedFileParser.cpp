@@ -1,25 +1,49 @@
 /*
  * WindowedFileParser.cpp
  *
- * Currently for fasta files only and needs fasta index. Parse file line by line.
+ * Currently for fasta files only and needs fasta index. File is memory mapped
+ * and sequences are copied out in chunks, skipping newlines using the index.
  *
  *  Created on: Jul 18, 2012
  *      Author: cjustin
  */
 #include "WindowedFileParser.h"
 #include <sstream>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "DataLayer/FastaIndex.h"
 
 WindowedFileParser::WindowedFileParser(string const &fileName,
 		unsigned windowSize) :
-		m_windowSize(windowSize), m_proc(ReadsProcessor(windowSize))
+		m_fd(-1), m_data(NULL), m_dataSize(0), m_windowSize(windowSize), m_seqPos(
+				0), m_currentLinePos(0), m_proc(windowSize), m_sequenceNotEnd(
+				false)
 {
-	m_fastaFileHandle.open(fileName.c_str(), ifstream::in);
-	assert(m_fastaFileHandle);
-
 	//create in memory index
 	WindowedFileParser::initializeIndex(fileName);
-	m_currentHeader = "";
+
+	//map file so sequence is copied without reading line by line
+	m_fd = open(fileName.c_str(), O_RDONLY);
+	struct stat fileStat;
+	if (m_fd == -1 || fstat(m_fd, &fileStat) == -1) {
+		cerr << "Error: Cannot open fasta file " << fileName << endl;
+		exit(1);
+	}
+	m_dataSize = fileStat.st_size;
+	if (m_dataSize > 0) {
+		void* data = mmap(NULL, m_dataSize, PROT_READ, MAP_PRIVATE, m_fd, 0);
+		if (data == MAP_FAILED) {
+			cerr << "Error: Cannot map fasta file " << fileName << endl;
+			exit(1);
+		}
+#ifdef MADV_SEQUENTIAL
+		madvise(data, m_dataSize, MADV_SEQUENTIAL);
+#endif
+		m_data = static_cast<const char*>(data);
+	}
 	setLocationByHeader(m_headers[0]);
 }
 
@@ -31,19 +55,32 @@ const vector<string> WindowedFileParser::getHeaders() const
 //sets the location in the file to the start of the sequence given a header
 void WindowedFileParser::setLocationByHeader(string const &header)
 {
-	m_sequenceNotEnd = true;
-	m_currentHeader = header;
-	m_fastaFileHandle.seekg(m_fastaIndex[header].start, ios::beg);
-	m_currentEndSeqPos = m_windowSize - 1;
-	string bufferString;
-	getline(m_fastaFileHandle, m_currentString);
-	while ((m_currentString.length() < m_windowSize)
-			&& (m_currentEndSeqPos < m_fastaIndex[m_currentHeader].size)
-			&& getline(m_fastaFileHandle, bufferString))
-	{
-		m_currentString += bufferString;
+	m_current = m_fastaIndex.at(header);
+	//index must describe the file mapped
+	if (m_current.size > 0) {
+		size_t last = m_current.size - 1;
+		if (m_current.bpPerLine == 0
+				|| m_current.charsPerLine < m_current.bpPerLine
+				|| m_current.start + last / m_current.bpPerLine * m_current.charsPerLine
+						+ last % m_current.bpPerLine >= m_dataSize)
+		{
+			cerr << "Error: Fasta index does not match fasta file at "
+					<< header << ". Re-index the file with samtools faidx."
+					<< endl;
+			exit(1);
+		}
 	}
+	m_sequenceNotEnd = true;
+	m_seqPos = 0;
 	m_currentLinePos = 0;
+	m_currentString.clear();
+	loadChunk();
+}
+
+//sets spaced seed applied to k-mers returned by getNextSeq
+void WindowedFileParser::setSpacedSeed(const string &seed)
+{
+	m_proc.setSpacedSeed(seed);
 }
 
 size_t WindowedFileParser::getSequenceSize(string const &header) const
@@ -51,8 +88,32 @@ size_t WindowedFileParser::getSequenceSize(string const &header) const
 	return m_fastaIndex.at(header).size;
 }
 
-//Todo: Optimize to skip sections when finding a non ATCG character
-// Also upper case conversion should occur only once.
+/*
+ * Copies the next chunk of bases of the current sequence into
+ * m_currentString, keeping the bases of k-mers not yet returned
+ * Newlines are skipped using the line lengths of the index
+ * Returns false if there are no more bases
+ */
+bool WindowedFileParser::loadChunk()
+{
+	if (m_seqPos >= m_current.size) {
+		return false;
+	}
+	m_currentString.erase(0, m_currentLinePos);
+	m_currentLinePos = 0;
+	size_t end = min(m_current.size, m_seqPos + s_chunkSize);
+	while (m_seqPos < end) {
+		size_t lineOffset = m_seqPos % m_current.bpPerLine;
+		size_t count = min(m_current.bpPerLine - lineOffset, end - m_seqPos);
+		m_currentString.append(
+				m_data + m_current.start
+						+ m_seqPos / m_current.bpPerLine
+								* m_current.charsPerLine + lineOffset, count);
+		m_seqPos += count;
+	}
+	return true;
+}
+
 /*
  * Return the next string in sliding window, also cleans and formats
  * sequences using ReadProcessor
@@ -60,21 +121,10 @@ size_t WindowedFileParser::getSequenceSize(string const &header) const
 const unsigned char* WindowedFileParser::getNextSeq()
 {
 	if (m_currentString.length() < m_windowSize + m_currentLinePos) {
-		m_currentString.erase(0, m_currentLinePos);
-		m_currentEndSeqPos += m_currentLinePos;
-		m_currentLinePos = 0;
-		//grow the sequence to match the correct window size
-		//stop if there are no more lines left in fasta file
-		while (m_fastaFileHandle.is_open()
-				&& (m_currentString.length() < m_windowSize)
-				&& (m_currentEndSeqPos < m_fastaIndex[m_currentHeader].size)
-				&& getline(m_fastaFileHandle, m_bufferString))
-		{
-			m_currentString += m_bufferString;
-		}
-
 		//if there is not enough sequence for a full kmer
-		if (m_currentString.length() < m_windowSize) {
+		if (!loadChunk()
+				|| m_currentString.length() < m_windowSize + m_currentLinePos)
+		{
 			m_sequenceNotEnd = false;
 			return NULL;
 		}
@@ -123,6 +173,11 @@ void WindowedFileParser::initializeIndex(string const &fileName)
 
 WindowedFileParser::~WindowedFileParser()
 {
-	m_fastaFileHandle.close();
+	if (m_data != NULL) {
+		munmap(const_cast<char*>(m_data), m_dataSize);
+	}
+	if (m_fd != -1) {
+		close(m_fd);
+	}
 }
 
@@ -25,6 +25,7 @@ public:
 	explicit WindowedFileParser(const string &fileName, unsigned windowSize);
 	const vector<string> getHeaders() const;
 	void setLocationByHeader( const string &header);
+	void setSpacedSeed(const string &seed);
 	size_t getSequenceSize( const string &header) const;
 	const unsigned char* getNextSeq();
 	bool notEndOfSeqeunce() const;
@@ -40,22 +41,31 @@ private:
 		size_t charsPerLine;
 	};
 
+	//bases copied out of the file at a time
+	static const size_t s_chunkSize = 1 << 16;
+
 	unordered_map<string, FastaIndexValue> m_fastaIndex;
-	ifstream m_fastaFileHandle;
+	//fasta file is memory mapped
+	int m_fd;
+	const char* m_data;
+	size_t m_dataSize;
 	unsigned m_windowSize;
 	vector<string> m_headers;
-	string m_currentHeader;
-	size_t m_currentEndSeqPos;
+	FastaIndexValue m_current;
+	//position in current sequence of the next base to copy
+	size_t m_seqPos;
+	//position of next k-mer in m_currentString
 	size_t m_currentLinePos;
-	string m_window;
+	//bases of current chunk (with the last k-1 bases of previous chunk)
 	string m_currentString;
 	ReadsProcessor m_proc;
 	bool m_sequenceNotEnd;
 
-	string m_bufferString; //so reallocation does not need to occur
-
 	//helper methods
 	void initializeIndex(string const &fileName);
+	bool loadChunk();
+
+	WindowedFileParser(const WindowedFileParser& that); //to prevent copy construction
 
 };
 
@@ -6,6 +6,7 @@
  */
 //@TODO: experiment with hash concepts by Adam Kirsch and Michael Mitzenmacher in Building a Better Bloom Filter
 #include "BloomFilter.h"
+#include "BloomFilterFile.h"
 #include <fstream>
 #include <iostream>
 #include <sys/stat.h>
@@ -14,6 +15,7 @@
 #include <cstdlib>
 #include <stdio.h>
 #include <cstring>
+#include <unistd.h>
 
 /* De novo filter constructor.
  *
@@ -39,6 +41,19 @@ BloomFilter::BloomFilter(size_t filterSize, unsigned hashNum, unsigned kmerSize,
 				(kmerSize + 4 - 1) / 4)
 {
 	initSize(m_size);
+	loadFilter(filterFilePath);
+}
+
+/*
+ * Replaces the content of the filter by the filter (.bf file or single file)
+ * at path specified, which must be of the same size
+ */
+void BloomFilter::loadFilter(string const &filterFilePath)
+{
+	if (BloomFilterFile::isSingleFile(filterFilePath)) {
+		BloomFilterFile(filterFilePath).readPayload(m_filter, m_sizeInBytes);
+		return;
+	}
 
 	FILE *file = fopen(filterFilePath.c_str(), "rb");
 	if (file == NULL) {
@@ -58,7 +73,7 @@ BloomFilter::BloomFilter(size_t filterSize, unsigned hashNum, unsigned kmerSize,
 	}
 
 	size_t countRead = fread(m_filter, fileSize, 1, file);
-	if(countRead != 1 && fclose(file) != 0)
+	if (fclose(file) != 0 || countRead != 1)
 	{
 		cerr << "file \"" << filterFilePath << "\" could not be read." << endl;
 		exit(1);
@@ -144,7 +159,8 @@ bool BloomFilter::contains(const unsigned char* kmer) const
 /*
  * Stores the filter as a binary file to the path specified
  * Stores uncompressed because the random data tends to
- * compress poorly anyway
+ * compress poorly anyway (sparse filters can be compressed
+ * with BloomFilterFile)
  */
 void BloomFilter::storeFilter(string const &filterFilePath) const
 {
@@ -160,6 +176,88 @@ void BloomFilter::storeFilter(string const &filterFilePath) const
 	assert(myFile);
 }
 
+/*
+ * Writes the filter to an open file descriptor
+ * Does not allocate memory, so can be used in a forked child process
+ * Returns false on failure
+ */
+bool BloomFilter::storeFilter(int fd) const
+{
+	const uint8_t* data = m_filter;
+	size_t remaining = m_sizeInBytes;
+	while (remaining > 0) {
+		ssize_t count = write(fd, data, remaining);
+		if (count <= 0) {
+			return false;
+		}
+		data += count;
+		remaining -= count;
+	}
+	return true;
+}
+
+/*
+ * Counts the number of bits set in the filter (in parallel)
+ */
+size_t BloomFilter::getPop() const
+{
+	size_t wordNum = m_sizeInBytes / sizeof(uint64_t);
+	size_t count = 0;
+#pragma omp parallel for reduction(+:count)
+	for (long i = 0; i < long(wordNum); ++i) {
+		uint64_t word;
+		memcpy(&word, m_filter + i * sizeof(uint64_t), sizeof(uint64_t));
+		count += __builtin_popcountll(word);
+	}
+	for (size_t i = wordNum * sizeof(uint64_t); i < m_sizeInBytes; ++i) {
+		count += __builtin_popcount(m_filter[i]);
+	}
+	return count;
+}
+
+/*
+ * Mixes a counter into a pseudo-random value (splitmix64)
+ */
+static inline uint64_t randomWord(uint64_t counter)
+{
+	uint64_t z = counter * 0x9E3779B97F4A7C15ULL;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+/*
+ * Fraction of queries of random k-mers found in the filter (in parallel)
+ * K-mers are generated from the query number so the result does not depend
+ * on the number of threads. Random k-mers are false positives unless they
+ * were inserted, which is unlikely unless the filter holds a large fraction
+ * of all 4^k k-mers
+ */
+double BloomFilter::measureFPR(size_t queries) const
+{
+	if (queries == 0) {
+		return 0;
+	}
+	size_t wordNum = (m_kmerSizeInBytes + sizeof(uint64_t) - 1)
+			/ sizeof(uint64_t);
+	size_t hits = 0;
+#pragma omp parallel
+	{
+		vector<unsigned char> kmer(wordNum * sizeof(uint64_t));
+#pragma omp for reduction(+:hits)
+		for (long i = 0; i < long(queries); ++i) {
+			for (size_t j = 0; j < wordNum; ++j) {
+				uint64_t word = randomWord(uint64_t(i) * wordNum + j);
+				memcpy(&kmer[j * sizeof(uint64_t)], &word, sizeof(uint64_t));
+			}
+			if (contains(&kmer[0])) {
+				++hits;
+			}
+		}
+	}
+	return double(hits) / double(queries);
+}
+
 unsigned BloomFilter::getHashNum() const
 {
 	return m_hashNum;
@@ -170,6 +268,11 @@ unsigned BloomFilter::getKmerSize() const
 	return m_kmerSize;
 }
 
+size_t BloomFilter::getSize() const
+{
+	return m_size;
+}
+
 BloomFilter::~BloomFilter()
 {
 	delete[] m_filter;
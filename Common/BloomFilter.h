@@ -52,9 +52,16 @@ public:
 
 	unsigned getHashNum() const;
 	unsigned getKmerSize() const;
+	size_t getSize() const;
+
+	//for measuring the filter
+	size_t getPop() const;
+	double measureFPR(size_t queries) const;
 
 	//for storing/restoring the filter
 	void storeFilter(string const &filterFilePath) const;
+	bool storeFilter(int fd) const;
+	void loadFilter(string const &filterFilePath);
 	explicit BloomFilter(size_t filterSize, unsigned hashNum, unsigned kmerSize,
 			string const &filterFilePath);
 
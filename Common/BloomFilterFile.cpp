@@ -0,0 +1,458 @@
+/*
+ * BloomFilterFile.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "BloomFilterFile.h"
+#include "Common/BloomFilter.h"
+#include "Common/IOUtil.h"
+#include "Common/city.h"
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+#include <cstdlib>
+#include <cassert>
+#include <cstdio>
+#include <cmath>
+#include <zlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#if _OPENMP
+# include <omp.h>
+#endif
+
+const char BloomFilterFile::s_magic[8] = { 'B', 'I', 'O', 'B', 'L', 'O', 'O',
+		'M' };
+//about 1/3 of bits set (or not set)
+const double BloomFilterFile::s_maxEntropy = 0.9;
+
+/*
+ * Exits with an error about the content of a filter file
+ */
+static void fileError(const string &filterFilePath, const string &problem)
+{
+	cerr << "Error: " << filterFilePath << " " << problem << endl;
+	exit(1);
+}
+
+/*
+ * Reads the header of the filter file, or of a filter stored as a .bf file
+ * and a .txt information file next to it
+ */
+BloomFilterFile::BloomFilterFile(const string &filterFilePath) :
+		m_filterFilePath(filterFilePath), m_singleFile(false)
+{
+	memset(&m_header, 0, sizeof(Header));
+	int fd = open(filterFilePath.c_str(), O_RDONLY);
+	if (fd == -1) {
+		cerr << "Error: " + filterFilePath + " File cannot be opened" << endl;
+		exit(1);
+	}
+	Header header;
+	m_singleFile = readHeader(fd, header);
+	if (m_singleFile) {
+		m_header = header;
+		loadSingleFile(fd);
+	}
+	close(fd);
+
+	if (!m_singleFile) {
+		string infoFileName = filterFilePath.substr(0,
+				filterFilePath.length() - 2) + "txt";
+		if (access(infoFileName.c_str(), R_OK) != 0) {
+			cerr
+					<< "Error: " + infoFileName
+							+ " File cannot be opened. A corresponding info file is needed."
+					<< endl;
+			exit(1);
+		}
+		m_info.reset(new BloomFilterInfo(infoFileName));
+	}
+}
+
+/*
+ * Reads the header at the start of the file
+ * Returns false if the file is not a single file filter
+ */
+bool BloomFilterFile::readHeader(int fd, Header &header)
+{
+	ssize_t count = pread(fd, &header, sizeof(Header), 0);
+	return count == ssize_t(sizeof(Header))
+			&& memcmp(header.magic, s_magic, sizeof(s_magic)) == 0;
+}
+
+/*
+ * Validates the header and reads the block checksums and information
+ */
+void BloomFilterFile::loadSingleFile(int fd)
+{
+	const Header &h = m_header;
+	if (CityHash64(reinterpret_cast<const char*>(&h),
+			offsetof(Header, headerChecksum)) != h.headerChecksum) {
+		fileError(m_filterFilePath, "has a corrupt header.");
+	}
+	if (h.version > s_version || h.headerSize != sizeof(Header)
+			|| (h.layoutFlags & ~(MINIMIZERS | SPACED_SEED | COMPRESSED)) != 0) {
+		stringstream problem;
+		problem << "is of format version " << h.version
+				<< ", only versions up to " << s_version << " can be read.";
+		fileError(m_filterFilePath, problem.str());
+	}
+	if (h.hashFamily != CITY_HASH_64) {
+		fileError(m_filterFilePath, "uses an unknown family of hash functions.");
+	}
+	size_t sizeInBytes = h.size / bitsPerChar;
+	if (h.blockSize == 0
+			|| h.blockNum != (sizeInBytes + h.blockSize - 1) / h.blockSize) {
+		fileError(m_filterFilePath, "is truncated or corrupt.");
+	}
+
+	//block checksums are followed by block ends and the information text
+	size_t checksumSize = h.blockNum * sizeof(uint64_t);
+	size_t blockEndsSize = isCompressed() ? checksumSize : 0;
+	vector<unsigned char> meta(checksumSize + blockEndsSize + h.infoSize);
+	readBlock(fd, &meta[0], meta.size(), sizeof(Header), m_filterFilePath);
+	if (CityHash64(reinterpret_cast<const char*>(&meta[0]), meta.size())
+			!= h.metaChecksum) {
+		fileError(m_filterFilePath, "has corrupt filter information.");
+	}
+	m_checksums.resize(h.blockNum);
+	memcpy(&m_checksums[0], &meta[0], checksumSize);
+	if (isCompressed()) {
+		m_blockEnds.resize(h.blockNum);
+		memcpy(&m_blockEnds[0], &meta[checksumSize], blockEndsSize);
+	}
+	istringstream infoText(
+			string(
+					reinterpret_cast<const char*>(&meta[checksumSize
+							+ blockEndsSize]), h.infoSize));
+	m_info.reset(new BloomFilterInfo(infoText, m_filterFilePath));
+
+	struct stat sb;
+	size_t payloadSize = isCompressed() ? m_blockEnds.back() : sizeInBytes;
+	if (fstat(fd, &sb) == -1
+			|| size_t(sb.st_size) != h.payloadOffset + payloadSize) {
+		fileError(m_filterFilePath, "is truncated or corrupt.");
+	}
+
+	const BloomFilterInfo &info = *m_info;
+	if (info.getKmerSize() != h.kmerSize || info.getHashNum() != h.hashNum
+			|| info.getCalcuatedFilterSize() != h.size
+			|| info.getTotalNum() != h.numEntries
+			|| (info.getMinimizerWindow() > 0) != bool(h.layoutFlags & MINIMIZERS)
+			|| info.getSpacedSeed().empty() == bool(h.layoutFlags & SPACED_SEED)) {
+		fileError(m_filterFilePath,
+				"has a header that does not match its filter information.");
+	}
+}
+
+const BloomFilterInfo &BloomFilterFile::getInfo() const
+{
+	return *m_info;
+}
+
+bool BloomFilterFile::isSingleFile() const
+{
+	return m_singleFile;
+}
+
+bool BloomFilterFile::isCompressed() const
+{
+	return (m_header.layoutFlags & COMPRESSED) != 0;
+}
+
+/*
+ * Reads block index of the bit array into data, decompressing it if needed
+ * (buffer holds the compressed block)
+ * Returns false if the block does not match its checksum
+ */
+bool BloomFilterFile::loadBlock(int fd, size_t index, unsigned char* data,
+		vector<unsigned char> &buffer) const
+{
+	size_t offset = index * m_header.blockSize;
+	size_t size = min(size_t(m_header.blockSize),
+			size_t(m_header.size / bitsPerChar) - offset);
+	if (!isCompressed()) {
+		readBlock(fd, data, size, m_header.payloadOffset + offset,
+				m_filterFilePath);
+	} else {
+		size_t start = index == 0 ? 0 : m_blockEnds[index - 1];
+		size_t storedSize = m_blockEnds[index] - start;
+		if (storedSize == size) {
+			readBlock(fd, data, size, m_header.payloadOffset + start,
+					m_filterFilePath);
+		} else {
+			buffer.resize(storedSize);
+			readBlock(fd, &buffer[0], storedSize,
+					m_header.payloadOffset + start, m_filterFilePath);
+			uLongf length = size;
+			if (storedSize > size
+					|| uncompress(data, &length, &buffer[0], storedSize) != Z_OK
+					|| length != size) {
+				return false;
+			}
+		}
+	}
+	return CityHash64(reinterpret_cast<const char*>(data), size)
+			== m_checksums[index];
+}
+
+/*
+ * Reads the bit array of a single file filter into data, decompressing and
+ * verifying the checksum of each block in parallel
+ */
+void BloomFilterFile::readPayload(unsigned char* data,
+		size_t sizeInBytes) const
+{
+	assert(m_singleFile);
+	if (sizeInBytes != m_header.size / bitsPerChar) {
+		cerr << "Error: " << m_filterFilePath
+				<< " does not match size given by its header. Size: "
+				<< m_header.size / bitsPerChar << " vs " << sizeInBytes
+				<< " bytes." << endl;
+		exit(1);
+	}
+	int fd = open(m_filterFilePath.c_str(), O_RDONLY);
+	if (fd == -1) {
+		cerr << "file \"" << m_filterFilePath << "\" could not be read."
+				<< endl;
+		exit(1);
+	}
+	size_t corruptBlocks = 0;
+#pragma omp parallel
+	{
+		vector<unsigned char> buffer;
+#pragma omp for schedule(dynamic)
+		for (long i = 0; i < long(m_header.blockNum); ++i) {
+			if (!loadBlock(fd, i, data + size_t(i) * m_header.blockSize,
+					buffer)) {
+				__sync_fetch_and_add(&corruptBlocks, 1);
+			}
+		}
+	}
+	close(fd);
+	if (corruptBlocks > 0) {
+		stringstream problem;
+		problem << "is corrupt (" << corruptBlocks << " of "
+				<< m_header.blockNum << " blocks do not match their checksum).";
+		fileError(m_filterFilePath, problem.str());
+	}
+}
+
+/*
+ * Reads size bytes of the bit array from offset into data, decompressing and
+ * verifying the blocks they are in
+ */
+void BloomFilterFile::readBlocks(int fd, unsigned char* data, size_t offset,
+		size_t size) const
+{
+	if (!m_singleFile) {
+		readBlock(fd, data, size, offset, m_filterFilePath);
+		return;
+	}
+	size_t blockSize = m_header.blockSize;
+	size_t sizeInBytes = m_header.size / bitsPerChar;
+	vector<unsigned char> buffer;
+	vector<unsigned char> block;
+	for (size_t index = offset / blockSize; index * blockSize < offset + size;
+			++index) {
+		size_t start = index * blockSize;
+		size_t end = min(start + blockSize, sizeInBytes);
+		bool intact;
+		if (start >= offset && end <= offset + size) {
+			intact = loadBlock(fd, index, data + (start - offset), buffer);
+		} else {
+			//only part of the block is needed
+			block.resize(blockSize);
+			intact = loadBlock(fd, index, &block[0], buffer);
+			size_t first = max(start, offset);
+			size_t last = min(end, offset + size);
+			memcpy(data + (first - offset), &block[first - start],
+					last - first);
+		}
+		if (!intact) {
+			fileError(m_filterFilePath,
+					"is corrupt (block does not match its checksum).");
+		}
+	}
+}
+
+/*
+ * Returns true if the file at path is a single file filter
+ */
+bool BloomFilterFile::isSingleFile(const string &filterFilePath)
+{
+	int fd = open(filterFilePath.c_str(), O_RDONLY);
+	if (fd == -1) {
+		return false;
+	}
+	Header header;
+	bool singleFile = readHeader(fd, header);
+	close(fd);
+	return singleFile;
+}
+
+/*
+ * Stores a block as is, or deflated if it is sparse (or dense) enough to be
+ * worth compressing and gets smaller
+ */
+void BloomFilterFile::encodeBlock(const unsigned char* data, size_t size,
+		bool compress, vector<unsigned char> &stored)
+{
+	if (compress) {
+		//sizes of filters (so of blocks) are multiples of 64 bits
+		size_t ones = 0;
+		for (size_t i = 0; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+			uint64_t word;
+			memcpy(&word, data + i, sizeof(uint64_t));
+			ones += __builtin_popcountll(word);
+		}
+		double density = double(ones) / double(size * bitsPerChar);
+		double entropy = 0;
+		if (density > 0 && density < 1) {
+			entropy = -density * log2(density)
+					- (1 - density) * log2(1 - density);
+		}
+		if (entropy <= s_maxEntropy) {
+			//bits are random so only Huffman coding of bytes helps, string
+			//matching is slower and gives larger output
+			z_stream stream;
+			memset(&stream, 0, sizeof(z_stream));
+			stored.resize(compressBound(size));
+			stream.next_in = const_cast<unsigned char*>(data);
+			stream.avail_in = size;
+			stream.next_out = &stored[0];
+			stream.avail_out = stored.size();
+			bool deflated = deflateInit2(&stream, Z_DEFAULT_COMPRESSION,
+					Z_DEFLATED, 15, 8, Z_HUFFMAN_ONLY) == Z_OK
+					&& deflate(&stream, Z_FINISH) == Z_STREAM_END;
+			size_t length = stream.total_out;
+			deflateEnd(&stream);
+			if (deflated && length < size) {
+				stored.resize(length);
+				return;
+			}
+		}
+	}
+	stored.assign(data, data + size);
+}
+
+/*
+ * Rewrites a filter stored as a .bf file as a single file filter holding its
+ * information, optionally compressing its sparse blocks. Blocks are
+ * checksummed and compressed in parallel in batches, and written in order
+ */
+void BloomFilterFile::store(const string &filterFilePath,
+		const BloomFilterInfo &info, bool compress)
+{
+	size_t sizeInBytes = info.getCalcuatedFilterSize() / bitsPerChar;
+	int in = open(filterFilePath.c_str(), O_RDONLY);
+	struct stat sb;
+	if (in == -1 || fstat(in, &sb) == -1) {
+		cerr << "file \"" << filterFilePath << "\" could not be read." << endl;
+		exit(1);
+	}
+	if (size_t(sb.st_size) != sizeInBytes) {
+		cerr << "Error: " << filterFilePath
+				<< " does not match size given by its information. Size: "
+				<< sb.st_size << " vs " << sizeInBytes << " bytes." << endl;
+		exit(1);
+	}
+
+	stringstream infoText;
+	info.printInfo(infoText);
+	string text = infoText.str();
+
+	Header header;
+	memset(&header, 0, sizeof(Header));
+	memcpy(header.magic, s_magic, sizeof(s_magic));
+	header.version = compress ? s_version : 1;
+	header.headerSize = sizeof(Header);
+	header.kmerSize = info.getKmerSize();
+	header.hashNum = info.getHashNum();
+	header.hashFamily = CITY_HASH_64;
+	header.layoutFlags = (info.getMinimizerWindow() > 0 ? MINIMIZERS : 0)
+			| (info.getSpacedSeed().empty() ? 0 : SPACED_SEED)
+			| (compress ? COMPRESSED : 0);
+	header.size = info.getCalcuatedFilterSize();
+	header.numEntries = info.getTotalNum();
+	header.blockSize = s_blockSize;
+	header.blockNum = (sizeInBytes + s_blockSize - 1) / s_blockSize;
+	header.infoSize = text.size();
+	vector<uint64_t> checksums(header.blockNum);
+	vector<uint64_t> blockEnds(compress ? header.blockNum : 0);
+	size_t metaEnd = sizeof(Header)
+			+ (checksums.size() + blockEnds.size()) * sizeof(uint64_t)
+			+ text.size();
+	header.payloadOffset = (metaEnd + s_alignment - 1) / s_alignment
+			* s_alignment;
+
+	string tempPath = filterFilePath + ".tmp";
+	int out = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (out == -1) {
+		cerr << "file \"" << tempPath << "\" could not be written." << endl;
+		exit(1);
+	}
+
+	vector<vector<unsigned char> > stored(s_batchSize);
+	size_t payloadSize = 0;
+	for (size_t first = 0; first < header.blockNum; first += s_batchSize) {
+		size_t last = min(size_t(header.blockNum), first + s_batchSize);
+#pragma omp parallel
+		{
+			vector<unsigned char> block(header.blockSize);
+#pragma omp for schedule(dynamic)
+			for (long i = first; i < long(last); ++i) {
+				size_t offset = size_t(i) * header.blockSize;
+				size_t size = min(size_t(header.blockSize),
+						sizeInBytes - offset);
+				readBlock(in, &block[0], size, offset, filterFilePath);
+				checksums[i] = CityHash64(
+						reinterpret_cast<const char*>(&block[0]), size);
+				encodeBlock(&block[0], size, compress, stored[i - first]);
+			}
+		}
+		for (size_t i = first; i < last; ++i) {
+			const vector<unsigned char> &block = stored[i - first];
+			writeBlock(out, &block[0], block.size(),
+					header.payloadOffset + payloadSize, tempPath);
+			payloadSize += block.size();
+			if (compress) {
+				blockEnds[i] = payloadSize;
+			}
+		}
+	}
+	close(in);
+	if (compress) {
+		cerr << "Compressed filter from " << sizeInBytes << " to "
+				<< payloadSize << " bytes." << endl;
+	}
+
+	string meta(reinterpret_cast<const char*>(&checksums[0]),
+			checksums.size() * sizeof(uint64_t));
+	if (compress) {
+		meta.append(reinterpret_cast<const char*>(&blockEnds[0]),
+				blockEnds.size() * sizeof(uint64_t));
+	}
+	meta += text;
+	header.metaChecksum = CityHash64(meta.c_str(), meta.size());
+	header.headerChecksum = CityHash64(reinterpret_cast<const char*>(&header),
+			offsetof(Header, headerChecksum));
+	writeBlock(out, reinterpret_cast<const unsigned char*>(&header),
+			sizeof(Header), 0, tempPath);
+	writeBlock(out, reinterpret_cast<const unsigned char*>(meta.c_str()),
+			meta.size(), sizeof(Header), tempPath);
+	if (close(out) != 0 || rename(tempPath.c_str(), filterFilePath.c_str()) != 0) {
+		cerr << "file \"" << filterFilePath << "\" could not be written."
+				<< endl;
+		exit(1);
+	}
+}
+
+BloomFilterFile::~BloomFilterFile()
+{
+}
@@ -0,0 +1,111 @@
+/*
+ * BloomFilterFile.h
+ *
+ * Single file format of a filter, holding both its information and its bits:
+ *
+ * - fixed binary header (version, k-mer size, number of hash functions, hash
+ *   family, size, entries and layout flags)
+ * - checksum of each block of the bit array, end offsets of the blocks if
+ *   they are compressed, then the information file text
+ * - bit array, starting at a multiple of 4 KiB so it can be mapped or read
+ *   with O_DIRECT when it is not compressed
+ *
+ * Blocks are checksummed (and optionally compressed) independently so they
+ * are verified and decompressed in parallel while loading. Filters stored as
+ * a .bf file with a .txt information file next to it are still read.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef BLOOMFILTERFILE_H_
+#define BLOOMFILTERFILE_H_
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <sys/types.h>
+#include <boost/shared_ptr.hpp>
+#include "Common/BloomFilterInfo.h"
+
+using namespace std;
+
+class BloomFilterFile {
+public:
+	explicit BloomFilterFile(const string &filterFilePath);
+
+	const BloomFilterInfo &getInfo() const;
+	bool isSingleFile() const;
+	bool isCompressed() const;
+	void readPayload(unsigned char* data, size_t sizeInBytes) const;
+	void readBlocks(int fd, unsigned char* data, size_t offset,
+			size_t size) const;
+
+	static bool isSingleFile(const string &filterFilePath);
+	static void store(const string &filterFilePath,
+			const BloomFilterInfo &info, bool compress);
+
+	virtual ~BloomFilterFile();
+private:
+	//fields are ordered so the struct has no padding
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t headerSize;
+		uint32_t kmerSize;
+		uint32_t hashNum;
+		uint32_t hashFamily;
+		uint32_t layoutFlags;
+		uint64_t size;
+		uint64_t numEntries;
+		uint64_t blockSize;
+		uint64_t blockNum;
+		uint64_t infoSize;
+		uint64_t payloadOffset;
+		//checksum of block checksums, block ends and information text
+		uint64_t metaChecksum;
+		//checksum of all preceding fields
+		uint64_t headerChecksum;
+	};
+
+	enum HashFamily {
+		//CityHash64WithSeed of 2-bit k-mers, seeds 0 to hashNum - 1
+		CITY_HASH_64 = 1
+	};
+
+	enum LayoutFlags {
+		MINIMIZERS = 1, SPACED_SEED = 2,
+		//blocks smaller than blockSize when stored are deflated
+		COMPRESSED = 4
+	};
+
+	BloomFilterFile(const BloomFilterFile& that); //to prevent copy construction
+
+	static bool readHeader(int fd, Header &header);
+	void loadSingleFile(int fd);
+	bool loadBlock(int fd, size_t index, unsigned char* data,
+			vector<unsigned char> &buffer) const;
+	static void encodeBlock(const unsigned char* data, size_t size,
+			bool compress, vector<unsigned char> &stored);
+
+	string m_filterFilePath;
+	bool m_singleFile;
+	Header m_header;
+	vector<uint64_t> m_checksums;
+	//offset after each stored block from the start of the bit array
+	vector<uint64_t> m_blockEnds;
+	boost::shared_ptr<BloomFilterInfo> m_info;
+
+	static const char s_magic[8];
+	//uncompressed files are written as version 1 so older readers load them
+	static const uint32_t s_version = 2;
+	static const size_t s_alignment = 4096;
+	//bytes of the bit array covered by each checksum
+	static const size_t s_blockSize = 1 << 20;
+	//blocks held in memory at once while storing
+	static const size_t s_batchSize = 64;
+	//blocks with a higher entropy per bit (from their density) are not
+	//worth compressing
+	static const double s_maxEntropy;
+};
+
+#endif /* BLOOMFILTERFILE_H_ */
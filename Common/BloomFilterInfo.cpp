@@ -10,18 +10,27 @@
 #include <fstream>
 #include <sstream>
 #include <assert.h>
+#include <cstdlib>
+#include <algorithm>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/ini_parser.hpp>
+#include "Common/ReadsProcessor.h"
+#include "Common/BloomFilter.h"
 
 BloomFilterInfo::BloomFilterInfo(string const &filterID, unsigned kmerSize, unsigned hashNum,
 		double desiredFPR, size_t expectedNumEntries,
 		const vector<string> &seqSrcs) :
 		m_filterID(filterID), m_kmerSize(kmerSize), m_desiredFPR(desiredFPR), m_seqSrcs(
 				seqSrcs), m_hashNum(hashNum), m_expectedNumEntries(
-				expectedNumEntries)
+				expectedNumEntries), m_minimizerWindow(0), m_spacedSeed("")
 {
 	m_runInfo.size = calcOptimalSize(expectedNumEntries, desiredFPR, hashNum);
 	m_runInfo.redundantSequences = 0;
+	m_runInfo.distinctEstimate = 0;
+	m_runInfo.abundanceCounters = 0;
+	m_runInfo.occupancy = -1;
+	m_runInfo.empiricalFPR = 0;
+	m_runInfo.empiricalQueries = 0;
 }
 
 /*
@@ -29,15 +38,45 @@ BloomFilterInfo::BloomFilterInfo(string const &filterID, unsigned kmerSize, unsi
  */
 //Todo: convert to having variables stored in property tree for more modularity
 BloomFilterInfo::BloomFilterInfo(string const &fileName)
+{
+	ifstream input(fileName.c_str());
+	if (!input) {
+		cerr << "Error: " << fileName << " File cannot be opened." << endl;
+		exit(1);
+	}
+	loadInfo(input, fileName);
+}
+
+/*
+ * loads bloom filter information from a stream in the format of an
+ * information file (i.e. text embedded in a single file filter)
+ */
+BloomFilterInfo::BloomFilterInfo(istream &input, string const &fileName)
+{
+	loadInfo(input, fileName);
+}
+
+void BloomFilterInfo::loadInfo(istream &input, const string &fileName)
 {
 	boost::property_tree::ptree pt;
-	boost::property_tree::ini_parser::read_ini(fileName, pt);
+	boost::property_tree::ini_parser::read_ini(input, pt);
 	m_filterID = pt.get<string>("user_input_options.filter_id");
 	m_kmerSize = pt.get<unsigned>("user_input_options.kmer_size");
 	m_desiredFPR = pt.get<float>("user_input_options.desired_false_positve_rate");
 	string tempSeqSrcs = pt.get<string>("user_input_options.sequence_sources");
 	m_seqSrcs = convertSeqSrcString(tempSeqSrcs);
 	m_hashNum = pt.get<unsigned>("user_input_options.number_of_hash_functions");
+	m_minimizerWindow = pt.get<unsigned>("user_input_options.minimizer_window",
+			0);
+	m_spacedSeed = pt.get<string>("user_input_options.spaced_seed", "");
+	if (!m_spacedSeed.empty()
+			&& !ReadsProcessor::isValidSpacedSeed(m_spacedSeed, m_kmerSize))
+	{
+		cerr << "Error: Invalid spaced seed " << m_spacedSeed << " in "
+				<< fileName << ". Seed must be a symmetric string of 0s and 1s "
+				<< "of length kmer_size starting and ending with 1." << endl;
+		exit(1);
+	}
 
 	//runtime params
 	m_runInfo.size = pt.get<size_t>("runtime_options.size");
@@ -50,6 +89,15 @@ BloomFilterInfo::BloomFilterInfo(string const &fileName)
 			"user_input_options.expected_num_entries");
 	m_runInfo.FPR = pt.get<double>(
 			"runtime_options.approximate_false_positive_rate");
+	m_runInfo.distinctEstimate = pt.get<size_t>(
+			"runtime_options.estimated_distinct_entries", 0);
+	m_runInfo.abundanceCounters = pt.get<size_t>(
+			"runtime_options.abundance_counters", 0);
+	m_runInfo.occupancy = pt.get<double>("runtime_options.occupancy", -1);
+	m_runInfo.empiricalFPR = pt.get<double>(
+			"runtime_options.empirical_false_positive_rate", 0);
+	m_runInfo.empiricalQueries = pt.get<size_t>(
+			"runtime_options.empirical_queries", 0);
 }
 
 /**
@@ -66,6 +114,30 @@ void BloomFilterInfo::setRedundancy(size_t redunSeq)
 			m_runInfo.numEntries, m_hashNum);
 }
 
+/**
+ * Sets size of filter (i.e. after it is folded), false positive rates are
+ * recalculated and previous measurements are discarded
+ */
+void BloomFilterInfo::setFilterSize(size_t size)
+{
+	m_runInfo.size = size;
+	m_runInfo.occupancy = -1;
+	m_runInfo.empiricalFPR = 0;
+	m_runInfo.empiricalQueries = 0;
+	setRedundancy(m_runInfo.redundantSequences);
+}
+
+/**
+ * Sets fraction of bits set, counted while the filter was written (i.e. when
+ * filters are combined), previous measurements are discarded
+ */
+void BloomFilterInfo::setOccupancy(double occupancy)
+{
+	m_runInfo.occupancy = occupancy;
+	m_runInfo.empiricalFPR = 0;
+	m_runInfo.empiricalQueries = 0;
+}
+
 /**
  * Sets number of element inserted into filter
  */
@@ -74,6 +146,75 @@ void BloomFilterInfo::setTotalNum(size_t totalNum)
 	m_runInfo.numEntries = totalNum;
 }
 
+/**
+ * Sets window of minimizers inserted into filter
+ */
+void BloomFilterInfo::setMinimizerWindow(unsigned window)
+{
+	m_minimizerWindow = window;
+}
+
+/**
+ * Sets spaced seed mask applied to each k-mer inserted into filter
+ */
+void BloomFilterInfo::setSpacedSeed(const string &seed)
+{
+	m_spacedSeed = seed;
+}
+
+/**
+ * Sets estimated number of distinct entries the filter was sized with
+ */
+void BloomFilterInfo::setDistinctEstimate(size_t estimate)
+{
+	m_runInfo.distinctEstimate = estimate;
+}
+
+/**
+ * Sets number of counters of k-mer occurrences stored with the filter (see
+ * BloomFilterGenerator::setAbundance), 0 if they are not stored with it
+ */
+void BloomFilterInfo::setAbundanceCounters(size_t counterNum)
+{
+	m_runInfo.abundanceCounters = counterNum;
+}
+
+/**
+ * Sets ID of filter (i.e. when an updated filter is stored under a new name)
+ */
+void BloomFilterInfo::setFilterID(const string &filterID)
+{
+	m_filterID = filterID;
+}
+
+/**
+ * Adds sources of sequences inserted after the filter was created
+ * (sources already listed are skipped)
+ */
+void BloomFilterInfo::addSeqSrcs(const vector<string> &seqSrcs)
+{
+	for (vector<string>::const_iterator it = seqSrcs.begin();
+			it != seqSrcs.end(); ++it)
+	{
+		if (find(m_seqSrcs.begin(), m_seqSrcs.end(), *it) == m_seqSrcs.end()) {
+			m_seqSrcs.push_back(*it);
+		}
+	}
+}
+
+/**
+ * Measures the fraction of bits set in the filter, and the fraction of
+ * queries of random k-mers found in it unless queries is 0
+ */
+void BloomFilterInfo::measure(const BloomFilter &filter, size_t queries)
+{
+	m_runInfo.occupancy = double(filter.getPop()) / double(filter.getSize());
+	if (queries > 0) {
+		m_runInfo.empiricalFPR = filter.measureFPR(queries);
+		m_runInfo.empiricalQueries = queries;
+	}
+}
+
 /*
  * Prints out INI format file
  */
@@ -89,12 +230,27 @@ void BloomFilterInfo::printInfoFile(const string &fileName) const
 	assert(m_hashNum > 0);
 
 	ofstream output(fileName.c_str(), ios::out);
+	printInfo(output);
+	output.close();
+}
+
+/*
+ * Prints out INI format to a stream
+ */
+void BloomFilterInfo::printInfo(ostream &output) const
+{
 	//user specified
 	output << "[user_input_options]\nfilter_id=" << m_filterID << "\nkmer_size="
 			<< m_kmerSize << "\ndesired_false_positve_rate=" << m_desiredFPR
 			<< "\nnumber_of_hash_functions=" << m_hashNum
-			<< "\nexpected_num_entries=" << m_expectedNumEntries
-			<< "\nsequence_sources=";
+			<< "\nexpected_num_entries=" << m_expectedNumEntries;
+	if (m_minimizerWindow > 0) {
+		output << "\nminimizer_window=" << m_minimizerWindow;
+	}
+	if (!m_spacedSeed.empty()) {
+		output << "\nspaced_seed=" << m_spacedSeed;
+	}
+	output << "\nsequence_sources=";
 
 	//print out sources as a list
 	for (vector<string>::const_iterator it = m_seqSrcs.begin();
@@ -110,9 +266,49 @@ void BloomFilterInfo::printInfoFile(const string &fileName) const
 			<< m_runInfo.FPR << "\nredundant_sequences="
 			<< m_runInfo.redundantSequences << "\nredundant_fpr="
 			<< m_runInfo.redundantFPR << "\n";
+	if (m_runInfo.distinctEstimate > 0) {
+		output << "estimated_distinct_entries=" << m_runInfo.distinctEstimate
+				<< "\n";
+	}
+	if (m_runInfo.abundanceCounters > 0) {
+		output << "abundance_counters=" << m_runInfo.abundanceCounters << "\n";
+	}
+	if (m_runInfo.occupancy >= 0) {
+		output << "occupancy=" << m_runInfo.occupancy
+				<< "\noccupancy_false_positive_rate=" << getOccupancyFPR()
+				<< "\n";
+	}
+	if (m_runInfo.empiricalQueries > 0) {
+		output << "empirical_false_positive_rate=" << m_runInfo.empiricalFPR
+				<< "\nempirical_queries=" << m_runInfo.empiricalQueries << "\n";
+	}
 	//print out hash functions as a list
+}
 
-	output.close();
+/*
+ * Prints out header of the table of filter measurements
+ */
+void BloomFilterInfo::printStatsHeader(ostream &output)
+{
+	output << "filter_id\tsize\tnum_entries\toccupancy\tapproximate_fpr"
+			"\toccupancy_fpr\tempirical_fpr\tempirical_queries\n";
+}
+
+/*
+ * Prints out measurements of the filter as a row of a table (empirical false
+ * positive rate is NA if not measured)
+ */
+void BloomFilterInfo::printStats(ostream &output) const
+{
+	output << m_filterID << "\t" << m_runInfo.size << "\t"
+			<< m_runInfo.numEntries << "\t" << m_runInfo.occupancy << "\t"
+			<< m_runInfo.FPR << "\t" << getOccupancyFPR() << "\t";
+	if (m_runInfo.empiricalQueries > 0) {
+		output << m_runInfo.empiricalFPR;
+	} else {
+		output << "NA";
+	}
+	output << "\t" << m_runInfo.empiricalQueries << "\n";
 }
 
 //getters
@@ -147,6 +343,74 @@ double BloomFilterInfo::getFPR() const
 	return m_runInfo.FPR;
 }
 
+double BloomFilterInfo::getDesiredFPR() const
+{
+	return m_desiredFPR;
+}
+
+size_t BloomFilterInfo::getTotalNum() const
+{
+	return m_runInfo.numEntries;
+}
+
+size_t BloomFilterInfo::getExpectedNum() const
+{
+	return m_expectedNumEntries;
+}
+
+size_t BloomFilterInfo::getRedundancy() const
+{
+	return m_runInfo.redundantSequences;
+}
+
+const vector<string> &BloomFilterInfo::getSeqSrcs() const
+{
+	return m_seqSrcs;
+}
+
+unsigned BloomFilterInfo::getMinimizerWindow() const
+{
+	return m_minimizerWindow;
+}
+
+const string &BloomFilterInfo::getSpacedSeed() const
+{
+	return m_spacedSeed;
+}
+
+size_t BloomFilterInfo::getDistinctEstimate() const
+{
+	return m_runInfo.distinctEstimate;
+}
+
+size_t BloomFilterInfo::getAbundanceCounters() const
+{
+	return m_runInfo.abundanceCounters;
+}
+
+double BloomFilterInfo::getOccupancy() const
+{
+	return m_runInfo.occupancy;
+}
+
+/*
+ * False positive rate given the fraction of bits set (see measure())
+ */
+double BloomFilterInfo::getOccupancyFPR() const
+{
+	return pow(m_runInfo.occupancy, double(m_hashNum));
+}
+
+double BloomFilterInfo::getEmpiricalFPR() const
+{
+	return m_runInfo.empiricalFPR;
+}
+
+size_t BloomFilterInfo::getEmpiricalQueries() const
+{
+	return m_runInfo.empiricalQueries;
+}
+
 const vector<string> BloomFilterInfo::convertSeqSrcString(
 		string const &seqSrcStr) const
 {
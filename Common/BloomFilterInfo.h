@@ -11,10 +11,13 @@
 #define BLOOMFILTERINFO_H_
 #include <string>
 #include <vector>
+#include <iostream>
 #include <boost/unordered/unordered_map.hpp>
 
 using namespace std;
 
+class BloomFilter;
+
 // For Calculating aspects of bloom filter
 // todo: Tweak calculations as they are approximations and may not be 100% optimal
 // see http://en.wikipedia.org/wiki/Bloom_filter
@@ -32,11 +35,24 @@ public:
 			unsigned hashNum, double desiredFPR, size_t expectedSize,
 			const vector<string> &seqSrc);
 	explicit BloomFilterInfo(string const &fileName);
+	explicit BloomFilterInfo(istream &input, string const &fileName);
 	void addHashFunction(const string &fnName, size_t seed);
 	void setRedundancy(size_t redunSeq);
 	void setTotalNum(size_t totalNum);
+	void setMinimizerWindow(unsigned window);
+	void setSpacedSeed(const string &seed);
+	void setDistinctEstimate(size_t estimate);
+	void setAbundanceCounters(size_t counterNum);
+	void setFilterID(const string &filterID);
+	void setFilterSize(size_t size);
+	void setOccupancy(double occupancy);
+	void addSeqSrcs(const vector<string> &seqSrcs);
+	void measure(const BloomFilter &filter, size_t queries);
 
 	void printInfoFile(const string &fileName) const;
+	void printInfo(ostream &output) const;
+	static void printStatsHeader(ostream &output);
+	void printStats(ostream &output) const;
 	virtual ~BloomFilterInfo();
 
 	//getters
@@ -47,6 +63,19 @@ public:
 	const string &getPresetType() const;
 	double getRedundancyFPR() const;
 	double getFPR() const;
+	double getDesiredFPR() const;
+	size_t getTotalNum() const;
+	size_t getExpectedNum() const;
+	size_t getRedundancy() const;
+	const vector<string> &getSeqSrcs() const;
+	unsigned getMinimizerWindow() const;
+	const string &getSpacedSeed() const;
+	size_t getDistinctEstimate() const;
+	size_t getAbundanceCounters() const;
+	double getOccupancy() const;
+	double getOccupancyFPR() const;
+	double getEmpiricalFPR() const;
+	size_t getEmpiricalQueries() const;
 
 private:
 	//user specified input
@@ -56,6 +85,10 @@ private:
 	vector<string> m_seqSrcs;
 	unsigned m_hashNum;
 	size_t m_expectedNumEntries;
+	//0 if all k-mers are inserted, otherwise only minimizers of this window
+	unsigned m_minimizerWindow;
+	//empty if all bases of each k-mer are used
+	string m_spacedSeed;
 
 	//determined at run time
 	struct runtime {
@@ -64,10 +97,20 @@ private:
 		double FPR;
 		size_t redundantSequences;
 		double redundantFPR;
+		//estimated distinct entries used for sizing, 0 if not estimated
+		size_t distinctEstimate;
+		//counters of k-mer occurrences stored next to the filter, 0 if none
+		size_t abundanceCounters;
+		//fraction of bits set, negative if not measured
+		double occupancy;
+		//fraction of random k-mers found, 0 queries if not measured
+		double empiricalFPR;
+		size_t empiricalQueries;
 	};
 
 	runtime m_runInfo;
 
+	void loadInfo(istream &input, const string &fileName);
 	const vector<string> convertSeqSrcString(const string &seqSrcStr) const;
 	double calcApproxFPR(size_t size, size_t numEntr,
 			unsigned hashFunctNum) const;
@@ -0,0 +1,142 @@
+/*
+ * CountingBloomFilter.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "CountingBloomFilter.h"
+#include "BloomFilter.h"
+#include "IOUtil.h"
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cassert>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/*
+ * size is the number of counters (one byte each)
+ */
+CountingBloomFilter::CountingBloomFilter(size_t size, unsigned hashNum) :
+		m_counters(new uint8_t[size]), m_size(size), m_hashNum(hashNum)
+{
+	memset(m_counters, 0, m_size);
+}
+
+/*
+ * Loads the counters (stored by storeFilter) from path specified
+ */
+CountingBloomFilter::CountingBloomFilter(size_t size, unsigned hashNum,
+		const string &filterFilePath) :
+		m_counters(new uint8_t[size]), m_size(size), m_hashNum(hashNum)
+{
+	int fd = open(filterFilePath.c_str(), O_RDONLY);
+	struct stat sb;
+	if (fd == -1 || fstat(fd, &sb) == -1) {
+		cerr << "file \"" << filterFilePath << "\" could not be read." << endl;
+		exit(1);
+	}
+	if (size_t(sb.st_size) != m_size) {
+		cerr << "Error: " << filterFilePath
+				<< " does not match number of counters given by the "
+						"information of its filter. Size: " << sb.st_size
+				<< " vs " << m_size << " bytes." << endl;
+		exit(1);
+	}
+	readBlock(fd, m_counters, m_size, 0, filterFilePath);
+	close(fd);
+}
+
+/*
+ * Increments the counters of the precomputed hash values (thread safe)
+ * Returns the count after insertion
+ */
+unsigned CountingBloomFilter::insert(vector<size_t> const &precomputed)
+{
+	unsigned minCount = s_maxCount;
+	for (size_t i = 0; i < m_hashNum; ++i) {
+		uint8_t* counter = &m_counters[precomputed[i] % m_size];
+		uint8_t value = *counter;
+		//counters saturate instead of overflowing
+		while (value < s_maxCount) {
+			uint8_t old = __sync_val_compare_and_swap(counter, value,
+					uint8_t(value + 1));
+			if (old == value) {
+				++value;
+				break;
+			}
+			value = old;
+		}
+		if (value < minCount) {
+			minCount = value;
+		}
+	}
+	return minCount;
+}
+
+/*
+ * Returns the number of times the precomputed hash values were inserted
+ */
+unsigned CountingBloomFilter::count(vector<size_t> const &precomputed) const
+{
+	unsigned minCount = s_maxCount;
+	for (size_t i = 0; i < m_hashNum; ++i) {
+		unsigned value = m_counters[precomputed[i] % m_size];
+		if (value < minCount) {
+			minCount = value;
+		}
+	}
+	return minCount;
+}
+
+/*
+ * Sets the bits of mask (a filter of as many bits as there are counters and
+ * the same hash functions) at the counters above maxCount, so that
+ * mask.contains(hashValues) == (count(hashValues) > maxCount)
+ */
+void CountingBloomFilter::maskAbove(unsigned maxCount, BloomFilter &mask) const
+{
+	assert(mask.getSize() == m_size && mask.getHashNum() == m_hashNum);
+	for (size_t i = 0; i < m_size; ++i) {
+		if (m_counters[i] > maxCount) {
+			//all hash values of the mask at i set the bit of counter i
+			mask.insert(vector<size_t>(m_hashNum, i));
+		}
+	}
+}
+
+/*
+ * Stores the counters as a binary file to the path specified
+ */
+void CountingBloomFilter::storeFilter(const string &filterFilePath) const
+{
+	cerr << "Storing counters. Counters are " << m_size << "bytes." << endl;
+	int fd = open(filterFilePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1) {
+		cerr << "file \"" << filterFilePath << "\" could not be written."
+				<< endl;
+		exit(1);
+	}
+	writeBlock(fd, m_counters, m_size, 0, filterFilePath);
+	if (close(fd) != 0) {
+		cerr << "file \"" << filterFilePath << "\" could not be written."
+				<< endl;
+		exit(1);
+	}
+}
+
+size_t CountingBloomFilter::getSize() const
+{
+	return m_size;
+}
+
+unsigned CountingBloomFilter::getHashNum() const
+{
+	return m_hashNum;
+}
+
+CountingBloomFilter::~CountingBloomFilter()
+{
+	delete[] m_counters;
+}
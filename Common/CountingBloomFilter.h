@@ -0,0 +1,50 @@
+/*
+ * CountingBloomFilter.h
+ *
+ * Bloom filter of small saturating counters (count-min sketch sharing the
+ * hash values of BloomFilter), used to find how often k-mers occur
+ * Counts are never underestimated, but may be overestimated.
+ *
+ * Stored next to a filter (as [FILTERID].counts), counts of the k-mers of the
+ * reference let repetitive k-mers be left out when reads are classified.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef COUNTINGBLOOMFILTER_H_
+#define COUNTINGBLOOMFILTER_H_
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+using namespace std;
+
+class BloomFilter;
+
+class CountingBloomFilter {
+public:
+	explicit CountingBloomFilter(size_t size, unsigned hashNum);
+	unsigned insert(vector<size_t> const &precomputed);
+	unsigned count(vector<size_t> const &precomputed) const;
+	void maskAbove(unsigned maxCount, BloomFilter &mask) const;
+
+	size_t getSize() const;
+	unsigned getHashNum() const;
+
+	//for storing/restoring the counters
+	void storeFilter(const string &filterFilePath) const;
+	explicit CountingBloomFilter(size_t size, unsigned hashNum,
+			const string &filterFilePath);
+
+	virtual ~CountingBloomFilter();
+
+	static const unsigned s_maxCount = 255;
+private:
+	CountingBloomFilter(const CountingBloomFilter& that); //to prevent copy construction
+	uint8_t* m_counters;
+	size_t m_size;
+	unsigned m_hashNum;
+};
+
+#endif /* COUNTINGBLOOMFILTER_H_ */
@@ -0,0 +1,93 @@
+/*
+ * HyperLogLog.h
+ *
+ * Estimates the number of distinct k-mers of a stream in constant memory
+ * (HyperLogLog, Flajolet et al. 2007), used to size filters of redundant
+ * sequences
+ *
+ * Sketches of separate streams (i.e. one per thread) can be merged.
+ * Relative standard error is about 1.04 / sqrt(2^s_precision) (~0.8%).
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef HYPERLOGLOG_H_
+#define HYPERLOGLOG_H_
+
+#include <vector>
+#include <cmath>
+#include <stdint.h>
+#include "Common/city.h"
+
+using namespace std;
+
+class HyperLogLog {
+public:
+	HyperLogLog() :
+			m_registers(size_t(1) << s_precision, 0)
+	{
+	}
+
+	/*
+	 * Adds a k-mer in the format of ReadsProcessor::prepSeq
+	 */
+	void add(const unsigned char* kmer, unsigned kmerSizeInBytes)
+	{
+		add(CityHash64(reinterpret_cast<const char*>(kmer), kmerSizeInBytes));
+	}
+
+	void add(uint64_t hash)
+	{
+		size_t index = hash >> (64 - s_precision);
+		uint64_t rest = hash << s_precision;
+		//position of first set bit of the remaining bits
+		uint8_t rank =
+				rest == 0 ?
+						64 - s_precision + 1 :
+						uint8_t(__builtin_clzll(rest) + 1);
+		if (m_registers[index] < rank) {
+			m_registers[index] = rank;
+		}
+	}
+
+	/*
+	 * Combines sketch of another stream into this one
+	 */
+	void merge(const HyperLogLog &other)
+	{
+		for (size_t i = 0; i < m_registers.size(); ++i) {
+			if (m_registers[i] < other.m_registers[i]) {
+				m_registers[i] = other.m_registers[i];
+			}
+		}
+	}
+
+	/*
+	 * Estimated number of distinct elements added
+	 */
+	size_t estimate() const
+	{
+		double m = double(m_registers.size());
+		double sum = 0;
+		size_t zeros = 0;
+		for (size_t i = 0; i < m_registers.size(); ++i) {
+			sum += ldexp(1.0, -int(m_registers[i]));
+			if (m_registers[i] == 0) {
+				++zeros;
+			}
+		}
+		double alpha = 0.7213 / (1.0 + 1.079 / m);
+		double estimate = alpha * m * m / sum;
+		//linear counting is more accurate for small cardinalities
+		if (estimate <= 2.5 * m && zeros > 0) {
+			estimate = m * log(m / double(zeros));
+		}
+		return size_t(estimate + 0.5);
+	}
+
+private:
+	static const unsigned s_precision = 14;
+	vector<uint8_t> m_registers;
+};
+
+#endif /* HYPERLOGLOG_H_ */
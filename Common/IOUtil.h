@@ -9,6 +9,7 @@
 #include <iostream>
 #include <limits> // for numeric_limits
 #include <string>
+#include <unistd.h> // for pread, pwrite
 
 /** Print an error message and exit if stream is not good. */
 static inline void assert_good(const std::ios& stream,
@@ -106,4 +107,40 @@ static inline void readFile(const char* path, Vector& s)
 	assert(in.gcount() == n);
 }
 
+/** Read exactly size bytes at offset of a file descriptor,
+ * exit on failure. */
+static inline void readBlock(int fd, unsigned char* buffer, size_t size,
+		off_t offset, const std::string& path)
+{
+	while (size > 0) {
+		ssize_t count = pread(fd, buffer, size, offset);
+		if (count <= 0) {
+			std::cerr << "file \"" << path << "\" could not be read."
+				<< std::endl;
+			exit(EXIT_FAILURE);
+		}
+		buffer += count;
+		size -= count;
+		offset += count;
+	}
+}
+
+/** Write exactly size bytes at offset of a file descriptor,
+ * exit on failure. */
+static inline void writeBlock(int fd, const unsigned char* buffer,
+		size_t size, off_t offset, const std::string& path)
+{
+	while (size > 0) {
+		ssize_t count = pwrite(fd, buffer, size, offset);
+		if (count <= 0) {
+			std::cerr << "file \"" << path << "\" could not be written."
+				<< std::endl;
+			exit(EXIT_FAILURE);
+		}
+		buffer += count;
+		size -= count;
+		offset += count;
+	}
+}
+
 #endif
@@ -0,0 +1,112 @@
+/*
+ * MinimizerSampler.h
+ *
+ * Selects the minimizers of a stream of consecutive k-mers, so filters can be
+ * built on (and queried with) a sampled subset of k-mers
+ *
+ * A k-mer is selected if it has the smallest hash value in any window of w
+ * consecutive valid k-mers (leftmost on ties). Canonical k-mers are used, so
+ * both strands of a sequence select the same k-mers.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef MINIMIZERSAMPLER_H_
+#define MINIMIZERSAMPLER_H_
+
+#include <string>
+#include <deque>
+#include <stdint.h>
+#include "Common/city.h"
+
+using namespace std;
+
+class MinimizerSampler {
+public:
+	explicit MinimizerSampler(unsigned kmerSize, unsigned window) :
+			m_kmerSizeInBytes((kmerSize + 3) / 4), m_window(window), m_pos(0), m_validRun(
+					0), m_lastPos(0), m_selected(false)
+	{
+	}
+
+	/*
+	 * Start of a new sequence
+	 */
+	void reset()
+	{
+		m_queue.clear();
+		m_validRun = 0;
+		m_selected = false;
+	}
+
+	/*
+	 * Adds the next k-mer of the sequence (NULL if invalid)
+	 * Returns true if a new minimizer was selected (see getMinimizer())
+	 */
+	bool add(const unsigned char* kmer)
+	{
+		size_t pos = m_pos++;
+		if (kmer == NULL) {
+			//windows cannot span ambiguity bases
+			m_queue.clear();
+			m_validRun = 0;
+			return false;
+		}
+		Entry entry;
+		entry.pos = pos;
+		entry.kmer.assign(reinterpret_cast<const char*>(kmer),
+				m_kmerSizeInBytes);
+		entry.hash = CityHash64(entry.kmer.c_str(), m_kmerSizeInBytes);
+
+		//queue holds increasing hash values of the current window
+		while (!m_queue.empty() && m_queue.back().hash > entry.hash) {
+			m_queue.pop_back();
+		}
+		m_queue.push_back(entry);
+		while (m_queue.front().pos + m_window <= pos) {
+			m_queue.pop_front();
+		}
+		if (++m_validRun < m_window) {
+			return false;
+		}
+		if (m_selected && m_queue.front().pos == m_lastPos) {
+			return false;
+		}
+		m_selected = true;
+		m_lastPos = m_queue.front().pos;
+		return true;
+	}
+
+	/*
+	 * Last selected minimizer, in the same format as ReadsProcessor::prepSeq
+	 */
+	const unsigned char* getMinimizer() const
+	{
+		return reinterpret_cast<const unsigned char*>(m_queue.front().kmer.c_str());
+	}
+
+	/*
+	 * Expected fraction of k-mers selected in random sequence
+	 */
+	static double getDensity(unsigned window)
+	{
+		return window > 1 ? 2.0 / (window + 1) : 1.0;
+	}
+
+private:
+	struct Entry {
+		size_t pos;
+		uint64_t hash;
+		string kmer;
+	};
+
+	unsigned m_kmerSizeInBytes;
+	unsigned m_window;
+	size_t m_pos;
+	unsigned m_validRun;
+	size_t m_lastPos;
+	bool m_selected;
+	deque<Entry> m_queue;
+};
+
+#endif /* MINIMIZERSAMPLER_H_ */
@@ -18,7 +18,7 @@
  */
 ReadsProcessor::ReadsProcessor(unsigned windowSize) :
 		m_kmerSize(windowSize), m_kmerSizeInBytes(windowSize / 4), m_halfSizeOfKmerInBytes(
-				windowSize / 8), m_hangingBases(0), m_hangingBasesExist(0)
+				windowSize / 8), m_hangingBases(0), m_hangingBasesExist(0), m_read(NULL)
 {
 	//parsing code require kmer larger than 3
 	assert(m_kmerSize > 3);
@@ -35,6 +35,55 @@ ReadsProcessor::ReadsProcessor(unsigned windowSize) :
 	m_rv = new unsigned char[m_kmerSizeInBytes];
 }
 
+/*
+ * Sets spaced seed mask applied to all k-mers (see isValidSpacedSeed)
+ */
+void ReadsProcessor::setSpacedSeed(const string &seed)
+{
+	assert(seed.empty() || isValidSpacedSeed(seed, m_kmerSize));
+	m_spacedSeed = seed;
+}
+
+/*
+ * K-mers of read.getSeq() are taken from its shared encoding until another
+ * read is set or it is cleared, read must outlive its use by this processor
+ */
+void ReadsProcessor::setRead(const PackedRead &read)
+{
+	m_read = &read;
+}
+
+/*
+ * Stops using the shared encoding of a read (i.e. before it is destroyed if
+ * this processor is kept for other reads)
+ */
+void ReadsProcessor::clearRead()
+{
+	m_read = NULL;
+}
+
+/*
+ * A spaced seed is a string of 1s (bases used) and 0s (bases ignored) with the
+ * length of the k-mer. It must start and end with 1 and be symmetric so that
+ * both strands of a k-mer ignore the same positions.
+ */
+bool ReadsProcessor::isValidSpacedSeed(const string &seed, unsigned kmerSize)
+{
+	if (seed.length() != kmerSize || seed[0] != '1'
+			|| seed[kmerSize - 1] != '1')
+	{
+		return false;
+	}
+	for (unsigned i = 0; i < kmerSize; ++i) {
+		if ((seed[i] != '0' && seed[i] != '1')
+				|| seed[i] != seed[kmerSize - 1 - i])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
 static const uint8_t fw3[256] = {
 	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, //0
 	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
@@ -357,6 +406,17 @@ const string ReadsProcessor::getBases(const unsigned char* c)
 const unsigned char* ReadsProcessor::prepSeq(string const &sequence,
 		size_t position)
 {
+	if (!m_spacedSeed.empty()) {
+		return prepSpacedSeq(sequence, position);
+	}
+	if (m_read != NULL && &m_read->getSeq() == &sequence
+			&& m_read->isValid(position, m_kmerSize))
+	{
+		const unsigned char* kmer = prepPackedSeq(position);
+		if (kmer != NULL) {
+			return kmer;
+		}
+	}
 	size_t index = position;
 	size_t revIndex = position + m_kmerSize - 1;
 	size_t outputIndex = 0;
@@ -515,6 +575,89 @@ const unsigned char* ReadsProcessor::prepSeq(string const &sequence,
 	return m_fw;
 }
 
+/*
+ * prepSeq for spaced seeds
+ * - Ignored positions are set to 0 on both strands, and may hold any character
+ * - Bases are packed 4 per byte in order, the smaller strand is returned
+ */
+const unsigned char* ReadsProcessor::prepSpacedSeq(string const &sequence,
+		size_t position)
+{
+	size_t revIndex = position + m_kmerSize - 1;
+
+	memset(m_fw, 0, m_kmerSizeInBytes);
+	memset(m_rv, 0, m_kmerSizeInBytes);
+
+	for (unsigned i = 0; i < m_kmerSize; ++i) {
+		if (m_spacedSeed[i] == '0') {
+			continue;
+		}
+		uint8_t fwBase = fw3[static_cast<unsigned char>(sequence[position + i])];
+		uint8_t rvBase = rv3[static_cast<unsigned char>(sequence[revIndex - i])];
+		if (fwBase == 0xFF || rvBase == 0xFF) {
+			return NULL;
+		}
+		unsigned shift = 6 - 2 * (i % 4);
+		m_fw[i / 4] |= fwBase << shift;
+		m_rv[i / 4] |= rvBase << shift;
+	}
+	return memcmp(m_fw, m_rv, m_kmerSizeInBytes) <= 0 ? m_fw : m_rv;
+}
+
+/*
+ * prepSeq for k-mers without ambiguity bases using the shared encoding
+ * Output is identical to prepSeq, NULL is returned if the k-mer is
+ * palindromic in its first half and must be parsed by prepSeq
+ */
+const unsigned char* ReadsProcessor::prepPackedSeq(size_t position)
+{
+	unsigned fullBytes = m_kmerSizeInBytes - m_hangingBasesExist;
+	size_t revIndex = position + m_kmerSize - 1;
+	for (unsigned i = 0; i < fullBytes; ++i) {
+		m_fw[i] = m_read->getFw(position + 4 * i);
+		m_rv[i] = m_read->getRv(revIndex - 4 * i);
+	}
+	if (m_hangingBasesExist) {
+		unsigned char mask = 0xFF << (8 - 2 * m_hangingBases);
+		m_fw[fullBytes] = m_read->getFw(position + 4 * fullBytes) & mask;
+		m_rv[fullBytes] = m_read->getRv(revIndex - 4 * fullBytes) & mask;
+	}
+	//strand is chosen on the first half as in prepSeq
+	int cmp = memcmp(m_fw, m_rv, m_halfSizeOfKmerInBytes);
+	if (cmp < 0) {
+		return m_fw;
+	}
+	if (cmp > 0) {
+		return m_rv;
+	}
+	return NULL;
+}
+
+/*
+ * Encodes read once, ambiguity bases are encoded as A and recorded so
+ * k-mers containing them can be rejected
+ */
+PackedRead::PackedRead(const string &seq) :
+		m_seq(seq), m_fw(seq.length()), m_rv(seq.length()), m_nextInvalid(
+				seq.length() + 1)
+{
+	size_t length = seq.length();
+	m_nextInvalid[length] = length;
+	unsigned char next = 0;
+	for (size_t i = length; i > 0; --i) {
+		uint8_t base = fw3[static_cast<unsigned char>(seq[i - 1])];
+		m_nextInvalid[i - 1] = base == 0xFF ? i - 1 : m_nextInvalid[i];
+		next = ((base & 0x03) << 6) | (next >> 2);
+		m_fw[i - 1] = next;
+	}
+	unsigned char prev = 0;
+	for (size_t i = 0; i < length; ++i) {
+		uint8_t base = fw3[static_cast<unsigned char>(seq[i])];
+		prev = ((3 - (base & 0x03)) << 6) | (prev >> 2);
+		m_rv[i] = prev;
+	}
+}
+
 ReadsProcessor::~ReadsProcessor()
 {
 	delete[] m_fw;
@@ -8,14 +8,58 @@
 #ifndef READSPROCESSOR_H_
 #define READSPROCESSOR_H_
 #include <string>
+#include <vector>
 #include <stdint.h>
 
 using namespace std;
 
+/*
+ * 2-bit encoding of a read computed once and shared by the ReadsProcessors
+ * of every k-mer size, so k-mers of any size are copied out of it instead of
+ * being parsed from the sequence again
+ */
+class PackedRead {
+public:
+	explicit PackedRead(const string &seq);
+
+	const string &getSeq() const
+	{
+		return m_seq;
+	}
+
+	//true if the k-mer at position has only ACGT bases
+	bool isValid(size_t position, unsigned kmerSize) const
+	{
+		return m_nextInvalid[position] >= position + kmerSize;
+	}
+
+	//4 bases starting at position, first base in the high bits
+	unsigned char getFw(size_t position) const
+	{
+		return m_fw[position];
+	}
+
+	//complement of 4 bases ending at position, last base in the high bits
+	unsigned char getRv(size_t position) const
+	{
+		return m_rv[position];
+	}
+
+private:
+	const string &m_seq;
+	vector<unsigned char> m_fw;
+	vector<unsigned char> m_rv;
+	vector<size_t> m_nextInvalid;
+};
+
 class ReadsProcessor {
 public:
 	ReadsProcessor(unsigned windowSize);
+	void setSpacedSeed(const string &seed);
+	void setRead(const PackedRead &read);
+	void clearRead();
 	const unsigned char* prepSeq(string const &sequence, size_t position);
+	static bool isValidSpacedSeed(const string &seed, unsigned kmerSize);
 	const string getBases(const unsigned char* c); //for debuging purposes
 	virtual ~ReadsProcessor();
 private:
@@ -27,6 +71,13 @@ private:
 	unsigned m_halfSizeOfKmerInBytes;
 	unsigned m_hangingBases; // used if k-mer is indivisible by 4
 	unsigned m_hangingBasesExist;
+	//empty if all bases of the k-mer are used
+	string m_spacedSeed;
+	//shared encoding of the read currently processed, if any
+	const PackedRead *m_read;
+
+	const unsigned char* prepSpacedSeq(string const &sequence, size_t position);
+	const unsigned char* prepPackedSeq(size_t position);
 };
 
 #endif /* READSPROCESSOR_H_ */
@@ -13,446 +13,447 @@
 #define SEQEVAL_H_
 
 #include <string>
+#include <vector>
+#include <limits>
+#include <algorithm>
 #include "boost/unordered/unordered_map.hpp"
 #include "DataLayer/FastaReader.h"
+#include "Common/BloomFilter.h"
+#include "Common/ReadsProcessor.h"
 #include "Common/Options.h"
 
 using namespace std;
 using namespace boost;
 
 namespace SeqEval {
+
 /*
- * Evaluation algorithm with no hashValue storage (optimize speed for single queries)
+ * Result of probing the k-mer at a single position of a sequence
  */
-inline bool evalSingle(const FastqRecord &rec, unsigned kmerSize, const BloomFilter &filter,
-		double threshold, size_t antiThreshold)
-{
-	ReadsProcessor proc(kmerSize);
-	size_t currentLoc = 0;
-	double score = 0;
-	unsigned antiScore = 0;
-	unsigned streak = 0;
-	while (rec.seq.length() >= currentLoc + kmerSize) {
-		const unsigned char* currentKmer = proc.prepSeq(rec.seq, currentLoc);
-		if (streak == 0) {
-			if (currentKmer != NULL) {
-				if (filter.contains(currentKmer)) {
-					score += 0.5;
-					++streak;
-					if (threshold <= score) {
-						return true;
-					}
-				}
-				else if (antiThreshold <= ++antiScore) {
-					return false;
-				}
-				++currentLoc;
-			} else {
-				if (currentLoc > kmerSize) {
-					currentLoc += kmerSize + 1;
-					antiScore += kmerSize + 1;
-				} else {
-					++antiScore;
-					++currentLoc;
-				}
-				if (antiThreshold <= antiScore) {
-					return false;
-				}
-			}
-		} else {
-			if (currentKmer != NULL) {
-				if (filter.contains(currentKmer)) {
-					++streak;
-					score += 1 - 1 / (2 * streak);
-					++currentLoc;
+enum KmerState {
+	KMER_INVALID, KMER_MISS, KMER_HIT
+};
 
-					if (threshold <= score) {
-						return true;
-					}
-					continue;
-				}
-				else if (antiThreshold <= ++antiScore) {
-					return false;
-				}
-			} else {
-				currentLoc += kmerSize + 1;
-				antiScore += kmerSize + 1;
-			}
-			if (streak < opt::streakThreshold) {
-				++currentLoc;
-			} else {
-				currentLoc += kmerSize;
-				antiScore += kmerSize;
-			}
-			if (antiThreshold <= antiScore) {
-				return false;
-			}
-			streak = 0;
+//Filter-probe policies
+//A probe decides if a k-mer (raw or as precomputed hash values) is a hit.
+//Any filter back-end with contains() for both forms can be used.
+
+/*
+ * Hit if k-mer is in filter
+ */
+template<typename Filter>
+class FilterProbe {
+public:
+	explicit FilterProbe(const Filter &filter) :
+			m_filter(&filter)
+	{
+	}
+	bool contains(const unsigned char* kmer) const
+	{
+		return m_filter->contains(kmer);
+	}
+	bool contains(const vector<size_t> &hashValues) const
+	{
+		return m_filter->contains(hashValues);
+	}
+private:
+	const Filter *m_filter;
+};
+
+/*
+ * Hit if k-mer is in filter but neither in the subtraction filter nor in the
+ * mask of repetitive k-mers of the filter (each none if NULL)
+ * They are only probed on hits of the filter, with the same hash values, so
+ * they must not use more hash functions than the filter
+ */
+template<typename Filter>
+class SubtractProbe {
+public:
+	explicit SubtractProbe(const Filter &filter, const Filter *subtract,
+			const Filter *repeats = NULL) :
+			m_filter(&filter), m_subtract(subtract), m_repeats(repeats)
+	{
+	}
+	bool contains(const unsigned char* kmer) const
+	{
+		return m_filter->contains(kmer)
+				&& (m_subtract == NULL || !m_subtract->contains(kmer))
+				&& (m_repeats == NULL || !m_repeats->contains(kmer));
+	}
+	bool contains(const vector<size_t> &hashValues) const
+	{
+		return m_filter->contains(hashValues)
+				&& (m_subtract == NULL || !m_subtract->contains(hashValues))
+				&& (m_repeats == NULL || !m_repeats->contains(hashValues));
+	}
+private:
+	const Filter *m_filter;
+	const Filter *m_subtract;
+	const Filter *m_repeats;
+};
+
+//Hash-caching policies
+//Turn a position in the sequence into a KmerState using a probe.
+
+/*
+ * No hash value storage, hashes computed on the fly by the filter
+ * (optimize speed for single queries)
+ */
+class NoHashCache {
+public:
+	explicit NoHashCache(const string &seq, unsigned kmerSize) :
+			m_seq(seq), m_proc(kmerSize)
+	{
+	}
+	template<typename Probe>
+	KmerState probe(const Probe &probe, size_t pos)
+	{
+		const unsigned char* kmer = m_proc.prepSeq(m_seq, pos);
+		if (kmer == NULL) {
+			return KMER_INVALID;
 		}
+		return probe.contains(kmer) ? KMER_HIT : KMER_MISS;
 	}
-	return false;
-}
+private:
+	const string &m_seq;
+	ReadsProcessor m_proc;
+};
 
 /*
- * Evaluation algorithm with hashValue storage (minimize redundant work)
+ * As NoHashCache, but k-mers are parsed by a processor of the caller (i.e. one
+ * set to the shared encoding of the read, see ReadsProcessor::setRead)
  */
-inline bool evalSingle(const FastqRecord &rec, unsigned kmerSize, const BloomFilter &filter,
-		double threshold, double antiThreshold, unsigned hashNum,
-		vector<vector<size_t> > &hashValues, const BloomFilter &subtract)
-{
-	ReadsProcessor proc(kmerSize);
-	size_t currentLoc = 0;
-	double score = 0;
-	unsigned antiScore = 0;
-	unsigned streak = 0;
-	while (rec.seq.length() >= currentLoc + kmerSize) {
-		const unsigned char* currentSeq = proc.prepSeq(rec.seq, currentLoc);
-		if (streak == 0) {
-			if (currentSeq != NULL) {
-				hashValues[currentLoc] = multiHash(currentSeq, hashNum, kmerSize);
-				if (!subtract.contains(hashValues[currentLoc])
-						&& filter.contains(hashValues[currentLoc])) {
-					score += 0.5;
-					++streak;
-					if (threshold <= score) {
-						return true;
-					}
-				}
-				else if (antiThreshold <= ++antiScore) {
-					return false;
-				}
-				++currentLoc;
-			} else {
-				if (currentLoc > kmerSize) {
-					currentLoc += kmerSize + 1;
-					antiScore += kmerSize + 1;
-				} else {
-					++antiScore;
-					++currentLoc;
-				}
-				if (antiThreshold <= antiScore) {
-					return false;
-				}
-			}
-		} else {
-			if (currentSeq != NULL) {
-				hashValues[currentLoc] = multiHash(currentSeq, hashNum, kmerSize);
-				if (!subtract.contains(hashValues[currentLoc])
-						&& filter.contains(hashValues[currentLoc])) {
-					++streak;
-					score += 1 - 1 / (2 * streak);
-					++currentLoc;
+class SharedNoHashCache {
+public:
+	explicit SharedNoHashCache(const string &seq, ReadsProcessor &proc) :
+			m_seq(seq), m_proc(proc)
+	{
+	}
+	template<typename Probe>
+	KmerState probe(const Probe &probe, size_t pos)
+	{
+		const unsigned char* kmer = m_proc.prepSeq(m_seq, pos);
+		if (kmer == NULL) {
+			return KMER_INVALID;
+		}
+		return probe.contains(kmer) ? KMER_HIT : KMER_MISS;
+	}
+private:
+	const string &m_seq;
+	ReadsProcessor &m_proc;
+};
 
-					if (threshold <= score) {
-						return true;
-					}
-					continue;
-				}
-				else if (antiThreshold <= ++antiScore) {
-					return false;
-				}
-			} else {
-				currentLoc += kmerSize + 1;
-				antiScore += kmerSize + 1;
-			}
-			if (streak < opt::streakThreshold) {
-				++currentLoc;
-			} else {
-				currentLoc += kmerSize;
-				antiScore += kmerSize;
-			}
-			if (antiThreshold <= antiScore) {
-				return false;
+/*
+ * Hash values of every evaluated position are stored (so they can be
+ * reused later, i.e. when inserting the read into a filter)
+ */
+class StoreHashes {
+public:
+	explicit StoreHashes(const string &seq, unsigned kmerSize,
+			unsigned hashNum, vector<vector<size_t> > &hashValues) :
+			m_seq(seq), m_kmerSize(kmerSize), m_hashNum(hashNum), m_proc(
+					kmerSize), m_hashValues(hashValues)
+	{
+	}
+	template<typename Probe>
+	KmerState probe(const Probe &probe, size_t pos)
+	{
+		const unsigned char* kmer = m_proc.prepSeq(m_seq, pos);
+		if (kmer == NULL) {
+			return KMER_INVALID;
+		}
+		m_hashValues[pos] = multiHash(kmer, m_hashNum, m_kmerSize);
+		return probe.contains(m_hashValues[pos]) ? KMER_HIT : KMER_MISS;
+	}
+private:
+	const string &m_seq;
+	unsigned m_kmerSize;
+	unsigned m_hashNum;
+	ReadsProcessor m_proc;
+	vector<vector<size_t> > &m_hashValues;
+};
+
+/*
+ * Hash values are computed only if not computed by a previous evaluation
+ * of the same sequence (i.e. against another filter)
+ * Also stores if position has already been visited to minimize work
+ */
+class ReuseHashes {
+public:
+	explicit ReuseHashes(const string &seq, unsigned kmerSize,
+			unsigned hashNum, vector<bool> &visited,
+			vector<vector<size_t> > &hashValues, ReadsProcessor &proc) :
+			m_seq(&seq), m_kmerSize(kmerSize), m_hashNum(hashNum), m_visited(
+					visited), m_hashValues(hashValues), m_proc(proc)
+	{
+	}
+	/*
+	 * Moves on to another sequence (visited and hashValues must be reset by
+	 * the caller), so a cache can be reused across reads
+	 */
+	void setSeq(const string &seq)
+	{
+		m_seq = &seq;
+	}
+	template<typename Probe>
+	KmerState probe(const Probe &probe, size_t pos)
+	{
+		if (!m_visited[pos]) {
+			const unsigned char* kmer = m_proc.prepSeq(*m_seq, pos);
+			if (kmer != NULL) {
+				m_hashValues[pos] = multiHash(kmer, m_hashNum, m_kmerSize);
 			}
-			streak = 0;
+			m_visited[pos] = true;
+		}
+		if (m_hashValues[pos].empty()) {
+			return KMER_INVALID;
 		}
+		return probe.contains(m_hashValues[pos]) ? KMER_HIT : KMER_MISS;
 	}
-	return false;
-}
+private:
+	const string *m_seq;
+	unsigned m_kmerSize;
+	unsigned m_hashNum;
+	vector<bool> &m_visited;
+	vector<vector<size_t> > &m_hashValues;
+	ReadsProcessor &m_proc;
+};
 
 /*
- * Evaluation algorithm with hashValue storage (minimize redundant work)
+ * Outcome of a single evaluation step
  */
-inline bool evalSingle(const FastqRecord &rec, unsigned kmerSize, const BloomFilter &filter,
-		double threshold, double antiThreshold, unsigned hashNum,
-		vector<vector<size_t> > &hashValues)
+enum EvalStatus {
+	EVAL_CONTINUE, EVAL_PASS, EVAL_FAIL
+};
+
+/*
+ * Single step of the evaluation algorithm, shared by all evaluation variants
+ * Probes the k-mer at currentLoc, accumulating score over streaks of hits and
+ * jumping over tiles upon misses after a long streak (opt::streakThreshold)
+ * Returns EVAL_PASS once score reaches threshold, EVAL_FAIL once misses reach
+ * antiThreshold or sequence end is reached
+ */
+template<typename Probe, typename HashCache>
+inline EvalStatus evalStep(size_t seqLength, unsigned kmerSize,
+		const Probe &probe, HashCache &cache, double threshold,
+		double antiThreshold, unsigned &currentLoc, double &score,
+		unsigned &streak, unsigned &antiScore)
 {
-	ReadsProcessor proc(kmerSize);
-	size_t currentLoc = 0;
-	double score = 0;
-	unsigned antiScore = 0;
-	unsigned streak = 0;
-	while (rec.seq.length() >= currentLoc + kmerSize) {
-		const unsigned char* currentSeq = proc.prepSeq(rec.seq, currentLoc);
-		if (streak == 0) {
-			if (currentSeq != NULL) {
-				hashValues[currentLoc] = multiHash(currentSeq, hashNum, kmerSize);
-				if (filter.contains(hashValues[currentLoc])) {
-					score += 0.5;
-					++streak;
-					if (threshold <= score) {
-						return true;
-					}
-				}
-				else if (antiThreshold <= ++antiScore) {
-					return false;
-				}
-				++currentLoc;
-			} else {
-				if (currentLoc > kmerSize) {
-					currentLoc += kmerSize + 1;
-					antiScore += kmerSize + 1;
-				} else {
-					++antiScore;
+	if (seqLength < currentLoc + kmerSize) {
+		return EVAL_FAIL;
+	}
+	KmerState state = cache.probe(probe, currentLoc);
+	if (streak == 0) {
+		if (state != KMER_INVALID) {
+			if (state == KMER_HIT) {
+				score += 0.5;
+				++streak;
+				if (threshold <= score) {
 					++currentLoc;
+					return EVAL_PASS;
 				}
-				if (antiThreshold <= antiScore) {
-					return false;
-				}
+			} else if (antiThreshold <= ++antiScore) {
+				++currentLoc;
+				return EVAL_FAIL;
 			}
+			++currentLoc;
 		} else {
-			if (currentSeq != NULL) {
-				hashValues[currentLoc] = multiHash(currentSeq, hashNum, kmerSize);
-				if (filter.contains(hashValues[currentLoc])) {
-					++streak;
-					score += 1 - 1 / (2 * streak);
-					++currentLoc;
-
-					if (threshold <= score) {
-						return true;
-					}
-					continue;
-				}
-				else if (antiThreshold <= ++antiScore) {
-					return false;
-				}
-			} else {
+			if (currentLoc > kmerSize) {
 				currentLoc += kmerSize + 1;
 				antiScore += kmerSize + 1;
-			}
-			if (streak < opt::streakThreshold) {
-				++currentLoc;
 			} else {
-				currentLoc += kmerSize;
-				antiScore += kmerSize;
+				++antiScore;
+				++currentLoc;
 			}
 			if (antiThreshold <= antiScore) {
-				return false;
+				return EVAL_FAIL;
 			}
-			streak = 0;
 		}
-	}
-	return false;
-}
+	} else {
+		if (state != KMER_INVALID) {
+			if (state == KMER_HIT) {
+				++streak;
+				score += 1 - 1 / (2 * streak);
+				++currentLoc;
 
-/*
- * Evaluation algorithm with no hashValue storage (optimize speed for single queries)
- * Returns score and does not have a stopping threshold
- */
-inline double evalSingleExhaust(const FastqRecord &rec, unsigned kmerSize,
-		const BloomFilter &filter)
-{
-	ReadsProcessor proc(kmerSize);
-	size_t currentLoc = 0;
-	double score = 0;
-	unsigned streak = 0;
-	while (rec.seq.length() >= currentLoc + kmerSize) {
-		const unsigned char* currentKmer = proc.prepSeq(rec.seq, currentLoc);
-		if (streak == 0) {
-			if (currentKmer != NULL) {
-				if (filter.contains(currentKmer)) {
-					score += 0.5;
-					++streak;
+				if (threshold <= score) {
+					return EVAL_PASS;
 				}
+				return EVAL_CONTINUE;
+			} else if (antiThreshold <= ++antiScore) {
 				++currentLoc;
-			} else {
-				currentLoc += kmerSize + 1;
+				return EVAL_FAIL;
 			}
 		} else {
-			if (currentKmer != NULL) {
-				if (filter.contains(currentKmer)) {
-					++streak;
-					score += 1 - 1 / (2 * streak);
-					++currentLoc;
-					continue;
-				}
-			} else {
-				currentLoc += kmerSize + 1;
-			}
-			if (streak < opt::streakThreshold) {
-				++currentLoc;
-			} else {
-				currentLoc += kmerSize;
-			}
-			streak = 0;
+			//if has non atcg character
+			currentLoc += kmerSize + 1;
+			antiScore += kmerSize + 1;
 		}
+		if (streak < opt::streakThreshold) {
+			++currentLoc;
+		} else {
+			currentLoc += kmerSize;
+			antiScore += kmerSize;
+		}
+		if (antiThreshold <= antiScore) {
+			return EVAL_FAIL;
+		}
+		streak = 0;
 	}
-	return false;
+	return EVAL_CONTINUE;
 }
 
-///*
-// * Evaluation algorithm with no hashValue storage (optimize speed for single queries)
-// * Returns length when stopping threshold is met
-// * Returns the length of the read where threshold was met
-// */
-//inline unsigned evalSingleLength(const FastqRecord &rec, unsigned kmerSize,
-//		const BloomFilter &filter, double threshold, double antiThreshold)
-//{
-//	ReadsProcessor proc(kmerSize);
-//	size_t currentLoc = 0;
-//	double score = 0;
-//	unsigned antiScore = 0;
-//	unsigned streak = 0;
-//	while (rec.seq.length() >= currentLoc + kmerSize) {
-//		const unsigned char* currentKmer = proc.prepSeq(rec.seq, currentLoc);
-//		if (streak == 0) {
-//			if (currentKmer != NULL) {
-//				if (filter.contains(currentKmer)) {
-//					score += 0.5;
-//					++streak;
-//					if (threshold <= score) {
-//						return currentLoc;
-//					}
-//				} else if (antiThreshold <= ++antiScore) {
-//					return rec.seq.length() - kmerSize;
-//				}
-//				++currentLoc;
-//			} else {
-//				if (currentLoc > kmerSize) {
-//					currentLoc += kmerSize + 1;
-//					antiScore += kmerSize + 1;
-//				} else {
-//					++antiScore;
-//					++currentLoc;
-//				}
-//				if (antiThreshold <= antiScore) {
-//					return rec.seq.length() - kmerSize;
-//				}
-//			}
-//		} else {
-//			if (currentKmer != NULL) {
-//				if (filter.contains(currentKmer)) {
-//					++streak;
-//					score += 1 - 1 / (2 * streak);
-//
-//					if (threshold <= score) {
-//						return currentLoc;
-//					}
-//					++currentLoc;
-//					continue;
-//				} else if (antiThreshold <= ++antiScore) {
-//					return rec.seq.length() - kmerSize;
-//				}
-//			} else {
-//				currentLoc += kmerSize + 1;
-//				antiScore += kmerSize + 1;
-//			}
-//			if (streak < opt::streakThreshold) {
-//				++currentLoc;
-//			} else {
-//				currentLoc += kmerSize;
-//				antiScore += kmerSize;
-//			}
-//			if (antiThreshold <= antiScore) {
-//				return rec.seq.length() - kmerSize;
-//			}
-//			streak = 0;
-//		}
-//	}
-//	return rec.seq.length() - kmerSize;
-//}
-
 /*
- * Core evaluation algorithm, with ability start evaluating sequence midway
- * Evaluation algorithm with hashValue storage (minimize redundant work)
- * Also stores if position has already been visited to minimize work
- * Takes in last position visited and score and updates them accordingly
+ * Core evaluation algorithm, shared by all evaluation variants
+ * Returns true once score reaches threshold (see evalStep)
+ *
+ * Able to start evaluating sequence midway: takes in last position visited
+ * and score and updates them accordingly
  */
-inline bool eval(const FastqRecord &rec, unsigned kmerSize,
-		const BloomFilter &filter, double threshold, double antiThreshold,
-		vector<bool> &visited, vector<vector<size_t> > &hashValues,
-		unsigned &currentLoc, double &score, ReadsProcessor &proc)
+template<typename Probe, typename HashCache>
+inline bool evalCore(size_t seqLength, unsigned kmerSize, const Probe &probe,
+		HashCache &cache, double threshold, double antiThreshold,
+		unsigned &currentLoc, double &score)
 {
 	unsigned antiScore = 0;
 	unsigned streak = 0;
-	while (rec.seq.length() >= currentLoc + kmerSize) {
+	EvalStatus status;
+	do {
+		status = evalStep(seqLength, kmerSize, probe, cache, threshold,
+				antiThreshold, currentLoc, score, streak, antiScore);
+	} while (status == EVAL_CONTINUE);
+	return status == EVAL_PASS;
+}
 
-		//prepare hash values for filter
+/*
+ * Stepwise exhaustive evaluation of a sequence against a single filter
+ * Used to evaluate several filters in lockstep, tracking an upper bound on
+ * the score each filter can still reach
+ */
+template<typename Probe, typename HashCache>
+class ExhaustEval {
+public:
+	explicit ExhaustEval(size_t seqLength, unsigned kmerSize,
+			const Probe &probe, HashCache &cache) :
+			m_seqLength(seqLength), m_kmerSize(kmerSize), m_kmerCount(
+					seqLength >= kmerSize ? seqLength - kmerSize + 1 : 0), m_probe(
+					probe), m_cache(&cache), m_currentLoc(0), m_score(0), m_streak(
+					0), m_antiScore(0)
+	{
+	}
 
-		//check if hash value is already generated
-		if (hashValues[currentLoc].size() == 0) {
-			if (!visited[currentLoc]) {
-				const unsigned char* currentSeq = proc.prepSeq(rec.seq,
-						currentLoc);
-				if (currentSeq != NULL) {
-					hashValues[currentLoc] = multiHash(currentSeq, filter.getHashNum(),
-							kmerSize);
-				}
-				visited[currentLoc] = true;
-			}
+	/*
+	 * Evaluates next position, returns false once sequence end is reached
+	 */
+	bool step()
+	{
+		return evalStep(m_seqLength, m_kmerSize, m_probe, *m_cache,
+				numeric_limits<double>::max(), numeric_limits<double>::max(),
+				m_currentLoc, m_score, m_streak, m_antiScore) == EVAL_CONTINUE;
+	}
+
+	double getScore() const
+	{
+		return m_score;
+	}
+
+	/*
+	 * Highest final score still reachable: each remaining position adds at
+	 * most 1, and the first hit of a streak only 0.5
+	 */
+	double getMaxScore() const
+	{
+		if (m_currentLoc >= m_kmerCount) {
+			return m_score;
 		}
+		double remaining = m_kmerCount - m_currentLoc;
+		return m_streak == 0 ? m_score + remaining - 0.5 : m_score + remaining;
+	}
 
-		if (streak == 0) {
-			if (hashValues[currentLoc].size() > 0) {
-				if (filter.contains(hashValues[currentLoc])) {
-					score += 0.5;
-					++streak;
-					if (threshold <= score) {
-						++currentLoc;
-						return true;
-					}
-				}
-				else if (antiThreshold <= ++antiScore) {
-					++currentLoc;
-					return false;
-				}
-				++currentLoc;
-			} else {
-				if (currentLoc > kmerSize) {
-					currentLoc += kmerSize + 1;
-					antiScore += kmerSize + 1;
-				} else {
-					++antiScore;
-					++currentLoc;
-				}
-				if (antiThreshold <= antiScore) {
-					return false;
-				}
-			}
-		} else {
-			if (hashValues[currentLoc].size() > 0) {
-				if (filter.contains(hashValues[currentLoc])) {
-					++streak;
-					score += 1 - 1 / (2 * streak);
-					++currentLoc;
+	size_t getKmerCount() const
+	{
+		return m_kmerCount;
+	}
+private:
+	size_t m_seqLength;
+	unsigned m_kmerSize;
+	size_t m_kmerCount;
+	Probe m_probe;
+	HashCache *m_cache;
+	unsigned m_currentLoc;
+	double m_score;
+	unsigned m_streak;
+	unsigned m_antiScore;
+};
 
-					if (threshold <= score) {
-						return true;
-					}
-					continue;
-				}
-				else if (antiThreshold <= ++antiScore) {
-					++currentLoc;
-					return false;
-				}
-			} else {
-				//if has non atcg character
-				currentLoc += kmerSize + 1;
-				antiScore += kmerSize + 1;
+/*
+ * Exhaustive evaluation of a sequence against several filters in lockstep,
+ * one position at a time (see ExhaustEval)
+ * If prune, filters whose highest reachable score falls below the best score
+ * so far are dropped (scores are normalized by the number of k-mers)
+ * Sets best to true for the filters with the best score, none if no k-mer is
+ * a hit, and returns that score
+ */
+template<typename Eval>
+inline double bestHit(vector<Eval> &evals, vector<bool> &best, bool prune)
+{
+	vector<bool> running(evals.size(), true);
+	vector<bool> dropped(evals.size(), false);
+	double leaderScore = 0;
+	for (bool active = !evals.empty(); active;) {
+		active = false;
+		for (unsigned i = 0; i < evals.size(); ++i) {
+			if (running[i]) {
+				running[i] = evals[i].step();
+				active |= running[i];
+				leaderScore = max(leaderScore,
+						evals[i].getScore() / evals[i].getKmerCount());
 			}
-			if (streak < opt::streakThreshold) {
-				++currentLoc;
-			} else {
-				currentLoc += kmerSize;
-				antiScore += kmerSize;
+		}
+		for (unsigned i = 0; prune && i < evals.size(); ++i) {
+			if (!dropped[i]
+					&& evals[i].getMaxScore() / evals[i].getKmerCount()
+							< leaderScore)
+			{
+				dropped[i] = true;
+				running[i] = false;
 			}
-			if (antiThreshold <= antiScore) {
-				return false;
+		}
+	}
+
+	//scores of remaining filters are final and at least the leader's
+	best.assign(evals.size(), false);
+	if (leaderScore > 0) {
+		for (unsigned i = 0; i < evals.size(); ++i) {
+			if (!dropped[i]
+					&& evals[i].getScore() / evals[i].getKmerCount()
+							== leaderScore)
+			{
+				best[i] = true;
 			}
-			streak = 0;
 		}
 	}
-	return false;
+	return leaderScore;
+}
+
+/*
+ * Screening algorithm shared by all evaluation variants
+ * Checks non-overlapping k-mers, returns the number of hits (counting stops
+ * at maxHit)
+ */
+template<typename Probe, typename HashCache>
+inline unsigned screenCore(size_t seqLength, unsigned kmerSize,
+		const Probe &probe, HashCache &cache, unsigned maxHit)
+{
+	unsigned screeningHits = 0;
+	size_t screeningLoc = seqLength % kmerSize / 2;
+	while (screeningHits < maxHit && seqLength >= screeningLoc + kmerSize) {
+		if (cache.probe(probe, screeningLoc) == KMER_HIT) {
+			++screeningHits;
+		}
+		screeningLoc += kmerSize;
+	}
+	return screeningHits;
 }
 
 }
@@ -7,15 +7,364 @@
 
 #include "Common/Dynamicofstream.h"
 #include "Common/Uncompress.h"
+#include "BioBloomCategorizer/ReadCache.h"
+#include "BioBloomCategorizer/ReadCache.cpp"
+#include "BioBloomCategorizer/BioBloomClassifier.h"
+#include "BioBloomCategorizer/BioBloomClassifier.cpp"
+#include "BioBloomCategorizer/MultiFilter.cpp"
+#include "BioBloomCategorizer/ResultsManager.cpp"
+#include "BioBloomCategorizer/ReadExtractor.h"
+#include "BioBloomCategorizer/ReadExtractor.cpp"
+#include "Common/BloomFilter.h"
+#include "Common/BloomFilterInfo.h"
+#include "Common/ReadsProcessor.h"
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <cassert>
+#include "TestHelpers.h"
 
 using namespace std;
 
+//read cache returns stored results of identical reads only and is bounded
+void readCacheTests()
+{
+	ReadCache cache(1000);
+	ReadCache::Result result;
+	result.hits["A"] = true;
+	result.hits["B"] = false;
+	result.score = 0.5;
+	result.scores.push_back(0.5);
+	result.scores.push_back(0.1);
+
+	string read = "ATCGGGTCATCAACCAATATCGGGATCGATCGATCGG";
+	ReadCache::Result cached;
+	assert(!cache.lookup(read, cached));
+	cache.store(read, result);
+	assert(cache.lookup(read, cached));
+	assert(cached.hits == result.hits);
+	assert(cached.score == result.score);
+	assert(cached.scores == result.scores);
+	assert(!cache.lookup(read.substr(1), cached));
+
+	//oldest reads are evicted once full
+	for (unsigned i = 0; i < 10000; ++i) {
+		stringstream seq;
+		seq << read << i;
+		cache.store(seq.str(), result);
+	}
+	unsigned found = 0;
+	for (unsigned i = 0; i < 10000; ++i) {
+		stringstream seq;
+		seq << read << i;
+		if (cache.lookup(seq.str(), cached)) {
+			++found;
+		}
+	}
+	assert(found > 0 && found <= 1000);
+	assert(cache.getSummary().find("read_cache") != string::npos);
+	cout << "Read cache tests done" << endl;
+}
+
+static const unsigned testKmerSize = 25;
+static const unsigned testHashNum = 3;
+
+//stores the filter of the k-mers of sequences at prefix.bf with its
+//information file
+void storeTestFilter(const string &prefix, const string &filterID,
+		const vector<string> &seqs, unsigned kmerSize = testKmerSize,
+		unsigned hashNum = testHashNum)
+{
+	vector<string> seqSrcs(1, prefix + ".fa");
+	BloomFilterInfo info(filterID, kmerSize, hashNum, 0.0001, 100000,
+			seqSrcs);
+	BloomFilter filter(info.getCalcuatedFilterSize(), hashNum, kmerSize);
+	ReadsProcessor proc(kmerSize);
+	size_t kmerNum = 0;
+	for (vector<string>::const_iterator i = seqs.begin(); i != seqs.end();
+			++i)
+	{
+		for (size_t j = 0; j + kmerSize <= i->length(); ++j) {
+			filter.insert(proc.prepSeq(*i, j));
+			++kmerNum;
+		}
+	}
+	info.setTotalNum(kmerNum);
+	info.setRedundancy(0);
+	info.printInfoFile(prefix + ".txt");
+	filter.storeFilter(prefix + ".bf");
+}
+
+void removeTestFilter(const string &prefix)
+{
+	remove((prefix + ".bf").c_str());
+	remove((prefix + ".txt").c_str());
+}
+
+//fastq record as written by the extractor
+string fastqRecord(const string &id, const string &seq)
+{
+	return "@" + id + "\n" + seq + "\n+\n" + string(seq.length(), 'I') + "\n";
+}
+
+//ID of the i-th read of the tests
+string readID(unsigned i)
+{
+	stringstream id;
+	id << "read" << i;
+	return id.str();
+}
+
+//categories read i is made to fall into: filter A, B, both or none
+string readCategory(unsigned i)
+{
+	static const char *categories[] = { "A", "B", "multiMatch", "noMatch" };
+	return categories[i % 4];
+}
+
+//100bp read i (or its mate) from the sequence of its category
+string readSeq(unsigned i, unsigned mate, const vector<string> &sources)
+{
+	return sources[i % 4].substr(i * 40 + mate * 200, 100);
+}
+
+//the reads assigned with --assign (optionally compressed) are the ones
+//biobloomextractor gets from the input files, for single reads split across
+//files and for pairs
+void assignExtractTests()
+{
+	//sequences of A only, B only, both and neither
+	vector<string> sources;
+	for (unsigned i = 0; i < 4; ++i) {
+		sources.push_back(randomSeq(2000, 11 + i));
+	}
+	vector<string> seqs(2, sources[2]);
+	seqs[0] = sources[0];
+	storeTestFilter("/tmp/assignA", "A", seqs);
+	seqs[0] = sources[1];
+	storeTestFilter("/tmp/assignB", "B", seqs);
+	vector<string> filters;
+	filters.push_back("/tmp/assignA.bf");
+	filters.push_back("/tmp/assignB.bf");
+
+	const unsigned readNum = 40;
+	vector<string> inputFiles;
+	inputFiles.push_back("/tmp/assignReads1.fq");
+	inputFiles.push_back("/tmp/assignReads2.fq");
+	{
+		ofstream file1(inputFiles[0].c_str());
+		ofstream file2(inputFiles[1].c_str());
+		ofstream mates1("/tmp/assignMates1.fq");
+		ofstream mates2("/tmp/assignMates2.fq");
+		for (unsigned i = 0; i < readNum; ++i) {
+			(i < readNum / 2 ? file1 : file2)
+					<< fastqRecord(readID(i), readSeq(i, 0, sources));
+			mates1 << fastqRecord(readID(i) + "/1", readSeq(i, 0, sources));
+			mates2 << fastqRecord(readID(i) + "/2", readSeq(i, 1, sources));
+		}
+	}
+
+	string prefix = "/tmp/assignTest";
+	string postfixes[] = { "", ".gz" };
+	for (unsigned p = 0; p < 2; ++p) {
+		string assignFile = prefix + "_assign.tsv" + postfixes[p];
+		for (unsigned paired = 0; paired < 2; ++paired) {
+			{
+				BioBloomClassifier classifier(filters, 0.15, prefix,
+						postfixes[p], 0, false, false);
+				classifier.setAssignOutput();
+				if (paired) {
+					classifier.filterPair("/tmp/assignMates1.fq",
+							"/tmp/assignMates2.fq");
+				} else {
+					classifier.filter(inputFiles);
+				}
+			}
+
+			if (!postfixes[p].empty()) {
+				vector<unsigned char> data = readFile(assignFile);
+				assert(data.size() > 2 && data[0] == 0x1f && data[1] == 0x8b);
+			}
+			//header lists filters in order, then multiMatch and noMatch
+			ifstream assign(assignFile.c_str());
+			string line;
+			getline(assign, line);
+			assert(line == "#filters\tA\tB\tmultiMatch\tnoMatch");
+			getline(assign, line);
+			assert(line == "#read_ordinal\tfilter_index");
+			unsigned lines = 0;
+			while (getline(assign, line)) {
+				++lines;
+			}
+			assert(lines == readNum);
+
+			for (unsigned c = 0; c < 4; ++c) {
+				string expected;
+				for (unsigned i = c; i < readNum; i += 4) {
+					if (paired) {
+						expected += fastqRecord(readID(i) + "/1",
+								readSeq(i, 0, sources));
+						expected += fastqRecord(readID(i) + "/2",
+								readSeq(i, 1, sources));
+					} else {
+						expected += fastqRecord(readID(i),
+								readSeq(i, 0, sources));
+					}
+				}
+				ReadExtractor extractor(assignFile, readCategory(c));
+				stringstream out;
+				size_t extracted = paired ?
+						extractor.extractPairs("/tmp/assignMates1.fq",
+								"/tmp/assignMates2.fq", out, false) :
+						extractor.extract(inputFiles, out, false);
+				assert(extracted == readNum / 4);
+				assert(out.str() == expected);
+			}
+			remove(assignFile.c_str());
+		}
+	}
+
+	remove(inputFiles[0].c_str());
+	remove(inputFiles[1].c_str());
+	remove("/tmp/assignMates1.fq");
+	remove("/tmp/assignMates2.fq");
+	remove((prefix + "_summary.tsv").c_str());
+	removeTestFilter("/tmp/assignA");
+	removeTestFilter("/tmp/assignB");
+	cout << "Assignment and extraction tests done" << endl;
+}
+
+//categories of the reads of readsFile, given by --assign
+vector<string> assignedCategories(const vector<string> &filters,
+		const vector<string> &subtractFilters, const string &readsFile)
+{
+	string prefix = "/tmp/subtractTest";
+	{
+		BioBloomClassifier classifier(filters, 0.15, prefix, "", 0, false,
+				false);
+		classifier.setSubtractFilters(subtractFilters);
+		classifier.setAssignOutput();
+		classifier.filter(vector<string>(1, readsFile));
+	}
+	string assignFile = prefix + "_assign.tsv";
+	ifstream assign(assignFile.c_str());
+	string line;
+	getline(assign, line);
+	stringstream header(line);
+	string field;
+	header >> field;
+	vector<string> names;
+	while (header >> field) {
+		names.push_back(field);
+	}
+	getline(assign, line);
+	vector<string> categories;
+	size_t ordinal;
+	unsigned index;
+	while (assign >> ordinal >> index) {
+		assert(ordinal == categories.size());
+		categories.push_back(names.at(index));
+	}
+	remove(assignFile.c_str());
+	remove((prefix + "_summary.tsv").c_str());
+	return categories;
+}
+
+//subtraction filters given to the classifier (see exitsWithError)
+struct SetSubtract {
+	const vector<string> &filters;
+	const vector<string> subtractFilters;
+	SetSubtract(const vector<string> &filters,
+			const vector<string> &subtractFilters) :
+			filters(filters), subtractFilters(subtractFilters)
+	{
+	}
+	void operator()() const
+	{
+		BioBloomClassifier classifier(filters, 0.15, "/tmp/subtractTest", "",
+				0, false, false);
+		classifier.setSubtractFilters(subtractFilters);
+	}
+};
+
+//k-mers of a subtraction filter are misses for the filters it is applied to,
+//all of them or only the one named in ID:FILTER.bf
+void subtractionTests()
+{
+	//sequence of A, B and the subtraction filter, and of A only
+	string shared = randomSeq(2000, 41);
+	string onlyA = randomSeq(2000, 42);
+	vector<string> seqs(1, shared);
+	storeTestFilter("/tmp/subtractS", "S", seqs);
+	storeTestFilter("/tmp/subtractB", "B", seqs);
+	seqs.push_back(onlyA);
+	storeTestFilter("/tmp/subtractA", "A", seqs);
+	vector<string> filters;
+	filters.push_back("/tmp/subtractA.bf");
+	filters.push_back("/tmp/subtractB.bf");
+
+	string readsFile = "/tmp/subtractReads.fq";
+	{
+		ofstream reads(readsFile.c_str());
+		for (unsigned i = 0; i < 10; ++i) {
+			reads << fastqRecord(readID(2 * i), shared.substr(i * 150, 100));
+			reads << fastqRecord(readID(2 * i + 1), onlyA.substr(i * 150, 100));
+		}
+	}
+
+	vector<string> subtract;
+	vector<string> categories = assignedCategories(filters, subtract,
+			readsFile);
+	assert(categories.size() == 20);
+	for (unsigned i = 0; i < 20; ++i) {
+		assert(categories[i] == (i % 2 == 0 ? "multiMatch" : "A"));
+	}
+
+	//applied to A only
+	subtract.push_back("A:/tmp/subtractS.bf");
+	categories = assignedCategories(filters, subtract, readsFile);
+	assert(categories.size() == 20);
+	for (unsigned i = 0; i < 20; ++i) {
+		assert(categories[i] == (i % 2 == 0 ? "B" : "A"));
+	}
+
+	//applied to every filter
+	subtract[0] = "/tmp/subtractS.bf";
+	categories = assignedCategories(filters, subtract, readsFile);
+	assert(categories.size() == 20);
+	for (unsigned i = 0; i < 20; ++i) {
+		assert(categories[i] == (i % 2 == 0 ? "noMatch" : "A"));
+	}
+
+	//k-mers of the subtraction filter must be hashed as the ones of the target
+	assert(!exitsWithError(SetSubtract(filters, subtract)));
+	storeTestFilter("/tmp/subtractS", "S", seqs, testKmerSize,
+			testHashNum + 1);
+	assert(exitsWithError(SetSubtract(filters, subtract)));
+	storeTestFilter("/tmp/subtractS", "S", seqs, testKmerSize - 4,
+			testHashNum);
+	assert(exitsWithError(SetSubtract(filters, subtract)));
+	subtract[0] = "A:/tmp/subtractS.bf";
+	assert(exitsWithError(SetSubtract(filters, subtract)));
+	//fewer hash functions are a subset of the ones of the target
+	storeTestFilter("/tmp/subtractS", "S", seqs, testKmerSize,
+			testHashNum - 1);
+	assert(!exitsWithError(SetSubtract(filters, subtract)));
+
+	remove(readsFile.c_str());
+	removeTestFilter("/tmp/subtractS");
+	removeTestFilter("/tmp/subtractA");
+	removeTestFilter("/tmp/subtractB");
+	cout << "Subtraction filter tests done" << endl;
+}
+
 int main(int argc, char **argv)
 {
+	readCacheTests();
+	assignExtractTests();
+	subtractionTests();
+
 	string filename = "test.txt.gz";
 
 	Dynamicofstream test(filename);
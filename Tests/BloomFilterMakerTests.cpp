@@ -16,10 +16,415 @@
 #include <vector>
 #include <fstream>
 #include "Common/ReadsProcessor.h"
+#include "BioBloomMaker/BloomFilterMerger.h"
+#include "BioBloomMaker/BloomFilterMerger.cpp"
+#include "BioBloomMaker/BloomFilterFolder.h"
+#include "BioBloomMaker/BloomFilterFolder.cpp"
+#include "BioBloomMaker/BuildCheckpoint.h"
+#include "TestHelpers.h"
+#include <sys/stat.h>
+#if _OPENMP
+# include <omp.h>
+#endif
 
 using namespace std;
 
+static const unsigned testKmerSize = 20;
+static const unsigned testHashNum = 3;
+
+//stores the bit array of a filter of the k-mers of a sequence
+void storeTestBits(const string &filename, const string &seq,
+		size_t filterSize) {
+	BloomFilter filter(filterSize, testHashNum, testKmerSize);
+	ReadsProcessor proc(testKmerSize);
+	for (size_t i = 0; i + testKmerSize <= seq.length(); ++i) {
+		filter.insert(proc.prepSeq(seq, i));
+	}
+	filter.storeFilter(filename);
+}
+
+//stores a filter of the k-mers of a sequence with its information file,
+//sized for the number of entries expected
+void storeTestFilter(const string &prefix, const string &seq,
+		size_t expectedNum) {
+	vector<string> seqSrcs(1, prefix + ".fa");
+	BloomFilterInfo info(prefix, testKmerSize, testHashNum, 0.02, expectedNum,
+			seqSrcs);
+	info.setTotalNum(seq.length() - testKmerSize + 1);
+	info.setRedundancy(0);
+	info.printInfoFile(prefix + ".txt");
+	storeTestBits(prefix + ".bf", seq, info.getCalcuatedFilterSize());
+}
+
+void removeTestFilter(const string &prefix) {
+	remove((prefix + ".bf").c_str());
+	remove((prefix + ".txt").c_str());
+}
+
+//the union of filters is the bitwise OR of their bits
+void mergerTests() {
+	size_t expectedNum = 1000000;
+	storeTestFilter("/tmp/mergeA", randomSeq(5000, 1), expectedNum);
+	storeTestFilter("/tmp/mergeB", randomSeq(5000, 2), expectedNum);
+	vector<unsigned char> a = readFile("/tmp/mergeA.bf");
+	vector<unsigned char> b = readFile("/tmp/mergeB.bf");
+	vector<string> files;
+	files.push_back("/tmp/mergeA.bf");
+	files.push_back("/tmp/mergeB.bf");
+
+	BloomFilterMerger merger(files);
+	merger.merge("/tmp/mergeUnion.bf");
+	vector<unsigned char> merged = readFile("/tmp/mergeUnion.bf");
+	assert(merged.size() == a.size());
+	for (size_t i = 0; i < merged.size(); ++i) {
+		assert(merged[i] == (a[i] | b[i]));
+	}
+	BloomFilterInfo info = merger.getMergedInfo("union");
+	assert(info.getTotalNum() == 2 * (5000 - testKmerSize + 1));
+
+	//output can be one of the inputs
+	BloomFilterMerger inPlace(files);
+	inPlace.merge("/tmp/mergeA.bf");
+	assert(readFile("/tmp/mergeA.bf") == merged);
+
+	remove("/tmp/mergeUnion.bf");
+	removeTestFilter("/tmp/mergeA");
+	removeTestFilter("/tmp/mergeB");
+	cout << "Merge Tests Done." << endl;
+}
+
+//merge of files (see exitsWithError)
+struct Merge {
+	const vector<string> &files;
+	BloomFilterMerger::Operation operation;
+	const string filename;
+	Merge(const vector<string> &files, BloomFilterMerger::Operation operation,
+			const string &filename) :
+			files(files), operation(operation), filename(filename) {
+	}
+	void operator()() const {
+		BloomFilterMerger merger(files, operation);
+		merger.merge(filename);
+	}
+};
+
+//intersection is the bitwise AND, difference the AND NOT of the bits
+void mergeOperationTests() {
+	size_t expectedNum = 1000000;
+	storeTestFilter("/tmp/mergeA", randomSeq(5000, 1), expectedNum);
+	storeTestFilter("/tmp/mergeB", randomSeq(5000, 2), expectedNum);
+	vector<unsigned char> a = readFile("/tmp/mergeA.bf");
+	vector<unsigned char> b = readFile("/tmp/mergeB.bf");
+	vector<string> files;
+	files.push_back("/tmp/mergeA.bf");
+	files.push_back("/tmp/mergeB.bf");
+
+	BloomFilterMerger intersection(files, BloomFilterMerger::INTERSECTION);
+	intersection.merge("/tmp/mergeOut.bf");
+	vector<unsigned char> merged = readFile("/tmp/mergeOut.bf");
+	assert(merged.size() == a.size());
+	for (size_t i = 0; i < merged.size(); ++i) {
+		assert(merged[i] == (a[i] & b[i]));
+	}
+
+	//sparse filters share few bits, so little is lost
+	BloomFilterMerger difference(files, BloomFilterMerger::DIFFERENCE);
+	difference.merge("/tmp/mergeOut.bf");
+	merged = readFile("/tmp/mergeOut.bf");
+	assert(merged.size() == a.size());
+	for (size_t i = 0; i < merged.size(); ++i) {
+		assert(merged[i] == (a[i] & ~b[i]));
+	}
+	remove("/tmp/mergeOut.bf");
+
+	//dense filters share most bits, so the difference is refused unless forced
+	storeTestFilter("/tmp/mergeA", randomSeq(5000, 1), 500);
+	storeTestFilter("/tmp/mergeB", randomSeq(5000, 2), 500);
+	assert(exitsWithError(
+			Merge(files, BloomFilterMerger::DIFFERENCE, "/tmp/mergeOut.bf")));
+	assert(readFile("/tmp/mergeOut.bf").empty());
+	a = readFile("/tmp/mergeA.bf");
+	b = readFile("/tmp/mergeB.bf");
+	BloomFilterMerger forced(files, BloomFilterMerger::DIFFERENCE);
+	forced.setForce(true);
+	forced.merge("/tmp/mergeOut.bf");
+	merged = readFile("/tmp/mergeOut.bf");
+	assert(merged.size() == a.size());
+	for (size_t i = 0; i < merged.size(); ++i) {
+		assert(merged[i] == (a[i] & ~b[i]));
+	}
+
+	remove("/tmp/mergeOut.bf");
+	removeTestFilter("/tmp/mergeA");
+	removeTestFilter("/tmp/mergeB");
+	cout << "Merge Operation Tests Done." << endl;
+}
+
+//folding gives the filter that would have been built at the smaller size
+void folderTests() {
+	string seq = randomSeq(5000, 3);
+	storeTestFilter("/tmp/fold", seq, 1000000);
+	size_t filterSize = BloomFilterInfo("/tmp/fold.txt").getCalcuatedFilterSize();
+	storeTestBits("/tmp/foldHalf.bf", seq, filterSize / 2);
+	storeTestBits("/tmp/foldQuarter.bf", seq, filterSize / 4);
+	vector<unsigned char> half = readFile("/tmp/foldHalf.bf");
+	vector<unsigned char> quarter = readFile("/tmp/foldQuarter.bf");
+
+	BloomFilterFolder folder("/tmp/fold.bf", 1);
+	folder.fold("/tmp/foldOut.bf");
+	assert(readFile("/tmp/foldOut.bf") == half);
+	BloomFilterInfo info = folder.getFoldedInfo("folded");
+	assert(info.getCalcuatedFilterSize() == filterSize / 2);
+	assert(info.getTotalNum() == 5000 - testKmerSize + 1);
+
+	BloomFilterFolder twice("/tmp/fold.bf", 2);
+	twice.fold("/tmp/foldOut.bf");
+	assert(readFile("/tmp/foldOut.bf") == quarter);
+
+	//output can be the input
+	BloomFilterFolder inPlace("/tmp/fold.bf", 1);
+	inPlace.fold("/tmp/fold.bf");
+	assert(readFile("/tmp/fold.bf") == half);
+
+	remove("/tmp/foldOut.bf");
+	remove("/tmp/foldHalf.bf");
+	remove("/tmp/foldQuarter.bf");
+	removeTestFilter("/tmp/fold");
+	cout << "Fold Tests Done." << endl;
+}
+
+//writes sequences to an indexed fasta file, one line per sequence
+void writeIndexedFasta(const string &fileName, const vector<string> &seqs) {
+	ofstream fasta(fileName.c_str());
+	ofstream index((fileName + ".fai").c_str());
+	for (unsigned i = 0; i < seqs.size(); ++i) {
+		fasta << ">seq" << i << "\n";
+		index << "seq" << i << "\t" << seqs[i].length() << "\t"
+				<< fasta.tellp() << "\t" << seqs[i].length() << "\t"
+				<< seqs[i].length() + 1 << "\n";
+		fasta << seqs[i] << "\n";
+	}
+}
+
+//writes pairs of reads taken at random positions of genome, the positions
+//are the same for every call so shorter files hold the first pairs
+void writeReadPairs(const string &file1, const string &file2,
+		const string &genome, size_t pairNum) {
+	ofstream reads1(file1.c_str());
+	ofstream reads2(file2.c_str());
+	string qual(100, 'I');
+	unsigned seed = 17;
+	for (size_t i = 0; i < pairNum; ++i) {
+		size_t pos = nextRandom(seed) * 4 % (genome.length() - 300);
+		reads1 << "@read" << i << "/1\n" << genome.substr(pos, 100) << "\n+\n"
+				<< qual << "\n";
+		reads2 << "@read" << i << "/2\n" << genome.substr(pos + 200, 100)
+				<< "\n+\n" << qual << "\n";
+	}
+}
+
+static const size_t progFilterSize = 1 << 22;
+
+//filter of a build, with its entries and redundancy
+struct TestBuild {
+	vector<unsigned char> bits;
+	size_t totalEntries;
+	size_t redundancy;
+	bool operator==(const TestBuild &other) const {
+		return bits == other.bits && totalEntries == other.totalEntries
+				&& redundancy == other.redundancy;
+	}
+};
+
+//filter of the sequences of fasta, resumed from the checkpoint of
+//resumePrefix if it is not empty
+TestBuild buildSequences(const string &fasta, const string &resumePrefix) {
+	vector<string> files(1, fasta);
+	BloomFilterGenerator filterGen(files, testKmerSize, testHashNum, 1000000);
+	filterGen.setFilterSize(progFilterSize);
+	if (!resumePrefix.empty()) {
+		filterGen.setCheckpoint(resumePrefix, 0, true);
+	}
+	TestBuild build;
+	build.redundancy = filterGen.generate("/tmp/progOut.bf");
+	build.totalEntries = filterGen.getTotalEntries();
+	build.bits = readFile("/tmp/progOut.bf");
+	remove("/tmp/progOut.bf");
+	return build;
+}
+
+//filter of seed sequences extended by reads, in deterministic mode
+TestBuild buildProgressive(const string &fasta, const string &file1,
+		const string &file2, size_t expectedNum, unsigned threads,
+		const string &resumePrefix) {
+#if _OPENMP
+	omp_set_num_threads(threads);
+#endif
+	vector<string> files(1, fasta);
+	BloomFilterGenerator filterGen(files, testKmerSize, testHashNum,
+			expectedNum);
+	filterGen.setFilterSize(progFilterSize);
+	filterGen.setDeterministic(true);
+	if (!resumePrefix.empty()) {
+		filterGen.setCheckpoint(resumePrefix, 0, true);
+	}
+	TestBuild build;
+	build.redundancy = filterGen.generateProgressive("/tmp/progOut.bf", 0.15,
+			file1, file2, PROG_INC);
+	build.totalEntries = filterGen.getTotalEntries();
+	build.bits = readFile("/tmp/progOut.bf");
+	remove("/tmp/progOut.bf");
+	return build;
+}
+
+//genome, with seed sequences in /tmp/prog.fa and 10000 pairs of reads in
+///tmp/prog_1.fq and /tmp/prog_2.fq
+string writeBuildInput() {
+	string genome = randomSeq(100000, 21);
+	vector<string> seqs;
+	seqs.push_back(genome.substr(0, 3000));
+	seqs.push_back(genome.substr(60000, 3000));
+	writeIndexedFasta("/tmp/prog.fa", seqs);
+	//more than one batch of pairs
+	writeReadPairs("/tmp/prog_1.fq", "/tmp/prog_2.fq", genome, 10000);
+	return genome;
+}
+
+void removeBuildInput() {
+	remove("/tmp/prog.fa");
+	remove("/tmp/prog.fa.fai");
+	remove("/tmp/prog_1.fq");
+	remove("/tmp/prog_2.fq");
+}
+
+//deterministic progressive filters do not depend on the number of threads,
+//also when the k-mer threshold stops the build
+void deterministicTests() {
+	writeBuildInput();
+	TestBuild single = buildProgressive("/tmp/prog.fa", "/tmp/prog_1.fq",
+			"/tmp/prog_2.fq", 1000000, 1, "");
+	//reads extend the filter past the seed sequences
+	size_t seedEntries = 2 * (3000 - testKmerSize + 1);
+	assert(single.totalEntries > seedEntries + 1000);
+	assert(buildProgressive("/tmp/prog.fa", "/tmp/prog_1.fq",
+			"/tmp/prog_2.fq", 1000000, 4, "") == single);
+
+	//reached while reads are inserted
+	size_t threshold = (seedEntries + single.totalEntries) / 2;
+	TestBuild stopped = buildProgressive("/tmp/prog.fa", "/tmp/prog_1.fq",
+			"/tmp/prog_2.fq", threshold, 1, "");
+	assert(stopped.totalEntries >= threshold);
+	assert(stopped.totalEntries < single.totalEntries);
+	assert(buildProgressive("/tmp/prog.fa", "/tmp/prog_1.fq",
+			"/tmp/prog_2.fq", threshold, 4, "") == stopped);
+
+	removeBuildInput();
+	cout << "Deterministic Build Tests Done." << endl;
+}
+
+//saves the filter of a partial build as the next checkpoint of prefix, as
+//the build would once sequencesDone and readPairsDone were inserted, and
+//completes the build if finish
+void saveCheckpoint(const string &prefix, const TestBuild &partial,
+		size_t sequencesDone, size_t readPairsDone, bool finish) {
+	writeFile("/tmp/progPartial.bf", partial.bits);
+	BloomFilter filter(progFilterSize, testHashNum, testKmerSize,
+			"/tmp/progPartial.bf");
+	remove("/tmp/progPartial.bf");
+	BuildCheckpoint checkpoint(prefix, 0, progFilterSize, testHashNum,
+			testKmerSize);
+	checkpoint.load();
+	BuildCheckpoint::State state = { sequencesDone, readPairsDone,
+			partial.totalEntries, partial.redundancy };
+	checkpoint.save(filter, state);
+	if (finish) {
+		checkpoint.finish();
+	}
+	//otherwise the checkpoint is written once it is destroyed
+}
+
+bool fileExists(const string &path) {
+	return access(path.c_str(), F_OK) == 0;
+}
+
+//builds resumed from a checkpoint are the same as uninterrupted builds, and
+//checkpoints that could not be written do not replace the previous one
+void checkpointTests() {
+	string genome = writeBuildInput();
+	//pairs of a batch of the generator
+	size_t batchSize = 4096;
+	string prefix = "/tmp/progCkpt";
+	string statePath = prefix + ".ckpt.txt";
+
+	//multiple sequences, interrupted after the first one
+	vector<string> first(1, genome.substr(0, 3000));
+	writeIndexedFasta("/tmp/progFirst.fa", first);
+	TestBuild full = buildSequences("/tmp/prog.fa", "");
+	saveCheckpoint(prefix, buildSequences("/tmp/progFirst.fa", ""), 1, 0,
+			false);
+	assert(fileExists(statePath));
+	assert(buildSequences("/tmp/prog.fa", prefix) == full);
+	//files are removed once the build is complete
+	assert(!fileExists(statePath));
+	assert(!fileExists(prefix + ".ckpt.1.bf"));
+
+	//progressive build, interrupted after the first batch of pairs
+	writeReadPairs("/tmp/progFirst_1.fq", "/tmp/progFirst_2.fq", genome,
+			batchSize);
+	full = buildProgressive("/tmp/prog.fa", "/tmp/prog_1.fq",
+			"/tmp/prog_2.fq", 1000000, 4, "");
+	TestBuild partial = buildProgressive("/tmp/prog.fa", "/tmp/progFirst_1.fq",
+			"/tmp/progFirst_2.fq", 1000000, 4, "");
+	assert(!(partial == full));
+	saveCheckpoint(prefix, partial, 2, batchSize, false);
+	assert(buildProgressive("/tmp/prog.fa", "/tmp/prog_1.fq",
+			"/tmp/prog_2.fq", 1000000, 4, prefix) == full);
+
+	//a checkpoint that cannot be written (its filter path is a directory)
+	//leaves the previous one in place
+	saveCheckpoint(prefix, partial, 2, batchSize, false);
+	string failedPath = prefix + ".ckpt.2.bf";
+	assert(mkdir(failedPath.c_str(), 0755) == 0);
+	saveCheckpoint(prefix, full, 2, 10000, false);
+	{
+		BuildCheckpoint checkpoint(prefix, 0, progFilterSize, testHashNum,
+				testKmerSize);
+		assert(checkpoint.load());
+		assert(checkpoint.getFilterPath() == prefix + ".ckpt.1.bf");
+		assert(checkpoint.getState().readPairsDone
+				== batchSize);
+		assert(fileExists(checkpoint.getFilterPath()));
+	}
+	//and the build goes on with the previous checkpoint, whose files are
+	//removed when it is complete
+	assert(buildProgressive("/tmp/prog.fa", "/tmp/prog_1.fq",
+			"/tmp/prog_2.fq", 1000000, 4, prefix) == full);
+	assert(!fileExists(statePath));
+	assert(!fileExists(prefix + ".ckpt.1.bf"));
+	assert(fileExists(failedPath));
+
+	//completing a build removes the files of the previous checkpoint too
+	saveCheckpoint(prefix, partial, 2, batchSize, false);
+	saveCheckpoint(prefix, full, 2, 10000, true);
+	assert(!fileExists(statePath));
+	assert(!fileExists(prefix + ".ckpt.1.bf"));
+	assert(fileExists(failedPath));
+
+	rmdir(failedPath.c_str());
+	remove("/tmp/progFirst.fa");
+	remove("/tmp/progFirst.fa.fai");
+	remove("/tmp/progFirst_1.fq");
+	remove("/tmp/progFirst_2.fq");
+	removeBuildInput();
+	cout << "Checkpoint Tests Done." << endl;
+}
+
 int main(int argc, char **argv) {
+	mergerTests();
+	mergeOperationTests();
+	folderTests();
+	deterministicTests();
+	checkpointTests();
 
 	//Load some testdata
 	string fileName = "ecoli.fasta";
@@ -12,7 +12,17 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <cmath>
 #include "Common/ReadsProcessor.h"
+#include "Common/BloomFilterFile.h"
+#include "Common/BloomFilterInfo.h"
+#include "Common/HyperLogLog.h"
+#include "Common/CountingBloomFilter.h"
+#include "Common/SeqEval.h"
+#include <cstdio>
+#include <algorithm>
+#include <fcntl.h>
+#include "TestHelpers.h"
 #if _OPENMP
 # include <omp.h>
 #endif
@@ -37,6 +47,446 @@ int memory_usage() {
 	return mem;
 }
 
+//copy of a file with the byte at offset changed
+void writeCorrupt(const string &path, const string &copyPath, size_t offset) {
+	vector<unsigned char> data = readFile(path);
+	assert(offset < data.size());
+	data[offset] ^= 0x5A;
+	writeFile(copyPath, data);
+}
+
+//loading of a single file filter, information and bit array (see
+//exitsWithError)
+struct LoadFilter {
+	const string path;
+	size_t sizeInBytes;
+	LoadFilter(const string &path, size_t sizeInBytes) :
+			path(path), sizeInBytes(sizeInBytes) {
+	}
+	void operator()() const {
+		BloomFilterFile file(path);
+		vector<unsigned char> data(sizeInBytes);
+		file.readPayload(&data[0], sizeInBytes);
+	}
+};
+
+//distinct k-mers are estimated within a few percent, also when sketches of
+//separate streams are merged
+void hyperLogLogTests() {
+	HyperLogLog all;
+	HyperLogLog first;
+	HyperLogLog second;
+	size_t distinct = 200000;
+	for (size_t i = 0; i < distinct; ++i) {
+		uint64_t hash = CityHash64(reinterpret_cast<const char*>(&i),
+				sizeof(i));
+		//each element is added several times
+		for (unsigned j = 0; j < 3; ++j) {
+			all.add(hash);
+		}
+		if (i % 2 == 0) {
+			first.add(hash);
+		} else {
+			second.add(hash);
+		}
+	}
+	double error = fabs(double(all.estimate()) - distinct) / distinct;
+	assert(error < 0.03);
+	first.merge(second);
+	assert(first.estimate() == all.estimate());
+
+	//small cardinalities
+	HyperLogLog few;
+	for (size_t i = 0; i < 100; ++i) {
+		few.add(CityHash64(reinterpret_cast<const char*>(&i), sizeof(i)));
+	}
+	assert(few.estimate() >= 97 && few.estimate() <= 103);
+	cout << "hyperloglog tests done" << endl;
+}
+
+//counts are never underestimated, saturate and survive storage
+void countingFilterTests() {
+	size_t size = 1 << 20;
+	unsigned hashNum = 3;
+	unsigned kmerSize = 20;
+	CountingBloomFilter counts(size, hashNum);
+	ReadsProcessor proc(kmerSize);
+	vector<size_t> once = multiHash(proc.prepSeq("ATCGGGTCATCAACCAATAT", 0),
+			hashNum, kmerSize);
+	vector<size_t> five = multiHash(proc.prepSeq("ATCGGGTCATCAACCAATAC", 0),
+			hashNum, kmerSize);
+	vector<size_t> many = multiHash(proc.prepSeq("ATCGGGTCATCAACCAATAG", 0),
+			hashNum, kmerSize);
+	vector<size_t> none = multiHash(proc.prepSeq("ATCGGGTCATCAACCAATAA", 0),
+			hashNum, kmerSize);
+	assert(counts.insert(once) == 1);
+	for (unsigned i = 0; i < 5; ++i) {
+		counts.insert(five);
+	}
+	for (unsigned i = 0; i < 1000; ++i) {
+		counts.insert(many);
+	}
+	assert(counts.count(once) == 1);
+	assert(counts.count(five) == 5);
+	assert(counts.count(many) == CountingBloomFilter::s_maxCount);
+	assert(counts.count(none) == 0);
+
+	string filename = "/tmp/countingFilter.counts";
+	counts.storeFilter(filename);
+	CountingBloomFilter loaded(size, hashNum, filename);
+	assert(loaded.count(once) == 1);
+	assert(loaded.count(five) == 5);
+	assert(loaded.count(many) == CountingBloomFilter::s_maxCount);
+	assert(loaded.count(none) == 0);
+	remove(filename.c_str());
+
+	//repeat mask holds the k-mers counted more than a given number of times
+	BloomFilter mask(size, hashNum, kmerSize);
+	loaded.maskAbove(4, mask);
+	assert(!mask.contains(once));
+	assert(mask.contains(five));
+	assert(mask.contains(many));
+	assert(!mask.contains(none));
+	cout << "counting filter tests done" << endl;
+}
+
+//single file filters hold the information of the filter and its bits
+void singleFileTests() {
+	unsigned kmerSize = 20;
+	string seq = "ATCGGGTCATCAACCAATATCGGGATCGATCGATCGGCTAGCTAGCTAGGATCCA";
+	size_t kmerNum = seq.length() - kmerSize + 1;
+	vector<string> seqSrcs(1, "test.fa");
+	//sized for several blocks, the last one partial
+	BloomFilterInfo info("singleFile", kmerSize, 5, 0.02, 2500000, seqSrcs);
+	info.setTotalNum(kmerNum);
+	size_t filterSize = info.getCalcuatedFilterSize();
+	size_t sizeInBytes = filterSize / 8;
+	assert(sizeInBytes > 2 * (1 << 20) && sizeInBytes % (1 << 20) != 0);
+	BloomFilter filter(filterSize, 5, kmerSize);
+	ReadsProcessor proc(kmerSize);
+	for (size_t i = 0; i < kmerNum; ++i) {
+		filter.insert(proc.prepSeq(seq, i));
+	}
+
+	string filename = "/tmp/singleFileFilter.bf";
+	filter.storeFilter(filename);
+	assert(!BloomFilterFile::isSingleFile(filename));
+	BloomFilterFile::store(filename, info, false);
+	assert(BloomFilterFile::isSingleFile(filename));
+
+	//information is read back from the filter file
+	{
+		BloomFilterFile file(filename);
+		assert(file.isSingleFile());
+		assert(!file.isCompressed());
+		stringstream expected;
+		stringstream actual;
+		info.printInfo(expected);
+		file.getInfo().printInfo(actual);
+		assert(expected.str() == actual.str());
+	}
+
+	BloomFilter loaded(filterSize, 5, kmerSize, filename);
+	for (size_t i = 0; i < kmerNum; ++i) {
+		assert(loaded.contains(proc.prepSeq(seq, i)));
+	}
+	assert(!loaded.contains(proc.prepSeq("ATCGGGTCATCAACCAATTA", 0)));
+	assert(!exitsWithError(LoadFilter(filename, sizeInBytes)));
+
+	//damaged files are rejected
+	string damaged = "/tmp/singleFileFilterDamaged.bf";
+	size_t fileSize = readFile(filename).size();
+	//k-mer size in header
+	writeCorrupt(filename, damaged, 16);
+	assert(exitsWithError(LoadFilter(damaged, sizeInBytes)));
+	//first block checksum, right after header
+	writeCorrupt(filename, damaged, 100);
+	assert(exitsWithError(LoadFilter(damaged, sizeInBytes)));
+	//bit array of the second block
+	writeCorrupt(filename, damaged, fileSize - sizeInBytes + (1 << 20) + 10);
+	assert(exitsWithError(LoadFilter(damaged, sizeInBytes)));
+	//truncated bit array
+	vector<unsigned char> data = readFile(filename);
+	data.resize(fileSize - 4096);
+	writeFile(damaged, data);
+	assert(exitsWithError(LoadFilter(damaged, sizeInBytes)));
+
+	remove(damaged.c_str());
+	remove(filename.c_str());
+	cout << "single file filter tests done" << endl;
+}
+
+//sparse blocks of compressed filters are deflated, others are stored as is
+void compressedFileTests() {
+	vector<string> seqSrcs(1, "test.fa");
+	BloomFilterInfo info("compressed", 20, 5, 0.02, 3100000, seqSrcs);
+	info.setTotalNum(100000);
+	//dense, sparse, dense and partial sparse blocks of 1 MiB
+	size_t blockSize = 1 << 20;
+	size_t sizeInBytes = info.getCalcuatedFilterSize() / 8;
+	assert(sizeInBytes > 3 * blockSize + 5000 && sizeInBytes < 4 * blockSize);
+	vector<unsigned char> data(sizeInBytes, 0);
+	unsigned seed = 1;
+	for (size_t i = 0; i < sizeInBytes; ++i) {
+		unsigned value = nextRandom(seed);
+		if ((i / blockSize) % 2 == 0) {
+			data[i] = value & 0xFF;
+		} else if (i % 97 == 0) {
+			data[i] = 1 << (value % 8);
+		}
+	}
+
+	string filename = "/tmp/compressedFilter.bf";
+	writeFile(filename, data);
+	BloomFilterFile::store(filename, info, true);
+	//only the sparse blocks got smaller
+	size_t fileSize = readFile(filename).size();
+	assert(fileSize > 2 * blockSize);
+	assert(fileSize < 3 * blockSize);
+
+	{
+		BloomFilterFile file(filename);
+		assert(file.isSingleFile());
+		assert(file.isCompressed());
+		vector<unsigned char> loaded(sizeInBytes);
+		file.readPayload(&loaded[0], sizeInBytes);
+		assert(loaded == data);
+
+		//ranges spanning stored and deflated blocks, and the end of the
+		//partial last block
+		int fd = open(filename.c_str(), O_RDONLY);
+		assert(fd != -1);
+		vector<unsigned char> part(blockSize + 1000);
+		file.readBlocks(fd, &part[0], blockSize - 500, part.size());
+		assert(equal(part.begin(), part.end(), data.begin() + blockSize - 500));
+		file.readBlocks(fd, &part[0], sizeInBytes - 5000, 5000);
+		assert(equal(part.begin(), part.begin() + 5000,
+				data.end() - 5000));
+		close(fd);
+	}
+	assert(!exitsWithError(LoadFilter(filename, sizeInBytes)));
+
+	//damaged deflated block is rejected
+	string damaged = "/tmp/compressedFilterDamaged.bf";
+	writeCorrupt(filename, damaged, fileSize - 10);
+	assert(exitsWithError(LoadFilter(damaged, sizeInBytes)));
+
+	remove(damaged.c_str());
+	remove(filename.c_str());
+	cout << "compressed filter tests done" << endl;
+}
+
+//filter of the k-mers at the positions of seq marked in hitPattern
+BloomFilter *patternFilter(const string &seq, const string &hitPattern,
+		unsigned kmerSize) {
+	BloomFilter *filter = new BloomFilter(1 << 20, 3, kmerSize);
+	ReadsProcessor proc(kmerSize);
+	for (size_t i = 0; i < hitPattern.length(); ++i) {
+		if (hitPattern[i] == '1') {
+			filter->insert(proc.prepSeq(seq, i));
+		}
+	}
+	//no other k-mer of seq may be a hit
+	for (size_t i = 0; i < hitPattern.length(); ++i) {
+		assert(filter->contains(proc.prepSeq(seq, i)) == (hitPattern[i] == '1'));
+	}
+	return filter;
+}
+
+//score of exhaustive evaluation against hand-computed streak scores
+void seqEvalTests() {
+	unsigned kmerSize = 8;
+	string seq = randomSeq(27, 5);
+	FastqRecord rec;
+	rec.seq = seq;
+	//20 k-mers
+	BloomFilter *filter = patternFilter(seq, "11100110000011010011", kmerSize);
+	SeqEval::FilterProbe<BloomFilter> probe(*filter);
+	double maxScore = numeric_limits<double>::max();
+
+	//the first hit of a streak scores 0.5, later hits 1
+	//the miss after a streak of streakThreshold hits skips a k-mer length,
+	//passing over k-mers 4-10 (hits at 5 and 6):
+	//0.5 + 1 + 1 (0-2), 0.5 + 1 (12-13), 0.5 (15), 0.5 + 1 (18-19)
+	opt::streakThreshold = 3;
+	{
+		SeqEval::NoHashCache cache(seq, kmerSize);
+		unsigned currentLoc = 0;
+		double score = 0;
+		assert(!SeqEval::evalCore(seq.length(), kmerSize, probe, cache,
+				maxScore, maxScore, currentLoc, score));
+		assert(score == 6.0);
+
+		//stepwise evaluation reaches the same score, within its bounds
+		SeqEval::ExhaustEval<SeqEval::FilterProbe<BloomFilter>,
+				SeqEval::NoHashCache> eval(seq.length(), kmerSize, probe, cache);
+		assert(eval.getKmerCount() == 20);
+		assert(eval.getMaxScore() == 19.5);
+		double lastMax = eval.getMaxScore();
+		while (eval.step()) {
+			assert(eval.getScore() <= eval.getMaxScore());
+			assert(eval.getMaxScore() <= lastMax);
+			lastMax = eval.getMaxScore();
+		}
+		assert(eval.getScore() == 6.0);
+		assert(eval.getMaxScore() == 6.0);
+	}
+
+	//without skipping, hits at 5-6 count: 0.5 + 1 more
+	opt::streakThreshold = 100;
+	{
+		SeqEval::NoHashCache cache(seq, kmerSize);
+		unsigned currentLoc = 0;
+		double score = 0;
+		SeqEval::evalCore(seq.length(), kmerSize, probe, cache, maxScore,
+				maxScore, currentLoc, score);
+		assert(score == 7.5);
+	}
+
+	//evaluation stops at the threshold, and can be continued from there
+	//(a new streak, so k-mers 4-10 are not skipped)
+	opt::streakThreshold = 3;
+	{
+		SeqEval::NoHashCache cache(seq, kmerSize);
+		unsigned currentLoc = 0;
+		double score = 0;
+		assert(SeqEval::evalCore(seq.length(), kmerSize, probe, cache, 2.5,
+				maxScore, currentLoc, score));
+		assert(score == 2.5 && currentLoc == 3);
+		assert(!SeqEval::evalCore(seq.length(), kmerSize, probe, cache,
+				maxScore, maxScore, currentLoc, score));
+		assert(score == 7.5);
+	}
+
+	//k-mers in the subtraction filter are misses: 0.5 (12) instead of
+	//0.5 + 1 (12-13)
+	BloomFilter *subtract = patternFilter(seq, "00000000000001000000",
+			kmerSize);
+	{
+		SeqEval::NoHashCache cache(seq, kmerSize);
+		unsigned currentLoc = 0;
+		double score = 0;
+		SeqEval::evalCore(seq.length(), kmerSize,
+				SeqEval::SubtractProbe<BloomFilter>(*filter, subtract), cache,
+				maxScore, maxScore, currentLoc, score);
+		assert(score == 5.0);
+	}
+
+	//screening counts hits of non-overlapping k-mers (1, 9 and 17 here)
+	{
+		SeqEval::NoHashCache cache(seq, kmerSize);
+		assert(SeqEval::screenCore(seq.length(), kmerSize, probe, cache, 10)
+				== 1);
+		filter->insert(ReadsProcessor(kmerSize).prepSeq(seq, 17));
+		assert(SeqEval::screenCore(seq.length(), kmerSize, probe, cache, 10)
+				== 2);
+		assert(SeqEval::screenCore(seq.length(), kmerSize, probe, cache, 1)
+				== 1);
+	}
+
+	delete filter;
+	delete subtract;
+	cout << "sequence evaluation tests done" << endl;
+}
+
+typedef SeqEval::ExhaustEval<SeqEval::FilterProbe<BloomFilter>,
+		SeqEval::NoHashCache> TestEval;
+
+//best hits of seq among filters of k-mers of the given sizes
+double bestHits(const string &seq, const vector<BloomFilter*> &filters,
+		const vector<unsigned> &kmerSizes, bool prune, vector<bool> &best) {
+	vector<boost::shared_ptr<SeqEval::NoHashCache> > caches;
+	vector<TestEval> evals;
+	for (unsigned i = 0; i < filters.size(); ++i) {
+		caches.push_back(boost::shared_ptr<SeqEval::NoHashCache>(
+				new SeqEval::NoHashCache(seq, kmerSizes[i])));
+		evals.push_back(TestEval(seq.length(), kmerSizes[i],
+				SeqEval::FilterProbe<BloomFilter>(*filters[i]), *caches[i]));
+	}
+	return SeqEval::bestHit(evals, best, prune);
+}
+
+//filter of a random part of the k-mers of seq
+BloomFilter *randomFilter(const string &seq, unsigned kmerSize,
+		unsigned &seed) {
+	unsigned density = nextRandom(seed) % 100;
+	string pattern(seq.length() - kmerSize + 1, '0');
+	for (size_t i = 0; i < pattern.length(); ++i) {
+		if (nextRandom(seed) % 100 < density) {
+			pattern[i] = '1';
+		}
+	}
+	return patternFilter(seq, pattern, kmerSize);
+}
+
+//pruning filters that cannot reach the leader does not change the best hits,
+//also of filters with different k-mer sizes and ties
+void bestHitTests() {
+	opt::streakThreshold = 3;
+	vector<unsigned> kmerSizes;
+	kmerSizes.push_back(15);
+	kmerSizes.push_back(15);
+	kmerSizes.push_back(20);
+	kmerSizes.push_back(20);
+	unsigned seed = 7;
+	for (unsigned read = 0; read < 200; ++read) {
+		string seq = randomSeq(100, 1000 + read);
+		vector<BloomFilter*> filters;
+		for (unsigned i = 0; i < kmerSizes.size(); ++i) {
+			filters.push_back(randomFilter(seq, kmerSizes[i], seed));
+		}
+		vector<bool> pruned;
+		vector<bool> exhaustive;
+		assert(bestHits(seq, filters, kmerSizes, true, pruned)
+				== bestHits(seq, filters, kmerSizes, false, exhaustive));
+		assert(pruned == exhaustive);
+		for (unsigned i = 0; i < filters.size(); ++i) {
+			delete filters[i];
+		}
+	}
+
+	string seq = randomSeq(100, 3);
+	string all15(100 - 15 + 1, '1');
+	string all20(100 - 20 + 1, '1');
+	string half15 = all15;
+	for (size_t i = 0; i < half15.length(); i += 2) {
+		half15[i] = '0';
+	}
+	vector<BloomFilter*> filters;
+	vector<unsigned> sizes;
+	filters.push_back(patternFilter(seq, half15, 15));
+	sizes.push_back(15);
+	filters.push_back(patternFilter(seq, all20, 20));
+	sizes.push_back(20);
+	filters.push_back(patternFilter(seq, all15, 15));
+	sizes.push_back(15);
+	BloomFilter empty(1 << 20, 3, 15);
+	vector<BloomFilter*> none(1, &empty);
+	for (unsigned prune = 0; prune < 2; ++prune) {
+		vector<bool> best;
+		//a hit at every k-mer scores (0.5 + 85) / 86 for k 15, more than
+		//(0.5 + 80) / 81 for k 20
+		assert(bestHits(seq, filters, sizes, prune, best) == 85.5 / 86);
+		assert(!best[0] && !best[1] && best[2]);
+
+		//identical filters are both best hits (i.e. multiMatch)
+		filters.push_back(filters.back());
+		sizes.push_back(15);
+		assert(bestHits(seq, filters, sizes, prune, best) == 85.5 / 86);
+		assert(!best[0] && !best[1] && best[2] && best[3]);
+		filters.pop_back();
+		sizes.pop_back();
+
+		//no hits, no best hit
+		assert(bestHits(seq, none, sizes, prune, best) == 0);
+		assert(best.size() == 1 && !best[0]);
+	}
+	for (unsigned i = 0; i < filters.size(); ++i) {
+		delete filters[i];
+	}
+	cout << "best hit tests done" << endl;
+}
+
 int main(int argc, char **argv) {
 	//memory usage from before
 	int memUsage = memory_usage();
@@ -118,6 +568,13 @@ int main(int argc, char **argv) {
 
 	remove(filename.c_str());
 
+	hyperLogLogTests();
+	countingFilterTests();
+	singleFileTests();
+	compressedFileTests();
+	seqEvalTests();
+	bestHitTests();
+
 //	//check parallelized code speed
 //	cout << "testing code parallelization" << endl;
 //	double start_s = omp_get_wtime();
@@ -6,15 +6,160 @@
  */
 
 #include "Common/ReadsProcessor.h"
+#include "Common/MinimizerSampler.h"
+#include "Common/BloomFilterInfo.h"
 #include <assert.h>
 #include <string>
+#include <set>
+#include <sstream>
 #include <iostream>
 #include "Common/city.h"
 #include <stdio.h>
 #include <string.h>
+#include "TestHelpers.h"
 
 using namespace std;
 
+//minimizers of a sequence, in the format of prepSeq
+set<string> getMinimizers(unsigned kmerSize, unsigned window,
+		const string &seq) {
+	ReadsProcessor proc(kmerSize);
+	MinimizerSampler sampler(kmerSize, window);
+	sampler.reset();
+	set<string> minimizers;
+	for (size_t i = 0; i + kmerSize <= seq.length(); ++i) {
+		if (sampler.add(proc.prepSeq(seq, i))) {
+			minimizers.insert(
+					string(reinterpret_cast<const char*>(sampler.getMinimizer()),
+							(kmerSize + 3) / 4));
+		}
+	}
+	return minimizers;
+}
+
+//other bases (e.g. N) are kept
+string reverseComplement(const string &seq) {
+	string reverse(seq.rbegin(), seq.rend());
+	for (size_t i = 0; i < reverse.length(); ++i) {
+		switch (reverse[i]) {
+		case 'A': reverse[i] = 'T'; break;
+		case 'C': reverse[i] = 'G'; break;
+		case 'G': reverse[i] = 'C'; break;
+		case 'T': reverse[i] = 'A'; break;
+		}
+	}
+	return reverse;
+}
+
+//both strands of a sequence select the same k-mers, about 2/(w+1) of them
+void checkMinimizers(unsigned kmerSize, unsigned window, const string &seq) {
+	set<string> forward = getMinimizers(kmerSize, window, seq);
+	assert(forward == getMinimizers(kmerSize, window, reverseComplement(seq)));
+	size_t kmerNum = seq.length() - kmerSize + 1;
+	assert(forward.size() >= kmerNum / window);
+	assert(forward.size() < kmerNum * 4 / (window + 1));
+}
+
+//k-mers taken from the shared encoding of a read must be the same as the
+//ones parsed from the sequence, at every position
+void checkPacked(unsigned kmerSize, const string &seq) {
+	ReadsProcessor parsed(kmerSize);
+	ReadsProcessor packed(kmerSize);
+	PackedRead read(seq);
+	packed.setRead(read);
+	unsigned kmerSizeInBytes = (kmerSize + 3) / 4;
+	for (size_t i = 0; i + kmerSize <= seq.length(); ++i) {
+		const unsigned char* expected = parsed.prepSeq(seq, i);
+		const unsigned char* actual = packed.prepSeq(read.getSeq(), i);
+		if (expected == NULL) {
+			assert(actual == NULL);
+		} else {
+			assert(actual != NULL);
+			assert(memcmp(expected, actual, kmerSizeInBytes) == 0);
+		}
+	}
+}
+
+//k-mer of a spaced seed as a string, empty if it cannot be used
+string spacedKmer(const string &seed, const string &kmer) {
+	ReadsProcessor proc(seed.length());
+	proc.setSpacedSeed(seed);
+	const unsigned char* c = proc.prepSeq(kmer, 0);
+	if (c == NULL) {
+		return "";
+	}
+	return string(reinterpret_cast<const char*>(c), (seed.length() + 3) / 4);
+}
+
+//information of a filter with the given spaced seed
+struct LoadInfo {
+	LoadInfo(const string &spacedSeed) :
+			m_spacedSeed(spacedSeed)
+	{
+	}
+	void operator()() const
+	{
+		vector<string> seqSrcs(1, "test.fa");
+		BloomFilterInfo info("spaced", 15, 3, 0.02, 1000, seqSrcs);
+		info.setTotalNum(100);
+		info.setSpacedSeed(m_spacedSeed);
+		stringstream text;
+		info.printInfo(text);
+		BloomFilterInfo loaded(text, "spaced.txt");
+	}
+	string m_spacedSeed;
+};
+
+//positions ignored by spaced seeds do not change k-mers on either strand
+void spacedSeedTests() {
+	string seed = "110110111011011";
+	assert(ReadsProcessor::isValidSpacedSeed(seed, 15));
+	assert(ReadsProcessor::isValidSpacedSeed(string(15, '1'), 15));
+	//asymmetric
+	assert(!ReadsProcessor::isValidSpacedSeed("110110111011111", 15));
+	//wrong length
+	assert(!ReadsProcessor::isValidSpacedSeed(seed, 16));
+	assert(!ReadsProcessor::isValidSpacedSeed(seed, 14));
+	//ignored bases at either end
+	assert(!ReadsProcessor::isValidSpacedSeed("010110111011010", 15));
+	assert(!ReadsProcessor::isValidSpacedSeed("110110111011010", 15));
+	assert(!ReadsProcessor::isValidSpacedSeed("010110111011011", 15));
+	//not 0s and 1s
+	assert(!ReadsProcessor::isValidSpacedSeed("110120111021011", 15));
+
+	for (unsigned i = 0; i < 100; ++i) {
+		string kmer = randomSeq(15, 200 + i);
+		string variant = kmer;
+		string other = randomSeq(15, 500 + i);
+		for (unsigned j = 0; j < seed.length(); ++j) {
+			if (seed[j] == '0') {
+				variant[j] = other[j];
+			}
+		}
+		string expected = spacedKmer(seed, kmer);
+		assert(!expected.empty());
+		assert(spacedKmer(seed, variant) == expected);
+		assert(spacedKmer(seed, reverseComplement(kmer)) == expected);
+		assert(spacedKmer(seed, reverseComplement(variant)) == expected);
+
+		//ambiguity bases are only accepted where bases are ignored
+		variant[2] = 'N';
+		variant[12] = 'n';
+		assert(spacedKmer(seed, variant) == expected);
+		assert(spacedKmer(seed, reverseComplement(variant)) == expected);
+		variant[3] = 'N';
+		assert(spacedKmer(seed, variant).empty());
+	}
+
+	//filter information with a seed that does not fit its k-mer size
+	assert(!exitsWithError(LoadInfo(seed)));
+	assert(exitsWithError(LoadInfo("110110111011111")));
+	assert(exitsWithError(LoadInfo("1101101110110111")));
+	assert(exitsWithError(LoadInfo("11011011011")));
+	assert(exitsWithError(LoadInfo("010110111011010")));
+	cout << "Spaced Seed Tests Done." << endl;
+}
+
 int main(int argc, char **argv) {
 
 	int16_t kmerSize = 4;
@@ -62,6 +207,57 @@ int main(int argc, char **argv) {
 //	assert(strcmp(proc.prepSeq("tAGA",0), proc0.prepSeq("TaGA",0)) == 0);
 //	assert(!strcmp(proc.prepSeq("CTAA",0), proc0.prepSeq("CTAC",0)) == 0);
 
+	//minimizer sampling
+	string longSeq = randomSeq(5000, 1);
+	checkMinimizers(25, 10, longSeq);
+	checkMinimizers(31, 1, longSeq.substr(0, 500));
+	checkMinimizers(15, 50, longSeq);
+	//every k-mer is selected with a window of 1
+	assert(getMinimizers(31, 1, longSeq.substr(0, 500)).size() == 470);
+	cout << "Minimizer Tests Done." << endl;
+
+	//shared encoding of reads
+	string seq = "GTACATAAATTAAATCCGGATCGATCGGCTAGCTAGGATCCAATCGTACGTTAGC";
+	for (unsigned k = 4; k <= 32; ++k) {
+		checkPacked(k, seq);
+	}
+	//k-mers containing ambiguity bases
+	string ambiguous = "GTACATAAATNAAATCCGGATCGATCGNNCTAGCTAGGATCCAATCGTACGTN";
+	for (unsigned k = 5; k <= 15; k += 2) {
+		checkPacked(k, ambiguous);
+	}
+	//lowercase bases
+	string lowercase = "gtacataaattaaatCCGGATCGATCGgctagctaggatccaatcgtacgttagc";
+	for (unsigned k = 6; k <= 21; k += 3) {
+		checkPacked(k, lowercase);
+	}
+	//palindromic k-mers (reverse complement of themselves)
+	checkPacked(4, "ACGTACGTAATTGGCCAATTCGCG");
+	checkPacked(6, "GAATTCGGATCCAAGCTTGAATTC");
+	checkPacked(8, "GCGGCCGCAATTAATTGAATTCGAATTC");
+	checkPacked(10, "ACGTTAACGTAATTATATAATTACGTTAACGT");
+	checkPacked(12, "TTACGGATATCCGTAA");
+	//a processor kept for several reads parses them once each is cleared
+	{
+		ReadsProcessor kept(15);
+		ReadsProcessor parsed(15);
+		for (unsigned i = 0; i < 10; ++i) {
+			string readSeq = randomSeq(40, 300 + i);
+			{
+				PackedRead read(readSeq);
+				kept.setRead(read);
+				assert(memcmp(kept.prepSeq(readSeq, 5),
+						parsed.prepSeq(readSeq, 5), 4) == 0);
+				kept.clearRead();
+			}
+			assert(memcmp(kept.prepSeq(readSeq, 7),
+					parsed.prepSeq(readSeq, 7), 4) == 0);
+		}
+	}
+	cout << "Packed Read Tests Done." << endl;
+
+	spacedSeedTests();
+
 	cout << "Read Processor Tests Done." << endl;
 	return 0;
 }
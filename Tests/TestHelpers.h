@@ -0,0 +1,66 @@
+/*
+ * TestHelpers.h
+ *
+ * Random sequences, file contents and error exits shared by the tests
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef TESTHELPERS_H_
+#define TESTHELPERS_H_
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <unistd.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+//next value of a linear congruential generator, same on every platform
+inline unsigned nextRandom(unsigned &seed) {
+	seed = seed * 1103515245 + 12345;
+	return seed >> 16;
+}
+
+//sequence of a given length drawn from bases
+inline string randomSeq(size_t length, unsigned seed,
+		const char *bases = "ACGT") {
+	size_t baseNum = strlen(bases);
+	string seq(length, 'A');
+	for (size_t i = 0; i < length; ++i) {
+		seq[i] = bases[nextRandom(seed) % baseNum];
+	}
+	return seq;
+}
+
+inline vector<unsigned char> readFile(const string &path) {
+	ifstream file(path.c_str(), ios::in | ios::binary);
+	return vector<unsigned char>(istreambuf_iterator<char>(file),
+			istreambuf_iterator<char>());
+}
+
+inline void writeFile(const string &path, const vector<unsigned char> &data) {
+	ofstream file(path.c_str(), ios::out | ios::binary);
+	file.write(reinterpret_cast<const char*>(&data[0]), data.size());
+}
+
+//true if test() exits with an error, it is run in a child process so the
+//exit does not end the tests
+template<typename Test>
+bool exitsWithError(const Test &test) {
+	pid_t pid = fork();
+	if (pid == 0) {
+		//error message expected
+		close(2);
+		test();
+		_exit(0);
+	}
+	int status;
+	waitpid(pid, &status, 0);
+	return WIFEXITED(status) && WEXITSTATUS(status) != 0;
+}
+
+#endif /* TESTHELPERS_H_ */
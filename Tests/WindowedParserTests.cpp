@@ -12,11 +12,133 @@
 #include <iostream>
 #include <boost/unordered/unordered_map.hpp>
 #include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include "TestHelpers.h"
 
 using namespace std;
 
+//sequence of bases (with some lowercase and ambiguity bases) of a given length
+string randomBases(size_t length, unsigned seed) {
+	return randomSeq(length, seed, "ACGTACGTACGTACGTacgtN");
+}
+
+//appends a fasta record with lines of lineWidth bases and its index entry
+//(the size indexed can differ from the sequence to corrupt the index)
+void addRecord(ofstream &fasta, stringstream &index, const string &header,
+		const string &seq, size_t lineWidth, const string &newline,
+		size_t indexedSize) {
+	fasta << ">" << header << "\n";
+	index << header << "\t" << indexedSize << "\t" << fasta.tellp() << "\t"
+			<< lineWidth << "\t" << lineWidth + newline.length() << "\n";
+	for (size_t i = 0; i < seq.length(); i += lineWidth) {
+		fasta << seq.substr(i, lineWidth) << newline;
+	}
+}
+
+void writeIndex(const string &fileName, const stringstream &index) {
+	ofstream indexFile((fileName + ".fai").c_str());
+	indexFile << index.str();
+}
+
+//k-mers of the parser must be the ones of the sequence, at every position
+void checkSequence(WindowedFileParser &parser, const string &header,
+		const string &seq, unsigned windowSize) {
+	ReadsProcessor proc(windowSize);
+	unsigned kmerSizeInBytes = (windowSize + 3) / 4;
+	parser.setLocationByHeader(header);
+	assert(parser.getSequenceSize(header) == seq.length());
+	size_t pos = 0;
+	while (parser.notEndOfSeqeunce()) {
+		const unsigned char* kmer = parser.getNextSeq();
+		if (!parser.notEndOfSeqeunce()) {
+			break;
+		}
+		const unsigned char* expected = proc.prepSeq(seq, pos++);
+		if (expected == NULL) {
+			assert(kmer == NULL);
+		} else {
+			assert(kmer != NULL);
+			assert(memcmp(kmer, expected, kmerSizeInBytes) == 0);
+		}
+	}
+	assert(pos == seq.length() - windowSize + 1);
+}
+
+//parsing of a sequence of a file (see exitsWithError)
+struct ParseSequence {
+	const string fileName;
+	const string header;
+	ParseSequence(const string &fileName, const string &header) :
+			fileName(fileName), header(header) {
+	}
+	void operator()() const {
+		WindowedFileParser parser(fileName, 25);
+		parser.setLocationByHeader(header);
+	}
+};
+
 int main(int argc, char **argv) {
 
+	//test line widths, a short last line, CRLF line endings and sequences
+	//longer than a chunk of the parser
+	unsigned kmerSize = 25;
+	string testFile = "/tmp/windowedParserTest.fa";
+	{
+		ofstream fasta(testFile.c_str());
+		stringstream index;
+		addRecord(fasta, index, "width60", randomBases(1000, 1), 60, "\n", 1000);
+		addRecord(fasta, index, "width7", randomBases(101, 2), 7, "\n", 101);
+		addRecord(fasta, index, "width1", randomBases(40, 3), 1, "\n", 40);
+		addRecord(fasta, index, "oneLine", randomBases(500, 4), 500, "\n", 500);
+		addRecord(fasta, index, "crlf", randomBases(333, 5), 50, "\r\n", 333);
+		addRecord(fasta, index, "long", randomBases(200003, 6), 80, "\n",
+				200003);
+		addRecord(fasta, index, "kmer", randomBases(kmerSize, 7), 10, "\n",
+				kmerSize);
+		fasta.close();
+		writeIndex(testFile, index);
+	}
+	WindowedFileParser parser(testFile, kmerSize);
+	assert(parser.getHeaders().size() == 7);
+	checkSequence(parser, "width60", randomBases(1000, 1), kmerSize);
+	checkSequence(parser, "width7", randomBases(101, 2), kmerSize);
+	checkSequence(parser, "width1", randomBases(40, 3), kmerSize);
+	checkSequence(parser, "oneLine", randomBases(500, 4), kmerSize);
+	checkSequence(parser, "crlf", randomBases(333, 5), kmerSize);
+	checkSequence(parser, "long", randomBases(200003, 6), kmerSize);
+	checkSequence(parser, "kmer", randomBases(kmerSize, 7), kmerSize);
+	//sequences can be parsed again in any order
+	checkSequence(parser, "width7", randomBases(101, 2), kmerSize);
+
+	//test index not matching the fasta file
+	string badFile = "/tmp/windowedParserBadIndex.fa";
+	{
+		ofstream fasta(badFile.c_str());
+		stringstream index;
+		addRecord(fasta, index, "good", randomBases(100, 8), 60, "\n", 100);
+		//sequence claimed to be longer than the file
+		addRecord(fasta, index, "tooLong", randomBases(100, 9), 60, "\n", 5000);
+		//no bases per line
+		stringstream ignored;
+		size_t start = size_t(fasta.tellp()) + strlen(">noWidth\n");
+		addRecord(fasta, ignored, "noWidth", randomBases(100, 10), 60, "\n", 100);
+		index << "noWidth\t100\t" << start << "\t0\t1\n";
+		fasta.close();
+		writeIndex(badFile, index);
+	}
+	assert(!exitsWithError(ParseSequence(badFile, "good")));
+	assert(exitsWithError(ParseSequence(badFile, "tooLong")));
+	assert(exitsWithError(ParseSequence(badFile, "noWidth")));
+
+	remove(testFile.c_str());
+	remove((testFile + ".fai").c_str());
+	remove(badFile.c_str());
+	remove((badFile + ".fai").c_str());
+	cout << "Windowed Parser Index Tests Done." << endl;
+
 	//test windowed parser
 	int16_t windowSize = 50;
 